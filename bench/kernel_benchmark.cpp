@@ -0,0 +1,165 @@
+/**
+ *  Microbenchmark of the optimized iteration kernel against the plain one.
+ *
+ *  Renders a fixed reference view with both variants of every available GPU kernel and a
+ *  few formulas, reports iterations per second and the speedup, and checks that the colored
+ *  images are pixel-identical. Exits with a failure if any pixel differs.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include "camera.hpp"
+#include "formula.hpp"
+#include "progressive_renderer.hpp"
+#include "render_target.hpp"
+#include "shader.hpp"
+
+namespace
+{
+	struct ReferenceView
+	{
+		const char* formula;
+		const char* centerX;
+		const char* centerY;
+		double scale;
+	};
+
+	// busy enough that nearly all of the time goes into the loop
+	const ReferenceView views[] =
+	{
+		// seahorse valley
+		{ "mandelbrot:2", "-0.7436438870371587", "0.1318259042053", 2e-4 },
+		// the whole cubic set, for the longer expansion
+		{ "mandelbrot:3", "0", "0", 1.2 }
+	};
+	const int referenceIterations = 4000;
+	const int width = 1024, height = 1024;
+
+	// timed renders per variant, alternating between them, the fastest one counts
+	const int repetitions = 3;
+
+	struct Result
+	{
+		double seconds = 0.0;
+		std::uint64_t iterations = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	Result render(IterationKernel kernel, const ReferenceView& view, bool optimized)
+	{
+		Camera camera;
+		camera.centerX = HighPrecision::fromString(view.centerX);
+		camera.centerY = HighPrecision::fromString(view.centerY);
+		camera.scale = view.scale;
+
+		Formula formula;
+		parseFormula(view.formula, formula);
+
+		// a fresh renderer starts over, the programs come from the cache
+		ProgressiveRenderer renderer(kernel);
+		renderer.setFormula(formula);
+		renderer.setOptimizedKernel(optimized);
+		// the interior shortcuts would hide the cost of the loop
+		renderer.interiorDetection = false;
+		renderer.iterationsPerPass = 1024;
+		renderer.resize(width, height);
+		renderer.setCamera(camera);
+		renderer.setMaxIterations(referenceIterations);
+
+		Result result;
+		glFinish();
+		const auto start = std::chrono::steady_clock::now();
+		while (!renderer.isComplete())
+			renderer.iterate();
+		glFinish();
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.iterations = renderer.iterationCount();
+
+		RenderTarget target;
+		target.resize(width, height, { GL_RGBA8 });
+		renderer.colorize(target, camera, false);
+		result.pixels.resize(static_cast<std::size_t>(width) * height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer());
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		return result;
+	}
+}
+
+int main()
+{
+	if (!glfwInit())
+		return EXIT_FAILURE;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Kernel benchmark", NULL, NULL);
+	if (!window)
+	{
+		std::cerr << "Failed to create window!\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cerr << "Failed to initialize glad!\n";
+		return EXIT_FAILURE;
+	}
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	createFullscreenQuad();
+
+	std::vector<IterationKernel> kernels = { IterationKernel::Fragment };
+	if (GLAD_GL_VERSION_4_3)
+		kernels.push_back(IterationKernel::Compute);
+
+	bool identical = true;
+	std::cout << std::fixed << std::setprecision(1);
+	for (const ReferenceView& view : views)
+	{
+		std::cout << view.formula << " at " << view.centerX << ", " << view.centerY << " scale " << std::defaultfloat << view.scale << std::fixed
+			<< ", " << width << "x" << height << ", " << referenceIterations << " iterations\n";
+		for (IterationKernel kernel : kernels)
+		{
+			// the first render of each variant warms up the driver
+			Result plain = render(kernel, view, false);
+			Result optimized = render(kernel, view, true);
+			for (int repetition = 0; repetition < repetitions; ++repetition)
+			{
+				plain.seconds = std::min(plain.seconds, render(kernel, view, false).seconds);
+				optimized.seconds = std::min(optimized.seconds, render(kernel, view, true).seconds);
+			}
+
+			std::size_t differing = 0;
+			for (std::size_t i = 0; i < plain.pixels.size(); i += 4)
+				differing += plain.pixels[i] != optimized.pixels[i] || plain.pixels[i + 1] != optimized.pixels[i + 1]
+					|| plain.pixels[i + 2] != optimized.pixels[i + 2];
+			identical = identical && differing == 0;
+
+			const char* name = (kernel == IterationKernel::Compute) ? "  compute " : "  fragment";
+			const double plainRate = plain.iterations / plain.seconds * 1e-6;
+			const double optimizedRate = optimized.iterations / optimized.seconds * 1e-6;
+			std::cout << name << "  plain " << plainRate << " Miterations/s, optimized " << optimizedRate
+				<< " Miterations/s, " << std::setprecision(2) << optimizedRate / plainRate << "x, "
+				<< differing << " pixels differ\n" << std::setprecision(1);
+		}
+	}
+
+	releaseProgramCache();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
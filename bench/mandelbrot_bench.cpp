@@ -0,0 +1,271 @@
+/**
+ *  Benchmark suite over a fixed set of canonical views, resolutions and iteration caps on
+ *  every backend: the fragment and compute kernels with float, double-float, fp64 and
+ *  extended deltas, and the SIMD CPU renderer. All of them iterate perturbation deltas against the
+ *  same reference orbit.
+ *
+ *  Prints one JSON object per run and line with the fastest of the repetitions in Mpixels/s
+ *  and Giterations/s, and p50 / p99 of the frame times over all of them. A GPU frame is one
+ *  pass of iterate() as in the viewer, timed with the queries of frame_profiler.hpp, a CPU
+ *  frame is a whole render. Progress goes to stderr.
+ *
+ *      MandelbrotBench [--repetitions <int>] [--filter <text>]
+ *
+ *  --filter only runs the cases whose "view/backend" name contains the text.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include "camera.hpp"
+#include "cpu_renderer.hpp"
+#include "delta_precision.hpp"
+#include "formula.hpp"
+#include "frame_profiler.hpp"
+#include "progressive_renderer.hpp"
+#include "shader.hpp"
+
+namespace
+{
+	struct View
+	{
+		const char* name;
+		const char* centerX;
+		const char* centerY;
+		double scale;
+		std::vector<int> iterationCaps;
+	};
+
+	// quadratic Mandelbrot throughout, the default formula is the cubic one
+	const View views[] =
+	{
+		{ "full-set", "-0.75", "0", 1.25, { 256, 1024 } },
+		{ "seahorse-valley", "-0.7436438870371587", "0.1318259042053", 2e-4, { 1000, 4000 } },
+		// the period 1810 minibrot of bench/precision_benchmark.cpp, below float's range
+		{ "deep-minibrot", "-0.743698797589661409763891699751663485216655661341", "0.131738992431655620716363418638720594159177717",
+			1e-36, { 16000, 32000 } },
+		// the main cardioid and period 2 bulb, nearly every pixel is interior
+		{ "interior", "-0.4", "0", 0.3, { 1000, 10000 } }
+	};
+	const int resolutions[] = { 512, 1024 };
+
+	enum class Backend
+	{
+		Fragment,
+		Compute,
+		Cpu
+	};
+
+	struct BackendCase
+	{
+		const char* name;
+		Backend backend;
+		DeltaPrecision precision;
+	};
+
+	const BackendCase backends[] =
+	{
+		{ "fragment-float", Backend::Fragment, DeltaPrecision::Float },
+		{ "compute-float", Backend::Compute, DeltaPrecision::Float },
+		{ "fragment-double-float", Backend::Fragment, DeltaPrecision::DoubleFloat },
+		{ "compute-double-float", Backend::Compute, DeltaPrecision::DoubleFloat },
+		{ "fragment-double", Backend::Fragment, DeltaPrecision::Double },
+		{ "compute-double", Backend::Compute, DeltaPrecision::Double },
+		{ "fragment-extended", Backend::Fragment, DeltaPrecision::Extended },
+		{ "compute-extended", Backend::Compute, DeltaPrecision::Extended },
+		// float deltas in SIMD lanes
+		{ "cpu-simd", Backend::Cpu, DeltaPrecision::Float }
+	};
+
+	struct Run
+	{
+		double seconds = 0.0;
+		std::uint64_t iterations = 0;
+		std::vector<double> frameMilliseconds;
+	};
+
+	Camera camera(const View& view)
+	{
+		Camera camera;
+		camera.centerX = HighPrecision::fromString(view.centerX);
+		camera.centerY = HighPrecision::fromString(view.centerY);
+		camera.scale = view.scale;
+		return camera;
+	}
+
+	Run renderGpu(const BackendCase& backend, const Formula& formula, const Camera& camera, int size, int maxIterations)
+	{
+		// a fresh renderer starts over, the programs come from the cache
+		ProgressiveRenderer renderer(backend.backend == Backend::Compute ? IterationKernel::Compute : IterationKernel::Fragment);
+		renderer.setFormula(formula);
+		renderer.setDeltaPrecision(backend.precision);
+		renderer.resize(size, size);
+		renderer.setCamera(camera);
+		renderer.setMaxIterations(maxIterations);
+
+		FrameProfiler profiler;
+		Run run;
+		glFinish();
+		const auto start = std::chrono::steady_clock::now();
+		while (!renderer.isComplete())
+		{
+			profiler.beginFrame();
+			profiler.begin(ProfilePass::Iterate);
+			renderer.iterate();
+			profiler.end(ProfilePass::Iterate);
+			profiler.endFrame();
+		}
+		glFinish();
+		run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		run.iterations = renderer.iterationCount();
+
+		// only the last historyFrames frames are kept, plenty for the percentiles
+		profiler.flush();
+		for (const FrameProfiler::Frame& frame : profiler.history())
+			run.frameMilliseconds.push_back(frame.passMilliseconds[static_cast<int>(ProfilePass::Iterate)]);
+		return run;
+	}
+
+	Run renderCpu(CpuRenderer& renderer, const Formula& formula, const Camera& camera, int size, int maxIterations)
+	{
+		renderer.formula = formula;
+		renderer.maxIterations = maxIterations;
+
+		Run run;
+		std::vector<unsigned char> rgb;
+		const auto start = std::chrono::steady_clock::now();
+		renderer.render(camera, size, size, rgb);
+		run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		run.iterations = renderer.iterations();
+		run.frameMilliseconds.push_back(run.seconds * 1e3);
+		return run;
+	}
+
+	// nearest rank
+	double percentile(std::vector<double> values, double fraction)
+	{
+		if (values.empty())
+			return 0.0;
+		std::sort(values.begin(), values.end());
+		const std::size_t rank = static_cast<std::size_t>(fraction * (values.size() - 1) + 0.5);
+		return values[std::min(rank, values.size() - 1)];
+	}
+
+	bool available(const BackendCase& backend, const View& view)
+	{
+		if (backend.backend == Backend::Compute && !GLAD_GL_VERSION_4_3)
+			return false;
+		if (backend.precision != DeltaPrecision::Float && !ProgressiveRenderer::deltaPrecisionAvailable(backend.precision))
+			return false;
+		// float deltas no longer resolve the pixels, see delta_precision.hpp
+		return view.scale >= ProgressiveRenderer::minimumScale(backend.precision);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int repetitions = 3;
+	std::string filter;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string name = argv[i];
+		if (name == "--repetitions")
+			repetitions = std::max(std::atoi(argv[i + 1]), 1);
+		else if (name == "--filter")
+			filter = argv[i + 1];
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--repetitions <int>] [--filter <text>]\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!glfwInit())
+		return EXIT_FAILURE;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Mandelbrot benchmark", NULL, NULL);
+	if (!window)
+	{
+		std::cerr << "Failed to create window!\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cerr << "Failed to initialize glad!\n";
+		return EXIT_FAILURE;
+	}
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	createFullscreenQuad();
+
+	Formula formula;
+	parseFormula("mandelbrot:2", formula);
+	CpuRenderer cpuRenderer;
+
+	for (const View& view : views)
+	{
+		const Camera viewCamera = camera(view);
+		for (const BackendCase& backend : backends)
+		{
+			const std::string name = std::string(view.name) + "/" + backend.name;
+			if (name.find(filter) == std::string::npos || !available(backend, view))
+				continue;
+
+			for (int size : resolutions)
+			{
+				for (int maxIterations : view.iterationCaps)
+				{
+					std::cerr << name << " " << size << "x" << size << " " << maxIterations << " iterations\n";
+
+					// the first render warms up the driver and the caches
+					auto render = [&]()
+					{
+						return backend.backend == Backend::Cpu ? renderCpu(cpuRenderer, formula, viewCamera, size, maxIterations)
+							: renderGpu(backend, formula, viewCamera, size, maxIterations);
+					};
+					render();
+					Run fastest;
+					std::vector<double> frameMilliseconds;
+					for (int repetition = 0; repetition < repetitions; ++repetition)
+					{
+						Run run = render();
+						frameMilliseconds.insert(frameMilliseconds.end(), run.frameMilliseconds.begin(), run.frameMilliseconds.end());
+						if (repetition == 0 || run.seconds < fastest.seconds)
+							fastest = run;
+					}
+
+					const double seconds = std::max(fastest.seconds, 1e-9);
+					std::cout << "{\"view\":\"" << view.name << "\",\"backend\":\"" << backend.name
+						<< "\",\"precision\":\"" << deltaPrecisionName(backend.precision)
+						<< "\",\"width\":" << size << ",\"height\":" << size << ",\"max_iterations\":" << maxIterations
+						<< ",\"repetitions\":" << repetitions << ",\"seconds\":" << fastest.seconds
+						<< ",\"iterations\":" << fastest.iterations
+						<< ",\"mpixels_per_second\":" << static_cast<double>(size) * size / seconds * 1e-6
+						<< ",\"giterations_per_second\":" << fastest.iterations / seconds * 1e-9
+						<< ",\"frames\":" << frameMilliseconds.size()
+						<< ",\"frame_ms_p50\":" << percentile(frameMilliseconds, 0.5)
+						<< ",\"frame_ms_p99\":" << percentile(frameMilliseconds, 0.99) << "}" << std::endl;
+				}
+			}
+		}
+	}
+
+	releaseProgramCache();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/**
+ *  Benchmark of the delta formats of the GPU kernels, see delta_precision.hpp.
+ *
+ *  Renders a busy reference view with float, double-float, fp64 and extended deltas on every
+ *  available kernel and reports iterations per second, then zooms into a deep boundary point
+ *  and counts for every depth how many pixels of the other images differ from the fp64 one. Escape times near the boundary are chaotic, so some pixels always differ
+ *  between two formats; a format that no longer resolves the pixels differs nearly
+ *  everywhere. Needs GL 4.0.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include "camera.hpp"
+#include "delta_precision.hpp"
+#include "formula.hpp"
+#include "progressive_renderer.hpp"
+#include "render_target.hpp"
+#include "shader.hpp"
+
+namespace
+{
+	struct View
+	{
+		const char* centerX;
+		const char* centerY;
+		double scale;
+		int iterations;
+	};
+
+	// seahorse valley, busy enough that nearly all of the time goes into the loop
+	const View throughputView = { "-0.7436438870371587", "0.1318259042053", 2e-4, 2000 };
+	const int throughputSize = 512;
+	// timed renders per format, alternating between them, the fastest one counts
+	const int repetitions = 3;
+
+	// nucleus of a period 1810 minibrot in the seahorse valley, about 6e-39 across, so every
+	// depth below still has a boundary in view
+	const char* deepX = "-0.743698797589661409763891699751663485216655661341";
+	const char* deepY = "0.131738992431655620716363418638720594159177717";
+	const double depths[] = { 1e-10, 1e-20, 1e-30, 1e-34, 1e-37, 1e-38 };
+	const int deepIterations = 16000;
+	const int deepSize = 256;
+	// one palette cycle per iteration, so that a wrong fraction of the smooth value shows
+	const float deepColorPeriod = 1.0f;
+	// channel difference still taken for the same color, the last bits of the smooth value
+	// differ even between exact formats
+	const int colorTolerance = 8;
+
+	const DeltaPrecision precisions[] = { DeltaPrecision::Float, DeltaPrecision::DoubleFloat, DeltaPrecision::Double,
+		DeltaPrecision::Extended };
+
+	struct Result
+	{
+		double seconds = 0.0;
+		std::uint64_t iterations = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	Result render(IterationKernel kernel, DeltaPrecision precision, const Camera& camera, int size, int maxIterations,
+		float colorPeriod = 100.0f)
+	{
+		// a fresh renderer starts over, the programs come from the cache
+		// both views are quadratic, the default formula is the cubic one
+		Formula formula;
+		parseFormula("mandelbrot:2", formula);
+
+		ProgressiveRenderer renderer(kernel);
+		renderer.setFormula(formula);
+		renderer.setDeltaPrecision(precision);
+		// the interior shortcuts would hide the cost of the loop
+		renderer.interiorDetection = false;
+		renderer.iterationsPerPass = 1024;
+		renderer.resize(size, size);
+		renderer.setCamera(camera);
+		renderer.setMaxIterations(maxIterations);
+		renderer.colorPeriod = colorPeriod;
+
+		Result result;
+		glFinish();
+		const auto start = std::chrono::steady_clock::now();
+		while (!renderer.isComplete())
+			renderer.iterate();
+		glFinish();
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.iterations = renderer.iterationCount();
+
+		RenderTarget target;
+		target.resize(size, size, { GL_RGBA8 });
+		renderer.colorize(target, camera, false);
+		result.pixels.resize(static_cast<std::size_t>(size) * size * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer());
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		return result;
+	}
+
+	Camera camera(const char* centerX, const char* centerY, double scale)
+	{
+		Camera camera;
+		camera.centerX = HighPrecision::fromString(centerX);
+		camera.centerY = HighPrecision::fromString(centerY);
+		camera.scale = scale;
+		return camera;
+	}
+
+	std::size_t differingPixels(const Result& lhs, const Result& rhs)
+	{
+		std::size_t differing = 0;
+		for (std::size_t i = 0; i < lhs.pixels.size(); i += 4)
+			for (std::size_t channel = i; channel < i + 3; ++channel)
+				if (std::abs(lhs.pixels[channel] - rhs.pixels[channel]) > colorTolerance)
+				{
+					++differing;
+					break;
+				}
+		return differing;
+	}
+}
+
+int main()
+{
+	if (!glfwInit())
+		return EXIT_FAILURE;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Precision benchmark", NULL, NULL);
+	if (!window)
+	{
+		std::cerr << "Failed to create window!\n";
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cerr << "Failed to initialize glad!\n";
+		return EXIT_FAILURE;
+	}
+	if (!ProgressiveRenderer::deltaPrecisionAvailable(DeltaPrecision::Double))
+	{
+		std::cerr << "The precise deltas need GL 4.0!\n";
+		return EXIT_FAILURE;
+	}
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	createFullscreenQuad();
+
+	std::vector<IterationKernel> kernels = { IterationKernel::Fragment };
+	if (GLAD_GL_VERSION_4_3)
+		kernels.push_back(IterationKernel::Compute);
+
+	std::cout << std::fixed << std::setprecision(1);
+	const Camera busy = camera(throughputView.centerX, throughputView.centerY, throughputView.scale);
+	std::cout << "Throughput at " << throughputView.centerX << ", " << throughputView.centerY << " scale " << std::defaultfloat
+		<< throughputView.scale << std::fixed << ", " << throughputSize << "x" << throughputSize << ", "
+		<< throughputView.iterations << " iterations\n";
+	for (IterationKernel kernel : kernels)
+	{
+		// the first render of each format warms up the driver
+		std::vector<Result> results;
+		for (DeltaPrecision precision : precisions)
+			results.push_back(render(kernel, precision, busy, throughputSize, throughputView.iterations));
+		for (int repetition = 0; repetition < repetitions; ++repetition)
+			for (std::size_t i = 0; i < results.size(); ++i)
+				results[i].seconds = std::min(results[i].seconds,
+					render(kernel, precisions[i], busy, throughputSize, throughputView.iterations).seconds);
+
+		std::cout << ((kernel == IterationKernel::Compute) ? "  compute " : "  fragment");
+		const double floatRate = results[0].iterations / results[0].seconds * 1e-6;
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const double rate = results[i].iterations / results[i].seconds * 1e-6;
+			std::cout << "  " << deltaPrecisionName(precisions[i]) << " " << rate << " Miterations/s";
+			if (i > 0)
+				std::cout << " (" << std::setprecision(2) << rate / floatRate << "x)" << std::setprecision(1);
+		}
+		std::cout << "\n";
+	}
+
+	// the kernels agree with each other, so the fastest one is enough for the depths
+	const IterationKernel kernel = kernels.back();
+	std::cout << "Pixels that differ from double at " << deepX << ", " << deepY << ", " << deepSize << "x" << deepSize
+		<< ", " << deepIterations << " iterations\n" << std::defaultfloat;
+	for (double depth : depths)
+	{
+		const Camera deep = camera(deepX, deepY, depth);
+		const Result reference = render(kernel, DeltaPrecision::Double, deep, deepSize, deepIterations, deepColorPeriod);
+		std::cout << "  scale " << std::setw(6) << depth;
+		for (DeltaPrecision precision : { DeltaPrecision::Float, DeltaPrecision::DoubleFloat, DeltaPrecision::Extended })
+		{
+			const Result result = render(kernel, precision, deep, deepSize, deepIterations, deepColorPeriod);
+			std::cout << "  " << deltaPrecisionName(precision) << " " << std::fixed << std::setprecision(1) << std::setw(5)
+				<< 100.0 * differingPixels(result, reference) / (deepSize * deepSize) << "%" << std::defaultfloat;
+		}
+		std::cout << "\n";
+	}
+
+	releaseProgramCache();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "options.hpp"
+
+// Renders options.camera into options.output tile by tile, with the current GL context or
+// on the CPU depending on options.backend.
+// Only one row of tiles is held in memory at a time. Returns false on I/O errors.
+bool renderBatch(const Options& options);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "fixed_point.hpp"
+
+/**
+ *  What the viewer is looking at. The default matches the original
+ *  [-3, 1] x [-2, 2] framing of the fullscreen quad.
+ */
+struct Camera
+{
+	HighPrecision centerX = HighPrecision::fromDouble(-1.0);
+	HighPrecision centerY;
+	// half of the view height in complex units
+	double scale = 2.0;
+
+	bool operator==(const Camera& rhs) const
+	{
+		return centerX == rhs.centerX && centerY == rhs.centerY && scale == rhs.scale;
+	}
+	bool operator!=(const Camera& rhs) const { return !(*this == rhs); }
+};
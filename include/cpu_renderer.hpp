@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "camera.hpp"
+#include "formula.hpp"
+#include "histogram.hpp"
+#include "tile_scheduler.hpp"
+
+/**
+ *  Software counterpart of ProgressiveRenderer for machines without a usable GL driver.
+ *  It runs the same perturbation loop, series skip and palette, one pixel per SIMD lane
+ *  (see simd.hpp), and spreads small blocks of the view over all hardware threads with
+ *  a work-stealing TileScheduler. Lanes whose pixel finished are refilled right away, so
+ *  interior pixels do not hold back the rest of the vector. The output matches the GPU
+ *  up to float rounding in a few pixels.
+ */
+class CpuRenderer
+{
+public:
+	// threads == 0 uses every hardware thread
+	explicit CpuRenderer(int threads = 0);
+
+	// Renders camera (scale is half of the view height) into width * height RGB pixels,
+	// top row first.
+	void render(const Camera& camera, int width, int height, std::vector<unsigned char>& rgb);
+	// Colors smooth values as kept by render() with the current palette, without iterating.
+	void colorize(const std::vector<float>& smooth, std::vector<unsigned char>& rgb) const;
+
+	int threads() const { return m_Scheduler.threads(); }
+	// iterations done by the last render(), for throughput reports
+	std::uint64_t iterations() const { return m_Iterations; }
+	// pixels the last render() filled by boundary tracing without iterating them
+	std::uint64_t filledPixels() const { return m_FilledPixels; }
+	// references the last render() used, more than 1 if pixels glitched, see glitch_detection.hpp
+	int references() const { return m_References; }
+	// pixels that glitched with every reference and finished without the test
+	std::uint64_t glitchedPixels() const { return m_GlitchedPixels; }
+	// busy time and tile counts of every thread in the last render()
+	const std::vector<TileScheduler::ThreadStats>& threadStats() const { return m_Scheduler.stats(); }
+	// smooth value of every pixel of the last render(), NaN inside the set, top row first
+	const std::vector<float>& smooth() const { return m_Smooth; }
+
+	Formula formula;
+	int maxIterations = 100;
+	// stop early on pixels found inside the set, see interior_detection.hpp
+	bool interiorDetection = true;
+	// Mariani-Silver subdivision inside every block, rectangles bordered by interior
+	// pixels are filled without iterating them
+	bool boundaryTracing = true;
+	// iterations per cycle of the palette
+	float colorPeriod = 100.0f;
+	// index into palettes() and its shift in cycles, as in ProgressiveRenderer
+	int palette = 0;
+	float paletteOffset = 0.0f;
+	// color by the histogram of the smooth values, see histogram.hpp
+	bool histogramColoring = false;
+	// histogram shared by the tiles of a larger image, each render() and colorize() builds
+	// its own while the CDF is empty
+	Histogram histogram;
+
+private:
+	void recolorByHistogram(const std::vector<unsigned char>& table, const std::vector<float>& smooth,
+		std::vector<unsigned char>& rgb) const;
+
+	TileScheduler m_Scheduler;
+	std::uint64_t m_Iterations = 0;
+	std::uint64_t m_FilledPixels = 0;
+	int m_References = 1;
+	std::uint64_t m_GlitchedPixels = 0;
+	// render() warns once about views its float deltas do not resolve
+	bool m_DepthWarned = false;
+	std::vector<unsigned char> m_Status;
+	std::vector<float> m_Smooth;
+};
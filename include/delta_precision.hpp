@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+
+/**
+ *  Number format of the perturbation deltas in the GPU kernels. Float deltas run out of
+ *  exponent range once a pixel gets close to FLT_MIN, so deeper views need native fp64
+ *  (GL 4.0 / GL_ARB_gpu_shader_fp64) or extended floats, a float mantissa with a separate
+ *  exponent per component that float's own range never limits, at about float cost on GPUs
+ *  whose fp64 rate is a small fraction of the float rate. Double-float keeps every value as
+ *  an unevaluated sum hi + lo of two floats, which doubles the mantissa but not the exponent
+ *  range. bench/precision_benchmark.cpp compares the four.
+ */
+enum class DeltaPrecision
+{
+	// float while it still resolves the view, fp64 below that where the GPU has it
+	Automatic,
+	Float,
+	DoubleFloat,
+	Double,
+	Extended
+};
+
+// Deepest scales (half of the view height) the deltas resolve. Double-float shares float's
+// exponent. fp64 and extended deltas go down to where the pixel size, the series and the
+// reference center, all computed on the CPU in double or HighPrecision, run out.
+const double minimumFloatScale = 1e-30;
+const double minimumDeepScale = 1e-300;
+
+inline const char* deltaPrecisionName(DeltaPrecision precision)
+{
+	switch (precision)
+	{
+	case DeltaPrecision::Float:
+		return "float";
+	case DeltaPrecision::DoubleFloat:
+		return "double-float";
+	case DeltaPrecision::Double:
+		return "double";
+	case DeltaPrecision::Extended:
+		return "extended";
+	default:
+		return "auto";
+	}
+}
+
+// The precision deltaPrecisionName() calls name, false if there is none.
+inline bool parseDeltaPrecision(const std::string& name, DeltaPrecision& precision)
+{
+	for (DeltaPrecision candidate : { DeltaPrecision::Automatic, DeltaPrecision::Float, DeltaPrecision::DoubleFloat,
+		DeltaPrecision::Double, DeltaPrecision::Extended })
+	{
+		if (name == deltaPrecisionName(candidate))
+		{
+			precision = candidate;
+			return true;
+		}
+	}
+	return false;
+}
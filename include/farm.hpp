@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "camera.hpp"
+#include "options.hpp"
+
+/**
+ *  Render farm over TCP. The coordinator splits an offline render into pieces of work, the
+ *  tiles of an image or the frames of a sequence, and listens for workers. Every worker that
+ *  connects is sent the job settings and then keeps two pieces in flight, asking for the next
+ *  one as each result goes back, so faster nodes simply take more. Once nothing is left to
+ *  hand out, idle workers also take the oldest piece another worker is still on, and whichever
+ *  result arrives first is used. A worker that drops its connection gives its pieces back.
+ *
+ *  Workers render with their own backend, the job settings fix everything else that changes
+ *  the values (cap, formula, interior tests, delta precision, kernel variant). They send back
+ *  the smooth values of the pixels, NaN inside the set, with runs of equal values compressed.
+ *  The coordinator colors them with the CPU palette code and encodes the output in order,
+ *  so the workers never see a palette. Values are sent in the byte order of the machines,
+ *  which are all x64 (see premake5.lua).
+ *
+ *      coordinator   MandelbrotSet --output poster.png ... --farm-listen 7070
+ *      worker        MandelbrotSet --farm-worker coordinator-host:7070 [--backend cpu]
+ */
+struct FarmWork
+{
+	Camera camera;
+	int width = 0, height = 0;
+};
+
+// Receives the result of piece index as CpuRenderer::smooth() values, in index order.
+// Returning false cancels the render.
+using FarmDelivery = std::function<bool(int index, const std::vector<float>& smooth)>;
+
+// Runs the coordinator on options.farmPort, and a local worker on every GPU of gpuDevices()
+// if options.gpus > 1, until every piece of work was delivered. Without a port the local GPUs
+// render everything. Returns false if the port can not be opened or a delivery failed.
+bool coordinateFarm(const Options& options, const std::vector<FarmWork>& work, const FarmDelivery& deliver);
+
+// Runs a worker for the coordinator at options.farmCoordinator ("host:port") until it is done,
+// with the current GL context or on the CPU depending on options.backend. With options.gpus > 1
+// every GPU of gpuDevices() connects as a worker of its own.
+bool runFarmWorker(const Options& options);
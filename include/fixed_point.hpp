@@ -0,0 +1,264 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+/**
+ *  Signed fixed-point number made of 32-bit limbs, stored least significant first.
+ *  The top limb holds the (two's complement) integer part, the remaining limbs
+ *  hold the fraction, so FixedPoint<6> has 160 fractional bits.
+ *
+ *  This is only used on the CPU for the perturbation reference orbit and the
+ *  camera center, so it favours simplicity over speed.
+ */
+template <std::size_t Limbs>
+class FixedPoint
+{
+	static_assert(Limbs >= 2, "FixedPoint needs an integer limb and at least one fraction limb");
+
+	template <std::size_t> friend class FixedPoint;
+
+public:
+	static constexpr std::size_t limbs = Limbs;
+	static constexpr int fractionBits = 32 * static_cast<int>(Limbs - 1);
+	// decimal fraction digits that carry every fraction bit, for toString()
+	static constexpr int decimalDigits = fractionBits * 30103 / 100000 + 2;
+
+	FixedPoint() : m_Limbs{} {}
+
+	static FixedPoint fromDouble(double value)
+	{
+		FixedPoint result;
+		double magnitude = std::fabs(value);
+
+		// integer part goes to the top limb, then peel off 32 fraction bits at a time
+		double integerPart = std::floor(magnitude);
+		result.m_Limbs[Limbs - 1] = static_cast<uint32_t>(integerPart);
+		magnitude -= integerPart;
+		for (std::size_t i = Limbs - 1; i-- > 0;)
+		{
+			magnitude *= 4294967296.0;
+			double limb = std::floor(magnitude);
+			result.m_Limbs[i] = static_cast<uint32_t>(limb);
+			magnitude -= limb;
+		}
+
+		return (value < 0.0) ? -result : result;
+	}
+
+	// Parses plain decimal notation such as "-0.743643887037158704752191506114774".
+	static FixedPoint fromString(const std::string& text)
+	{
+		FixedPoint result;
+		std::size_t position = 0;
+		bool negative = false;
+		if (position < text.size() && (text[position] == '-' || text[position] == '+'))
+			negative = (text[position++] == '-');
+
+		for (; position < text.size() && text[position] != '.'; ++position)
+		{
+			if (text[position] < '0' || text[position] > '9')
+				return fromDouble(std::stod(text));
+			result = result.mulSmall(10) + fromInteger(text[position] - '0');
+		}
+
+		// accumulate the fraction from the last digit backwards: f = (d + f) / 10
+		if (position < text.size())
+		{
+			FixedPoint fraction;
+			for (std::size_t i = text.size(); i-- > position + 1;)
+			{
+				if (text[i] < '0' || text[i] > '9')
+					return fromDouble(std::stod(text));
+				fraction = (fraction + fromInteger(text[i] - '0')).divSmall(10);
+			}
+			result = result + fraction;
+		}
+
+		return negative ? -result : result;
+	}
+
+	// The same number with another count of fraction limbs, dropping the least significant
+	// ones rounds down.
+	template <std::size_t Other>
+	FixedPoint<Other> resized() const
+	{
+		FixedPoint<Other> result;
+		for (std::size_t i = 0; i < Limbs && i < Other; ++i)
+			result.m_Limbs[Other - 1 - i] = m_Limbs[Limbs - 1 - i];
+		return result;
+	}
+
+	static FixedPoint fromInteger(int32_t value)
+	{
+		FixedPoint result;
+		result.m_Limbs[Limbs - 1] = static_cast<uint32_t>(value);
+		return result;
+	}
+
+	double toDouble() const
+	{
+		FixedPoint magnitude = isNegative() ? -*this : *this;
+		double value = 0.0;
+		double weight = 1.0;
+		for (std::size_t i = Limbs; i-- > 0;)
+		{
+			value += static_cast<double>(magnitude.m_Limbs[i]) * weight;
+			weight /= 4294967296.0;
+		}
+		return isNegative() ? -value : value;
+	}
+
+	std::string toString(int digits) const
+	{
+		FixedPoint magnitude = isNegative() ? -*this : *this;
+		std::string text = isNegative() ? "-" : "";
+		text += std::to_string(magnitude.m_Limbs[Limbs - 1]);
+		text += '.';
+
+		magnitude.m_Limbs[Limbs - 1] = 0;
+		for (int i = 0; i < digits; ++i)
+		{
+			magnitude = magnitude.mulSmall(10);
+			text += static_cast<char>('0' + magnitude.m_Limbs[Limbs - 1]);
+			magnitude.m_Limbs[Limbs - 1] = 0;
+		}
+		return text;
+	}
+
+	bool isNegative() const
+	{
+		return (m_Limbs[Limbs - 1] & 0x80000000u) != 0;
+	}
+
+	FixedPoint operator-() const
+	{
+		FixedPoint result;
+		uint64_t carry = 1;
+		for (std::size_t i = 0; i < Limbs; ++i)
+		{
+			carry += static_cast<uint32_t>(~m_Limbs[i]);
+			result.m_Limbs[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		return result;
+	}
+
+	FixedPoint operator+(const FixedPoint& rhs) const
+	{
+		FixedPoint result;
+		uint64_t carry = 0;
+		for (std::size_t i = 0; i < Limbs; ++i)
+		{
+			carry += static_cast<uint64_t>(m_Limbs[i]) + rhs.m_Limbs[i];
+			result.m_Limbs[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		return result;
+	}
+
+	FixedPoint operator-(const FixedPoint& rhs) const
+	{
+		return *this + (-rhs);
+	}
+
+	FixedPoint operator*(const FixedPoint& rhs) const
+	{
+		const bool negative = isNegative() != rhs.isNegative();
+		const FixedPoint lhsMagnitude = isNegative() ? -*this : *this;
+		const FixedPoint rhsMagnitude = rhs.isNegative() ? -rhs : rhs;
+
+		// full schoolbook product, then keep the limbs that line up with our binary point
+		std::array<uint32_t, 2 * Limbs> product{};
+		for (std::size_t i = 0; i < Limbs; ++i)
+		{
+			uint64_t carry = 0;
+			for (std::size_t j = 0; j < Limbs; ++j)
+			{
+				carry += static_cast<uint64_t>(lhsMagnitude.m_Limbs[i]) * rhsMagnitude.m_Limbs[j] + product[i + j];
+				product[i + j] = static_cast<uint32_t>(carry);
+				carry >>= 32;
+			}
+			product[i + Limbs] = static_cast<uint32_t>(carry);
+		}
+
+		FixedPoint result;
+		for (std::size_t i = 0; i < Limbs; ++i)
+			result.m_Limbs[i] = product[i + Limbs - 1];
+
+		return negative ? -result : result;
+	}
+
+	FixedPoint& operator+=(const FixedPoint& rhs) { return *this = *this + rhs; }
+	FixedPoint& operator-=(const FixedPoint& rhs) { return *this = *this - rhs; }
+
+	FixedPoint mulSmall(uint32_t factor) const
+	{
+		const bool negative = isNegative();
+		FixedPoint magnitude = negative ? -*this : *this;
+		uint64_t carry = 0;
+		for (std::size_t i = 0; i < Limbs; ++i)
+		{
+			carry += static_cast<uint64_t>(magnitude.m_Limbs[i]) * factor;
+			magnitude.m_Limbs[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		return negative ? -magnitude : magnitude;
+	}
+
+	FixedPoint divSmall(uint32_t divisor) const
+	{
+		const bool negative = isNegative();
+		FixedPoint magnitude = negative ? -*this : *this;
+		uint64_t remainder = 0;
+		for (std::size_t i = Limbs; i-- > 0;)
+		{
+			remainder = (remainder << 32) | magnitude.m_Limbs[i];
+			magnitude.m_Limbs[i] = static_cast<uint32_t>(remainder / divisor);
+			remainder %= divisor;
+		}
+		return negative ? -magnitude : magnitude;
+	}
+
+	// Rounds down to a multiple of 2^exponent, for -fractionBits <= exponent < 32.
+	FixedPoint floorToPowerOfTwo(int exponent) const
+	{
+		// two's complement, so clearing the low bits rounds negative numbers down as well
+		FixedPoint result = *this;
+		const int clearedBits = fractionBits + exponent;
+		for (std::size_t i = 0; i < Limbs; ++i)
+		{
+			const int limbStart = 32 * static_cast<int>(i);
+			if (clearedBits >= limbStart + 32)
+				result.m_Limbs[i] = 0;
+			else if (clearedBits > limbStart)
+				result.m_Limbs[i] &= ~0u << (clearedBits - limbStart);
+		}
+		return result;
+	}
+
+	bool operator==(const FixedPoint& rhs) const { return m_Limbs == rhs.m_Limbs; }
+	bool operator!=(const FixedPoint& rhs) const { return m_Limbs != rhs.m_Limbs; }
+	bool operator<(const FixedPoint& rhs) const
+	{
+		if (isNegative() != rhs.isNegative())
+			return isNegative();
+		// with equal signs two's complement orders like the unsigned limbs
+		for (std::size_t i = Limbs; i-- > 0;)
+		{
+			if (m_Limbs[i] != rhs.m_Limbs[i])
+				return m_Limbs[i] < rhs.m_Limbs[i];
+		}
+		return false;
+	}
+
+private:
+	std::array<uint32_t, Limbs> m_Limbs;
+};
+
+// 1056 fractional bits, enough for the view center at scales down to minimumDeepScale (see
+// delta_precision.hpp). The reference orbit only iterates with as many limbs as its scale
+// needs, see referenceLimbs().
+using HighPrecision = FixedPoint<34>;
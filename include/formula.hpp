@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fixed_point.hpp"
+
+/**
+ *  Registry of the iterated formulas. A formula is never a runtime switch inside the
+ *  iteration loop: the shaders get it as #defines (see shaderDefines()) and are compiled
+ *  once per formula, the CPU kernels are instantiated per formula and exponent.
+ *
+ *      Mandelbrot     z = z^power + c,                  z_0 = 0
+ *      Burning Ship   z = (|Re z| + i |Im z|)^2 + c,    z_0 = 0
+ *      Julia          z = z^power + julia,              z_0 = pixel
+ */
+enum class FormulaKind
+{
+	Mandelbrot,
+	BurningShip,
+	Julia
+};
+
+// exponents the kernels are instantiated for
+const int minimumPower = 2;
+const int maximumPower = 6;
+
+struct Formula
+{
+	FormulaKind kind = FormulaKind::Mandelbrot;
+	// the Burning Ship is always quadratic
+	int power = 3;
+	// constant of the Julia set
+	HighPrecision juliaX, juliaY;
+
+	// "mandelbrot:3", "burning-ship" or "julia:2", see parseFormula()
+	std::string name() const;
+	// #define lines that select this formula in the iteration shader
+	std::string shaderDefines() const;
+	// Only the analytic Mandelbrot family is approximated by a series in deltaC, the
+	// others start every pixel at iteration 0.
+	bool hasSeries() const { return kind == FormulaKind::Mandelbrot; }
+
+	bool operator==(const Formula& rhs) const
+	{
+		return kind == rhs.kind && power == rhs.power && juliaX == rhs.juliaX && juliaY == rhs.juliaY;
+	}
+	bool operator!=(const Formula& rhs) const { return !(*this == rhs); }
+};
+
+// Parses "mandelbrot[:power]", "burning-ship" or "julia[:power]", a Julia set starts at a
+// preset constant for its power. Returns false on anything else.
+bool parseFormula(const std::string& text, Formula& formula);
+
+// Formulas the viewer cycles through.
+const std::vector<Formula>& formulaPresets();
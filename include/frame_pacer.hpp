@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ *  Sizes the iterations per pass so that a frame takes about targetMilliseconds on the GPU.
+ *  The GPU times come from FrameProfiler a few frames late, so every update() names the
+ *  budget the measured frame ran with. The cost of an iteration step is smoothed over the
+ *  last frames and the budget moves by at most a factor of two per frame, which keeps it
+ *  from oscillating when the running pixels, and with them the cost, change quickly.
+ */
+class FramePacer
+{
+public:
+	static constexpr int minimumIterations = 16;
+	static constexpr int maximumIterations = 1 << 16;
+
+	FramePacer(double targetMilliseconds, int initialIterations);
+
+	// Frames that iterated with iterationsPerPass took iterateMilliseconds for that and
+	// otherMilliseconds for everything else, coloring and presenting.
+	void update(int iterationsPerPass, double iterateMilliseconds, double otherMilliseconds);
+	int iterationsPerPass() const { return m_IterationsPerPass; }
+	double targetMilliseconds() const { return m_TargetMilliseconds; }
+
+private:
+	double m_TargetMilliseconds;
+	int m_IterationsPerPass;
+	// milliseconds per iteration of a pass, 0 until the first measurement
+	double m_Cost = 0.0;
+	double m_OtherMilliseconds = 0.0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+class ProgressiveRenderer;
+
+// Passes of a frame whose GPU time is measured separately.
+enum class ProfilePass
+{
+	Iterate,
+	Preview,
+	Colorize,
+	Supersample,
+	Readback,
+	Present
+};
+const int profilePassCount = 6;
+
+const char* profilePassName(ProfilePass pass);
+
+/**
+ *  GPU timings of the passes of every frame. begin() and end() put GL_TIMESTAMP queries
+ *  around a pass, and the queries of a frame are read latency frames later from a ring, by
+ *  which time the GPU is done with them, so profiling does not stall the pipeline. A pass
+ *  that runs several times in a frame adds up. countIterations() adds the iterations the
+ *  compute kernel counted with atomics to the frame the same way.
+ *
+ *  The timer queries need GL 3.3, without them only the CPU frame times are recorded. The
+ *  last historyFrames frames feed the overlay; with recordTrace every frame is also kept
+ *  for writeTrace().
+ */
+class FrameProfiler
+{
+public:
+	// frames between issuing the queries of a frame and reading them back
+	static constexpr int latency = 4;
+	static constexpr int historyFrames = 240;
+	// renderers that may count their iterations in a single frame
+	static constexpr int maximumCounters = 4;
+
+	struct Event
+	{
+		ProfilePass pass;
+		// milliseconds since the first frame on the GPU clock
+		double start, end;
+	};
+
+	struct Frame
+	{
+		int index = 0;
+		// wall time from beginFrame() to endFrame(), milliseconds since the first frame
+		double cpuStart = 0.0, cpuMilliseconds = 0.0;
+		// GPU time from beginFrame() to endFrame() and the sum of every pass
+		double gpuStart = 0.0, gpuMilliseconds = 0.0;
+		double passMilliseconds[profilePassCount] = {};
+		// iterations of the compute kernels, or -1 if nothing was counted
+		std::int64_t iterations = -1;
+		std::vector<Event> events;
+	};
+
+	explicit FrameProfiler(bool recordTrace = false);
+	~FrameProfiler();
+
+	FrameProfiler(const FrameProfiler&) = delete;
+	FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+	static bool timerQueriesAvailable();
+
+	// Passes may only be timed between beginFrame() and endFrame(), one at a time.
+	void beginFrame();
+	void begin(ProfilePass pass);
+	void end(ProfilePass pass);
+	void countIterations(ProgressiveRenderer& renderer);
+	void endFrame();
+	// index of the frame begun last, Frame::index once it is resolved
+	int frameIndex() const { return m_FrameIndex - 1; }
+	// Reads back every frame still in flight, waiting for the GPU.
+	void flush();
+
+	// oldest first
+	const std::deque<Frame>& history() const { return m_History; }
+	// Averages of the last frames of the history, for a printed summary. Frames whose
+	// iterations were not counted leave iterations at -1.
+	Frame average(int frames) const;
+	// Every recorded frame as CSV if path ends in .csv, otherwise as a JSON trace in the
+	// Chrome trace event format that chrome://tracing and Perfetto open.
+	bool writeTrace(const std::string& path) const;
+	// Stacked bars of the GPU time of every pass over the history, in the bottom left corner
+	// of the default framebuffer of the given size. A line marks 60 frames per second.
+	void drawOverlay(int width, int height);
+
+private:
+	struct PendingEvent
+	{
+		ProfilePass pass;
+		int begin, end;
+	};
+
+	struct Slot
+	{
+		// the first two are the frame's own begin and end
+		std::vector<GLuint> queries;
+		int usedQueries = 0;
+		std::vector<PendingEvent> events;
+		// { low, high } per countIterations() call
+		GLuint counters = 0;
+		int usedCounters = 0;
+		Frame frame;
+		bool pending = false;
+	};
+
+	int query(Slot& slot);
+	void resolve(Slot& slot);
+
+	bool m_TimerQueries;
+	bool m_RecordTrace;
+	std::vector<Slot> m_Slots;
+	int m_Current = 0;
+	int m_FrameIndex = 0;
+	int m_OpenEvent = -1;
+
+	std::chrono::steady_clock::time_point m_CpuOrigin, m_FrameStart;
+	GLuint64 m_GpuOrigin = 0;
+	bool m_GpuOriginKnown = false;
+
+	std::deque<Frame> m_History;
+	std::vector<Frame> m_Trace;
+
+	// cumulative milliseconds of the passes per history frame, read by the overlay program
+	GLuint m_OverlayTexture = 0;
+	GLuint m_OverlayProgram = 0;
+	std::vector<float> m_OverlayTexels;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+/**
+ *  Glitch detection shared by the GPU and CPU kernels. Rebasing onto the start of the orbit
+ *  keeps the deltas of the Mandelbrot style formulas small, but Julia orbits do not start at
+ *  0 and can only rebase once the reference runs out. A Julia pixel whose orbit passes much
+ *  closer to 0 than the reference's then holds its value as the difference of two large
+ *  numbers, and everything float keeps of it is rounding noise: the pixel no longer tracks
+ *  the reference. Pauldelbrot's criterion catches that moment, |z| falling far below |Z|.
+ *  Such pixels stop and are marked, and the renderers iterate them again with a reference
+ *  placed inside the glitched region, until none are left or the references run out.
+ */
+
+// Squared ratio |z| / |Z| below which a pixel counts as glitched.
+const float glitchTolerance = 1e-6f;
+// references per view, the primary one included; pixels still glitched after the last one
+// are iterated once more with the test off and finish like before glitch detection
+const int maximumReferences = 16;
+
+// Picks the pixel for the next reference among those marked in glitched (width * height,
+// either row order): the one farthest from any clean pixel, which lies deep inside the
+// largest glitched region, where its orbit stays close to those of its neighbours. Returns
+// false if no pixel is marked.
+bool pickGlitchReference(const std::vector<unsigned char>& glitched, int width, int height, int& x, int& y);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ *  A headless GL context on one GPU. GLFW always creates its context on the default device,
+ *  so the offline renderers reach the other GPUs of a machine through EGL_EXT_device_enumeration
+ *  and EGL_EXT_platform_device instead. Windows has no portable way to put an OpenGL context
+ *  on a chosen GPU, there openGpuDevices() finds nothing and rendering stays on one device.
+ *
+ *  glad is loaded from the first context and shared by all of them, which assumes the GPUs
+ *  of a node come from one driver.
+ */
+class GpuDevice
+{
+public:
+	~GpuDevice();
+
+	GpuDevice(const GpuDevice&) = delete;
+	GpuDevice& operator=(const GpuDevice&) = delete;
+
+	// Binds the context to the calling thread, it can only be current on one thread at a time.
+	bool makeCurrent() const;
+	void release() const;
+
+	// GL_RENDERER of the context
+	const std::string& name() const { return m_Name; }
+
+private:
+	friend int openGpuDevices(int count);
+
+	GpuDevice() = default;
+
+	// EGLDisplay, EGLSurface and EGLContext, which are all pointers
+	void* m_Display = nullptr;
+	void* m_Surface = nullptr;
+	void* m_Context = nullptr;
+	std::string m_Name;
+};
+
+// Opens a context on up to count GPUs, every one if count is 0, and returns how many were
+// opened. Software devices such as llvmpipe are skipped. None of the contexts is current
+// afterwards.
+int openGpuDevices(int count);
+const std::vector<std::unique_ptr<GpuDevice>>& gpuDevices();
+void closeGpuDevices();
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ *  Histogram coloring. The smooth values of the escaped pixels are binned between their
+ *  minimum and maximum, and a pixel is colored by the fraction of escaped pixels below it
+ *  instead of by smooth / colorPeriod. Every color of the palette then covers about as many
+ *  pixels, however closely the iteration counts bunch up at deep zooms.
+ *
+ *  The GPU builds the histogram with compute shaders (a min / max reduction, a binning pass
+ *  with work group local counts and a prefix sum, see ProgressiveRenderer); this is the same
+ *  computation for the CPU backend.
+ *
+ *  Offline renders build the histogram once from a preview of the whole image, at most
+ *  histogramPreviewSize pixels on the long edge, and color every tile from it, so that tiles
+ *  on any backend, worker or GPU agree on the colors.
+ */
+const int histogramBins = 4096;
+const int histogramPreviewSize = 1024;
+
+struct Histogram
+{
+	float minimum = 0.0f, maximum = 0.0f;
+	// cumulative fraction of the escaped pixels up to the end of every bin
+	std::vector<float> cdf;
+};
+
+// smooth holds count values, NaN for pixels that did not escape.
+Histogram buildHistogram(const float* smooth, std::size_t count);
+// Palette position of an escaped pixel in [0…1], interpolated inside its bin.
+float histogramPosition(const Histogram& histogram, float smooth);
@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ *  Limits of the interior shortcuts shared by the GPU and CPU kernels. Both tests work on
+ *  the full value c or z in float, so they are only used while float still resolves a
+ *  fraction of a pixel; deeper views just iterate to the cap as before.
+ */
+
+// Epsilon of the periodicity check for the given pixel size, 0 turns the check off.
+inline float periodicityEpsilon(double pixelSize)
+{
+	// orbits coming back within this fraction of a pixel count as a cycle
+	const double tolerance = 0.01;
+	// float z near the unit circle carries rounding noise of about 1e-7
+	const double minimumEpsilon = 1e-6;
+
+	const double epsilon = tolerance * pixelSize;
+	return epsilon >= minimumEpsilon ? static_cast<float>(epsilon) : 0.0f;
+}
+
+// The cardioid / period 2 bulb test of the quadratic set needs c itself in float.
+inline bool cardioidTestUsable(double pixelSize)
+{
+	return pixelSize >= 1e-5;
+}
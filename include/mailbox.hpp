@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ *  Hands the latest value from one producer thread to one consumer thread through three
+ *  slots: the producer writes its own slot and swaps it with the shared middle one, the
+ *  consumer swaps the middle slot with the one it reads. Neither side ever waits for the
+ *  other or sees a half written value, and values the consumer did not get to in time are
+ *  simply replaced. The mutex only serves wait(), publish() and take() never lock it.
+ */
+template <typename T>
+class Mailbox
+{
+public:
+	Mailbox() = default;
+
+	Mailbox(const Mailbox&) = delete;
+	Mailbox& operator=(const Mailbox&) = delete;
+
+	// Producer only.
+	void publish(const T& value)
+	{
+		m_Slots[m_Back] = value;
+		m_Back = m_Middle.exchange(m_Back | fresh, std::memory_order_acq_rel) & slotMask;
+		// an empty critical section, so a consumer between its check and its wait is woken
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+		}
+		m_Updated.notify_one();
+	}
+
+	// Consumer only. Copies the newest value into value, false if nothing was published
+	// since the last take().
+	bool take(T& value)
+	{
+		if (!pending())
+			return false;
+		m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & slotMask;
+		value = m_Slots[m_Front];
+		return true;
+	}
+
+	// True if take() would return a newer value.
+	bool pending() const { return (m_Middle.load(std::memory_order_acquire) & fresh) != 0; }
+
+	// Consumer only. Sleeps until a value is pending.
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Updated.wait(lock, [this] { return pending(); });
+	}
+
+private:
+	static constexpr int slotMask = 3;
+	static constexpr int fresh = 4;
+
+	T m_Slots[3];
+	// the producer's slot, the shared one with the fresh bit and the consumer's slot
+	int m_Back = 0;
+	std::atomic<int> m_Middle { 1 };
+	int m_Front = 2;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Updated;
+};
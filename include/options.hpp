@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+
+#include "camera.hpp"
+#include "delta_precision.hpp"
+#include "formula.hpp"
+
+/**
+ *  Command line options. Without --output the interactive viewer starts at the given view.
+ *
+ *      --center-x <decimal>   --center-y <decimal>   view center, full precision
+ *      --scale <double>       half of the view height in complex units
+ *      --iterations <int>     iteration cap
+ *      --width <int>          --height <int>         output size in pixels
+ *      --tile <int>           tile size of the offline renderer
+ *      --output <file.png>    render offline into this file instead of opening a window
+ *      --sequence <file>      render the keyframed camera path in file, --output is then
+ *                             "-" for raw RGB frames on stdout or a printf pattern such as
+ *                             frame_%05d.png
+ *      --backend <gpu|cpu>    renderer of the offline modes, gpu falls back to cpu when no
+ *                             GL context can be created
+ *      --threads <int>        worker threads of the cpu backend, 0 uses every core
+ *      --interior <on|off>    cardioid / bulb test and periodicity checking, I toggles it
+ *                             in the viewer
+ *      --boundary-tracing <on|off>  Mariani-Silver subdivision of the cpu backend
+ *      --kernel <compute|fragment>  gpu iteration kernel, compute needs GL 4.3 and falls
+ *                             back to fragment without it
+ *      --work-group <int>     edge length of the compute kernel's square work groups
+ *      --optimized-kernel <on|off>  strength reduced escape test of the gpu kernels
+ *      --precision <auto|float|double-float|double|extended>  number format of the gpu kernels'
+ *                             deltas, see delta_precision.hpp; auto switches to double
+ *                             below minimumFloatScale where the GPU has fp64
+ *      --formula <name>       mandelbrot[:power], burning-ship or julia[:power], see
+ *                             formula.hpp; M cycles through the presets in the viewer
+ *      --julia-x <decimal>    --julia-y <decimal>    constant of a Julia formula, only with it
+ *      --palette <name>       hsv, fire, ocean or grayscale, see palette.hpp; P cycles
+ *                             through them in the viewer and C cycles the colors
+ *      --palette-offset <float>  shift of the palette in cycles
+ *      --coloring <linear|histogram>  palette position from smooth / period or from the
+ *                             histogram of the image, see histogram.hpp; H toggles it in
+ *                             the viewer. Offline tiles share the histogram of a preview.
+ *      --antialias <int>      subsamples per axis of the adaptive supersampling of the gpu
+ *                             backend, only pixels near the boundary are refined, 1 is off
+ *      --vsync <on|off>       wait for the display refresh between frames in the viewer;
+ *                             off shows every frame as soon as it is done, for benchmarks
+ *      --frame-time <ms>      size the iterations per pass so that a viewer frame takes
+ *                             about this long on the GPU, see frame_pacer.hpp; 0 iterates a
+ *                             fixed amount per frame
+ *      --pyramid <on|off>     explore through a pyramid of fixed size tiles per zoom level
+ *                             instead of rendering the whole view, see tile_pyramid.hpp
+ *      --tile-cache <dir>     look finished tiles up in dir before iterating them and store
+ *                             the ones that were iterated, see tile_cache.hpp; the viewer
+ *                             caches whole views
+ *      --farm-listen <port>   split the offline render into tiles or frames and hand them
+ *                             to workers that connect on port, see farm.hpp
+ *      --farm-worker <host:port>  render pieces for the coordinator at host:port until it
+ *                             is done, with the backend of --backend
+ *      --gpus <int>           GPUs of the gpu backend in the offline modes, 0 uses every one;
+ *                             more than one deals tiles or frames to them as they finish,
+ *                             see gpu_devices.hpp
+ *      --shader-cache <dir>   keep linked program binaries in dir so that later launches
+ *                             skip compiling, see setProgramBinaryDirectory() in shader.hpp
+ *      --profile <file>       GPU time of every pass per viewer frame or offline tile, see
+ *                             frame_profiler.hpp; CSV if file ends in .csv, otherwise a JSON
+ *                             trace. T shows the timings as an overlay in the viewer.
+ */
+enum class Backend
+{
+	Gpu,
+	Cpu
+};
+
+struct Options
+{
+	Camera camera;
+	Formula formula;
+	int palette = 0;
+	float paletteOffset = 0.0f;
+	bool histogramColoring = false;
+	int antialias = 1;
+	int maxIterations = 100;
+	bool interiorDetection = true;
+
+	std::string output;
+	int width = 512, height = 512;
+	int tileSize = 1024;
+
+	std::string sequence;
+
+	Backend backend = Backend::Gpu;
+	int threads = 0;
+	bool boundaryTracing = true;
+
+	bool computeKernel = true;
+	int workGroupSize = 8;
+	bool optimizedKernel = true;
+	DeltaPrecision deltaPrecision = DeltaPrecision::Automatic;
+
+	bool pyramid = false;
+	std::string tileCache;
+
+	int farmPort = 0;
+	std::string farmCoordinator;
+	int gpus = 1;
+
+	std::string shaderCache;
+	std::string profile;
+	bool vsync = true;
+	double frameTime = 0.0;
+
+	bool batch() const { return !output.empty(); }
+	bool animation() const { return !sequence.empty(); }
+	bool farmWorker() const { return !farmCoordinator.empty(); }
+	// pieces go through the farm queue, to remote workers or to several local GPUs
+	bool distributed() const { return farmPort != 0 || gpus > 1; }
+};
+
+// Exits with a usage message on malformed arguments.
+Options parseOptions(int argc, char* argv[]);
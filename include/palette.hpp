@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ *  Cyclic color palettes. The coloring passes look colors up in a table of paletteSize
+ *  entries at smooth / colorPeriod + offset, wrapping around, so changing the palette or
+ *  its offset never needs the pixels to be iterated again.
+ */
+const int paletteSize = 1024;
+
+struct Palette
+{
+	const char* name;
+	// colors spread evenly around the cycle, the last one blends back into the first
+	std::vector<std::array<float, 3>> stops;
+};
+
+// The first one is the hue wheel the renderer always used.
+const std::vector<Palette>& palettes();
+// Index of the palette called name, -1 if there is none.
+int findPalette(const std::string& name);
+
+// paletteSize RGBA8 entries, entry i samples the palette at (i + 0.5) / paletteSize. This
+// is the layout of the lookup texture.
+std::vector<unsigned char> paletteTable(int palette);
+// Linear lookup with wrap around, like the GL_LINEAR / GL_REPEAT texture.
+std::array<float, 3> samplePalette(const std::vector<unsigned char>& table, float position);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ *  Streams an 8-bit RGB PNG to disk a few rows at a time, so images far larger than memory
+ *  can be written. There is no zlib in vendor/, so the image data uses uncompressed
+ *  ("stored") deflate blocks, which every decoder reads but which is as large as raw RGB.
+ */
+class PngWriter
+{
+public:
+	PngWriter() = default;
+	~PngWriter();
+
+	PngWriter(const PngWriter&) = delete;
+	PngWriter& operator=(const PngWriter&) = delete;
+
+	bool open(const std::string& path, int width, int height);
+	// rgb holds rows * width tightly packed pixels, top row first.
+	bool writeRows(const unsigned char* rgb, int rows);
+	bool close();
+
+private:
+	void writeChunk(const char* type, const unsigned char* data, std::size_t size);
+
+	std::FILE* m_File = nullptr;
+	int m_Width = 0, m_Height = 0, m_RowsWritten = 0;
+	uint32_t m_Adler = 1;
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "camera.hpp"
+#include "delta_precision.hpp"
+#include "formula.hpp"
+#include "glitch_detection.hpp"
+#include "histogram.hpp"
+#include "reference_orbit.hpp"
+#include "render_target.hpp"
+#include "series_approximation.hpp"
+
+// Pipeline that iterates the pixels. The compute kernel needs GL 4.3, without it the
+// renderer quietly uses the fragment kernel, which only needs GL 3.3.
+enum class IterationKernel
+{
+	Fragment,
+	Compute
+};
+
+/**
+ *  Perturbation renderer that keeps the iteration state of every pixel in float textures.
+ *  Each call to iterate() continues the pixels that have not escaped yet for another
+ *  iterationsPerPass iterations, so the image refines over several frames while the cost
+ *  of a single frame stays bounded. Raising the iteration cap continues from where the
+ *  previous cap stopped instead of starting over. The iterated formula is compiled into the
+ *  programs, see formula.hpp.
+ *
+ *  Pixels sit on a grid anchored at the reference point, so panning by whole pixels only
+ *  shifts the stored state and computes the newly exposed strips.
+ *
+ *  The compute kernel runs one work group per square tile. Tiles whose pixels are all
+ *  resolved drop out of a list that feeds the next indirect dispatch, so late passes only
+ *  cost as much as the pixels that are still running.
+ */
+class ProgressiveRenderer
+{
+public:
+	static constexpr double bailout = 64.0;
+	// must not exceed MAX_SERIES_TERMS in the iteration shader
+	static constexpr int seriesTerms = 8;
+	// floats per pixel of readResult()
+	static constexpr int resultChannels = 3;
+
+	explicit ProgressiveRenderer(IterationKernel kernel = IterationKernel::Fragment, int workGroupSize = 8);
+	~ProgressiveRenderer();
+
+	ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+	ProgressiveRenderer& operator=(const ProgressiveRenderer&) = delete;
+
+	void resize(int width, int height);
+	void setCamera(const Camera& camera);
+	void setMaxIterations(int maxIterations);
+	// Restarts with another formula. Its programs come from the program cache, so this
+	// only compiles the first time a formula is used, see prepare().
+	void setFormula(const Formula& formula);
+	// Compiles the programs of formula into the cache ahead of time.
+	void prepare(const Formula& formula) const;
+	// The optimized kernel escapes on |z|^2 against the squared bailout instead of taking a
+	// square root every iteration, with the same results as the plain one. It is the
+	// default, bench/kernel_benchmark.cpp compares the two.
+	void setOptimizedKernel(bool optimized);
+
+	// Runs one pass over the whole view.
+	void iterate();
+	// Colors the current state into the target's first attachment as seen from view, which
+	// reprojects the state if it was rendered for a different camera. Pixels outside our
+	// view, and unresolved ones if discardUnresolved, are left untouched. This is a single
+	// palette lookup per pixel, so recoloring a finished state is cheap.
+	void colorize(const RenderTarget& target, const Camera& view, bool discardUnresolved) const;
+	// Index into palettes(), uploaded as the lookup texture of colorize().
+	void setPalette(int palette);
+	// Carries the derivative through the iteration and stores a distance estimate for every
+	// escaped pixel, which supersample() uses to find the boundary. Costs an extra state
+	// attachment and a complex multiply per iteration, so it is off by default. Restarts.
+	void setDistanceEstimation(bool distanceEstimation);
+	// Adaptive antialiasing of a finished state that was colored into target at the same
+	// camera and size: only pixels near the boundary by the distance estimate, or whose color
+	// differs strongly from a neighbour's, are iterated again at samples^2 subsamples and
+	// replaced by their average color. With GL 4.3 the pixels are compacted into a list first
+	// and every subsample is one compute invocation. Returns the number of refined pixels,
+	// which waits for the pass. At most 8 samples per axis.
+	std::uint64_t supersample(const RenderTarget& target, int samples);
+	// Colors by the histogram of the smooth values instead of smooth / colorPeriod, see
+	// histogram.hpp. The histogram is rebuilt on the GPU after every pass, so this needs
+	// GL 4.3 and stays off without it.
+	void setHistogramColoring(bool histogram);
+	// Colors with this histogram instead of one of the own pixels from now on, so that the
+	// tiles of a larger image all share the histogram of the whole image. An empty CDF goes
+	// back to building it after every pass.
+	void setHistogram(const Histogram& histogram);
+	// Reads the current histogram back, which waits for the GPU.
+	Histogram histogram() const;
+	// Number format of the perturbation deltas, see delta_precision.hpp. Automatic switches to
+	// fp64 once the scale drops below minimumFloatScale, which restarts anyway. Both precise
+	// formats need GL 4.0, without it the renderer stays at float. Restarts.
+	void setDeltaPrecision(DeltaPrecision precision);
+	static bool deltaPrecisionAvailable(DeltaPrecision precision);
+	// Deepest scale the renderer resolves with precision on this context.
+	static double minimumScale(DeltaPrecision precision);
+
+	// True once every pixel has either escaped or reached the iteration cap. Julia views
+	// then go over their glitched pixels with more references first, see glitch_detection.hpp.
+	bool isComplete() const;
+	// references the current state used so far, the primary one included
+	int references() const { return m_References; }
+	// True if the next pass starts the view over, which is when a cached result can
+	// stand in for it, see tile_cache.hpp.
+	bool restarting() const { return m_Reset; }
+
+	// Copies smooth value, status and distance or periodicity checkpoint of every pixel of
+	// a complete state, resultChannels floats per pixel from the bottom row up. Returns
+	// false while the state is incomplete.
+	bool readResult(std::vector<float>& result) const;
+	// Makes a result read back at the same camera, size, formula and cap the complete state
+	// without iterating. The deltas are not part of it, so raising the cap restarts.
+	bool restoreResult(const std::vector<float>& result);
+	// names what readResult() returns in a TileKey, the third channel depends on the
+	// distance estimation
+	const char* resultLayout() const { return m_DistanceEstimation ? "gpu-result-distance" : "gpu-result"; }
+
+	IterationKernel kernel() const { return m_Kernel; }
+	bool optimizedKernel() const { return m_OptimizedKernel; }
+	// Pixels that were still running after the last compute pass, counted with atomics on
+	// the GPU. This waits for the pass to finish; the fragment kernel always reports 0.
+	unsigned int runningPixels() const;
+	// Iterations done past the series skip, summed over every pixel. Reads the whole state
+	// back, so this is for benchmarks only.
+	std::uint64_t iterationCount() const;
+	// Copies the iterations the compute kernel counted with atomics since the last call, as
+	// a 64 bit { low, high } pair of uints, into buffer at offset and counts from 0 again.
+	// Nothing waits for the GPU, see frame_profiler.hpp. The fragment kernel does not count
+	// and returns false.
+	bool takeIterationCount(GLuint buffer, GLintptr offset);
+
+	const Formula& formula() const { return m_Formula; }
+	int palette() const { return m_Palette; }
+	bool histogramColoring() const { return m_HistogramColoring; }
+	bool distanceEstimation() const { return m_DistanceEstimation; }
+	// the format the current state was iterated in, never Automatic
+	DeltaPrecision deltaPrecision() const { return m_Precision; }
+	// the format the next restart iterates the current camera in, which keys cached results
+	DeltaPrecision selectPrecision() const;
+	const Camera& camera() const { return m_Camera; }
+	int maxIterations() const { return m_MaxIterations; }
+	int width() const { return m_State[0].width(); }
+	int height() const { return m_State[0].height(); }
+
+	int iterationsPerPass = 256;
+	// stop early on pixels found inside the set, see interior_detection.hpp
+	bool interiorDetection = true;
+	// iterations per cycle of the palette
+	float colorPeriod = 100.0f;
+	// shifts the palette by this fraction of a cycle, for color cycling
+	float paletteOffset = 0.0f;
+	// supersample() refines escaped pixels whose distance estimate is below this many
+	// pixels, and pixels that differ from a neighbour by more than this in a color channel
+	float supersampleDistance = 1.0f;
+	float supersampleColorDifference = 0.1f;
+
+private:
+	std::string programDefines(const Formula& formula, bool distanceEstimation) const;
+	// defines and texts of the iteration for m_Precision, behind the #version line
+	std::string iterationSource(const Formula& formula, bool distanceEstimation) const;
+	const char* fragmentVersion() const;
+	// distance estimation only runs on float deltas
+	bool estimatesDistance() const { return m_DistanceEstimation && m_Precision == DeltaPrecision::Float; }
+	void selectPrograms();
+	// re-anchors the pixel grid at the camera and picks the delta format of the new view
+	void restartGrid();
+	void updateReference();
+	void uploadOrbit(const ReferenceOrbit& orbit);
+	// the reference of the current glitch round, m_Orbit in the first one
+	const ReferenceOrbit& referenceOrbit() const { return m_References > 1 ? m_GlitchOrbit : m_Orbit; }
+	void resetGlitchRounds();
+	// Starts the next glitch round of a finished state, returns false if nothing glitched.
+	bool retryGlitches();
+	void updateSeries();
+	void setIterateUniforms(GLuint program) const;
+	void iterateFragment();
+	void iterateCompute(bool fullPass);
+	void buildHistogram();
+
+	GLuint m_IterateProgram = 0, m_ColorProgram = 0;
+	GLuint m_ComputeProgram = 0;
+	IterationKernel m_Kernel;
+	int m_WorkGroupSize;
+	bool m_OptimizedKernel = true;
+
+	// compute kernel: tile lists { indirect group count x, y, z, tile indices... }, the
+	// active one feeds the next in-place pass and the other one collects running tiles
+	GLuint m_TileLists[2] = { 0, 0 };
+	int m_ActiveList = 0;
+	int m_TilesX = 0, m_TileCount = 0;
+	bool m_TileListStale = true;
+	// { running pixels, running tiles } of the last compute pass, { low, high } of the
+	// iterations since the last takeIterationCount() and the glitched pixels of the round
+	GLuint m_StatisticsBuffer = 0;
+	GLuint m_OrbitBuffer = 0, m_OrbitTexture = 0;
+	// the precise kernels read the orbit with its residuals, see updateReference()
+	bool m_OrbitFormatStale = false;
+	GLuint m_PaletteTexture = 0;
+	int m_Palette = 0;
+	// range, bins and CDF of histogram coloring, built by the three passes of programs
+	GLuint m_HistogramBuffer = 0;
+	GLuint m_HistogramPrograms[3] = { 0, 0, 0 };
+	GLuint m_HistogramColorProgram = 0;
+	bool m_HistogramColoring = false;
+	// the buffer holds a histogram given to setHistogram(), which passes must not rebuild
+	bool m_SharedHistogram = false;
+	bool m_DistanceEstimation = false;
+	DeltaPrecision m_RequestedPrecision = DeltaPrecision::Automatic;
+	DeltaPrecision m_Precision = DeltaPrecision::Float;
+	// pixels supersample() refines, see supersample_list_text
+	GLuint m_RefineList = 0;
+	GLsizeiptr m_RefineListSize = 0;
+
+	// ping-pong pair of { RGBA32F delta.xy / reference iteration / iteration,
+	// RGBA32F smooth value / escaped, interior or glitched / periodicity checkpoint or distance,
+	// RG32F derivative if distance estimation is on, or RGBA32UI bits of the precise delta }
+	RenderTarget m_State[2];
+	int m_Current = 0;
+
+	Formula m_Formula;
+	Camera m_Camera;
+	int m_MaxIterations = 100;
+	ReferenceOrbit m_Orbit;
+	SeriesApproximation m_Series;
+	std::vector<float> m_SeriesCoefficients;
+
+	// view center relative to the reference, in pixels of m_PixelSize
+	int m_PixelOffset[2] = { 0, 0 };
+	double m_PixelSize[2] = { 0.0, 0.0 };
+	double m_GridScale = 0.0;
+	// how far the view moved since the last pass, applied to the stored state
+	int m_PendingShift[2] = { 0, 0 };
+
+	bool m_Reset = true;
+	// the state came from restoreResult() instead of iterating
+	bool m_Restored = false;
+	// every running pixel has done at least this many iterations
+	int m_CompletedIterations = 0;
+
+	// glitch rounds: the reference of the current one and where it sits relative to m_Orbit,
+	// in pixels of m_PixelSize
+	ReferenceOrbit m_GlitchOrbit;
+	double m_GlitchOffset[2] = { 0.0, 0.0 };
+	int m_References = 1;
+	// glitched pixels when the current round started, the rounds stop once that stops dropping
+	std::size_t m_GlitchedPixels = 0;
+	// 0 in the last round, which finishes the pixels no reference fixed without the test
+	float m_GlitchTolerance = glitchTolerance;
+	// restart the glitched pixels in the next pass
+	bool m_RetryGlitched = false;
+};
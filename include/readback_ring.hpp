@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+ *  Ring of pixel pack buffers for asynchronous glReadPixels. start() queues a read into
+ *  the next free buffer and fences it; finish() waits for the oldest read and copies it
+ *  out, by which time the GPU has usually long finished it.
+ */
+class ReadbackRing
+{
+public:
+	ReadbackRing(int slots, std::size_t slotBytes);
+	~ReadbackRing();
+
+	ReadbackRing(const ReadbackRing&) = delete;
+	ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+	bool full() const { return m_Pending == static_cast<int>(m_Slots.size()); }
+	bool empty() const { return m_Pending == 0; }
+
+	// Reads RGB from the first attachment of framebuffer, tag identifies it in finish().
+	void start(GLuint framebuffer, int width, int height, int tag);
+	// Waits for the oldest read and copies its pixels out, returns its tag.
+	int finish(std::vector<unsigned char>& pixels);
+
+private:
+	struct Slot
+	{
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		std::size_t capacity = 0, bytes = 0;
+		int tag = 0;
+	};
+
+	std::vector<Slot> m_Slots;
+	int m_Oldest = 0, m_Pending = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "fixed_point.hpp"
+#include "formula.hpp"
+
+/**
+ *  High precision orbit of a single reference point, used by the perturbation renderer.
+ *  Every pixel then only iterates its (small) difference to this orbit in float.
+ */
+struct ReferenceOrbit
+{
+	// Z_0 ... Z_n interleaved as x, y (rounded to float for the GPU)
+	std::vector<float> points;
+	// what the rounding to float left off every coordinate, for the double-float and fp64
+	// kernels, see delta_precision.hpp
+	std::vector<float> residuals;
+	HighPrecision centerX, centerY;
+	Formula formula;
+	// limbs of the fixed point the orbit is iterated in, see referenceLimbs()
+	int limbs = 6;
+
+	// full precision Z_n so the orbit can be extended when the iteration cap grows
+	HighPrecision lastX, lastY;
+	bool escaped = false;
+
+	int length() const { return static_cast<int>(points.size() / 2); }
+};
+
+// Limbs of the fixed point an orbit for a view of this scale needs. Shallow views iterate in
+// far fewer than HighPrecision has, a product costs the square of the limbs.
+int referenceLimbs(double scale);
+
+// Iterates the formula at the reference point in high precision until |z| > bailout or
+// maxIterations is reached. Z_0 is 0, or the reference point itself for Julia sets. The
+// scale of the view picks the precision.
+ReferenceOrbit computeReferenceOrbit(
+	const HighPrecision& centerX, const HighPrecision& centerY,
+	const Formula& formula, double scale, int maxIterations, double bailout);
+
+// Continues an orbit that stopped at a lower iteration cap.
+void extendReferenceOrbit(ReferenceOrbit& orbit, int maxIterations, double bailout);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+ *  Offscreen framebuffer with one texture per color attachment, all the same size.
+ *  Textures use nearest filtering so they can double as per-pixel storage.
+ */
+class RenderTarget
+{
+public:
+	RenderTarget() = default;
+	~RenderTarget();
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	// (Re)allocates the attachments, returns false if nothing had to change.
+	bool resize(int width, int height, std::initializer_list<GLenum> formats);
+	void destroy();
+
+	// Binds the framebuffer for drawing into all attachments and sets the viewport.
+	void bind() const;
+	void blitToScreen(int screenWidth, int screenHeight) const;
+
+	GLuint framebuffer() const { return m_Framebuffer; }
+	GLuint texture(int attachment) const { return m_Textures[attachment]; }
+	int width() const { return m_Width; }
+	int height() const { return m_Height; }
+
+private:
+	GLuint m_Framebuffer = 0;
+	std::vector<GLuint> m_Textures;
+	std::vector<GLenum> m_Formats;
+	int m_Width = 0, m_Height = 0;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+#include "options.hpp"
+
+/**
+ *  One line of a sequence file: "<frame> <center x> <center y> <scale>".
+ *  Between keyframes the center is interpolated linearly and the scale geometrically,
+ *  so the zoom speed stays constant. Empty lines and lines starting with # are skipped.
+ */
+struct Keyframe
+{
+	int frame = 0;
+	Camera camera;
+};
+
+// Returns an empty list (after printing why) if the file can not be read.
+std::vector<Keyframe> loadKeyframes(const std::string& path);
+Camera interpolateKeyframes(const std::vector<Keyframe>& keyframes, int frame);
+
+// Renders every frame of options.sequence at options.width x options.height into options.output.
+bool renderSequence(const Options& options);
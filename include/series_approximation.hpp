@@ -0,0 +1,27 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "reference_orbit.hpp"
+
+/**
+ *  Truncated power series in the pixel offset u (deltaC = deltaScale * u) that predicts the
+ *  perturbation delta after skipIterations iterations:
+ *      delta_skip = sum_{k=1}^{K} coefficients[k - 1] * u^k
+ *  Every pixel on screen shares these iterations, so the shader starts from there.
+ */
+struct SeriesApproximation
+{
+	int skipIterations = 0;
+	std::vector<std::complex<double>> coefficients;
+};
+
+// Advances the series along the reference orbit until it no longer matches directly
+// iterated probe points on the border of the view viewCenter +- viewRadius (in units of u,
+// per component) within a relative tolerance. Formulas without a series (see
+// Formula::hasSeries()) get the plain start delta_0 at iteration 0 in the same form.
+SeriesApproximation computeSeriesApproximation(
+	const ReferenceOrbit& orbit, double deltaScale,
+	std::complex<double> viewCenter, std::complex<double> viewRadius,
+	int terms, int maxIterations, double bailout);
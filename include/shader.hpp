@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <glad/glad.h>
+
+// Compiles and links a program, printing the info log of whichever stage fails.
+GLuint compileProgram(const char* vertexSource, const char* fragmentSource);
+// Same for a single compute shader, needs GL 4.3.
+GLuint compileComputeProgram(const char* computeSource);
+
+// Same as above, but every distinct source is only compiled once and then shared, so
+// renderers can switch between specializations instantly. The cache owns the programs;
+// releaseProgramCache() deletes them and must run while the context is still current.
+// Contexts that share objects, such as the viewer's background compiler, also share the
+// cache, and a program another thread is compiling is waited for instead of compiled twice.
+GLuint cachedProgram(const std::string& vertexSource, const std::string& fragmentSource);
+GLuint cachedComputeProgram(const std::string& computeSource);
+void releaseProgramCache();
+
+// Keeps the linked binaries of cached programs in directory, named after a hash of the
+// driver and the sources, so that later launches load them instead of compiling. A binary
+// the driver no longer accepts is compiled and replaced. Needs GL 4.1 and a driver with a
+// binary format, otherwise programs are compiled as before. Call before the first program.
+void setProgramBinaryDirectory(const std::string& directory);
+
+// Fullscreen quad in [-1, 1]^2 shared by every pass; a_Position is at location 0.
+void createFullscreenQuad();
+void drawFullscreenQuad();
+
+struct ContextObjects;
+
+// The program cache and the quad belong to one context. A thread that renders with a context
+// of its own, see gpu_devices.hpp, keeps them apart with a scope that lives while the context
+// is current; it creates the quad and releases both at the end.
+class ContextObjectScope
+{
+public:
+	ContextObjectScope();
+	~ContextObjectScope();
+
+	ContextObjectScope(const ContextObjectScope&) = delete;
+	ContextObjectScope& operator=(const ContextObjectScope&) = delete;
+
+private:
+	std::unique_ptr<ContextObjects> m_Objects;
+	ContextObjects* m_Previous;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ *  Thin wrappers over the widest float vectors the build targets: 16 lanes with AVX-512,
+ *  8 with AVX2 and a plain 4 lane array otherwise (which compilers still vectorize with
+ *  SSE2). Masks come from comparisons and drive select(), so every lane can follow its
+ *  own control flow.
+ */
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace simd
+{
+#if defined(__AVX512F__)
+
+	constexpr int lanes = 16;
+
+	struct Floats { __m512 v; };
+	struct Ints { __m512i v; };
+	struct Mask { __mmask16 m; };
+
+	inline Floats set(float value) { return { _mm512_set1_ps(value) }; }
+	inline Floats load(const float* source) { return { _mm512_loadu_ps(source) }; }
+	inline void store(float* destination, Floats value) { _mm512_storeu_ps(destination, value.v); }
+	inline Floats operator+(Floats a, Floats b) { return { _mm512_add_ps(a.v, b.v) }; }
+	inline Floats operator-(Floats a, Floats b) { return { _mm512_sub_ps(a.v, b.v) }; }
+	inline Floats operator*(Floats a, Floats b) { return { _mm512_mul_ps(a.v, b.v) }; }
+	inline Mask operator<(Floats a, Floats b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+	inline Mask operator>(Floats a, Floats b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Floats select(Mask mask, Floats ifTrue, Floats ifFalse) { return { _mm512_mask_blend_ps(mask.m, ifFalse.v, ifTrue.v) }; }
+
+	inline Ints set(int value) { return { _mm512_set1_epi32(value) }; }
+	inline Ints load(const int* source) { return { _mm512_loadu_si512(source) }; }
+	inline void store(int* destination, Ints value) { _mm512_storeu_si512(destination, value.v); }
+	inline Ints operator+(Ints a, Ints b) { return { _mm512_add_epi32(a.v, b.v) }; }
+	inline Ints operator-(Ints a, Ints b) { return { _mm512_sub_epi32(a.v, b.v) }; }
+	inline Ints operator&(Ints a, Ints b) { return { _mm512_and_si512(a.v, b.v) }; }
+	inline Mask operator==(Ints a, Ints b) { return { _mm512_cmpeq_epi32_mask(a.v, b.v) }; }
+	inline Mask operator>=(Ints a, Ints b) { return { _mm512_cmpge_epi32_mask(a.v, b.v) }; }
+	inline Ints select(Mask mask, Ints ifTrue, Ints ifFalse) { return { _mm512_mask_blend_epi32(mask.m, ifFalse.v, ifTrue.v) }; }
+
+	inline Mask operator|(Mask a, Mask b) { return { static_cast<__mmask16>(a.m | b.m) }; }
+	inline Mask operator&(Mask a, Mask b) { return { static_cast<__mmask16>(a.m & b.m) }; }
+	inline Mask operator~(Mask a) { return { static_cast<__mmask16>(~a.m) }; }
+	inline bool any(Mask mask) { return mask.m != 0; }
+	inline int bits(Mask mask) { return mask.m; }
+
+	// base[index[i]] for every lane
+	inline Floats gather(const float* base, Ints index) { return { _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, index.v, base, 4) }; }
+
+#elif defined(__AVX2__)
+
+	constexpr int lanes = 8;
+
+	struct Floats { __m256 v; };
+	struct Ints { __m256i v; };
+	// all bits set in true lanes, like the comparison instructions produce
+	struct Mask { __m256 m; };
+
+	inline Floats set(float value) { return { _mm256_set1_ps(value) }; }
+	inline Floats load(const float* source) { return { _mm256_loadu_ps(source) }; }
+	inline void store(float* destination, Floats value) { _mm256_storeu_ps(destination, value.v); }
+	inline Floats operator+(Floats a, Floats b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline Floats operator-(Floats a, Floats b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline Floats operator*(Floats a, Floats b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline Mask operator<(Floats a, Floats b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline Mask operator>(Floats a, Floats b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Floats select(Mask mask, Floats ifTrue, Floats ifFalse) { return { _mm256_blendv_ps(ifFalse.v, ifTrue.v, mask.m) }; }
+
+	inline Ints set(int value) { return { _mm256_set1_epi32(value) }; }
+	inline Ints load(const int* source) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) }; }
+	inline void store(int* destination, Ints value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), value.v); }
+	inline Ints operator+(Ints a, Ints b) { return { _mm256_add_epi32(a.v, b.v) }; }
+	inline Ints operator-(Ints a, Ints b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+	inline Ints operator&(Ints a, Ints b) { return { _mm256_and_si256(a.v, b.v) }; }
+	inline Mask operator==(Ints a, Ints b) { return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)) }; }
+	inline Mask operator>=(Ints a, Ints b)
+	{
+		return { _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpgt_epi32(a.v, b.v), _mm256_cmpeq_epi32(a.v, b.v))) };
+	}
+	inline Ints select(Mask mask, Ints ifTrue, Ints ifFalse)
+	{
+		return { _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(ifFalse.v), _mm256_castsi256_ps(ifTrue.v), mask.m)) };
+	}
+
+	inline Mask operator|(Mask a, Mask b) { return { _mm256_or_ps(a.m, b.m) }; }
+	inline Mask operator&(Mask a, Mask b) { return { _mm256_and_ps(a.m, b.m) }; }
+	inline Mask operator~(Mask a) { return { _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+	inline bool any(Mask mask) { return _mm256_movemask_ps(mask.m) != 0; }
+	inline int bits(Mask mask) { return _mm256_movemask_ps(mask.m); }
+
+	// base[index[i]] for every lane
+	inline Floats gather(const float* base, Ints index) { return { _mm256_i32gather_ps(base, index.v, 4) }; }
+
+#else
+
+	constexpr int lanes = 4;
+
+	struct Floats { float v[lanes]; };
+	struct Ints { int v[lanes]; };
+	struct Mask { bool m[lanes]; };
+
+#define SIMD_FOR_LANES for (int i = 0; i < lanes; ++i)
+
+	inline Floats set(float value) { Floats r; SIMD_FOR_LANES r.v[i] = value; return r; }
+	inline Floats load(const float* source) { Floats r; SIMD_FOR_LANES r.v[i] = source[i]; return r; }
+	inline void store(float* destination, Floats value) { SIMD_FOR_LANES destination[i] = value.v[i]; }
+	inline Floats operator+(Floats a, Floats b) { SIMD_FOR_LANES a.v[i] += b.v[i]; return a; }
+	inline Floats operator-(Floats a, Floats b) { SIMD_FOR_LANES a.v[i] -= b.v[i]; return a; }
+	inline Floats operator*(Floats a, Floats b) { SIMD_FOR_LANES a.v[i] *= b.v[i]; return a; }
+	inline Mask operator<(Floats a, Floats b) { Mask r; SIMD_FOR_LANES r.m[i] = a.v[i] < b.v[i]; return r; }
+	inline Mask operator>(Floats a, Floats b) { Mask r; SIMD_FOR_LANES r.m[i] = a.v[i] > b.v[i]; return r; }
+	inline Floats select(Mask mask, Floats ifTrue, Floats ifFalse) { SIMD_FOR_LANES ifFalse.v[i] = mask.m[i] ? ifTrue.v[i] : ifFalse.v[i]; return ifFalse; }
+
+	inline Ints set(int value) { Ints r; SIMD_FOR_LANES r.v[i] = value; return r; }
+	inline Ints load(const int* source) { Ints r; SIMD_FOR_LANES r.v[i] = source[i]; return r; }
+	inline void store(int* destination, Ints value) { SIMD_FOR_LANES destination[i] = value.v[i]; }
+	inline Ints operator+(Ints a, Ints b) { SIMD_FOR_LANES a.v[i] += b.v[i]; return a; }
+	inline Ints operator-(Ints a, Ints b) { SIMD_FOR_LANES a.v[i] -= b.v[i]; return a; }
+	inline Ints operator&(Ints a, Ints b) { SIMD_FOR_LANES a.v[i] &= b.v[i]; return a; }
+	inline Mask operator==(Ints a, Ints b) { Mask r; SIMD_FOR_LANES r.m[i] = a.v[i] == b.v[i]; return r; }
+	inline Mask operator>=(Ints a, Ints b) { Mask r; SIMD_FOR_LANES r.m[i] = a.v[i] >= b.v[i]; return r; }
+	inline Ints select(Mask mask, Ints ifTrue, Ints ifFalse) { SIMD_FOR_LANES ifFalse.v[i] = mask.m[i] ? ifTrue.v[i] : ifFalse.v[i]; return ifFalse; }
+
+	inline Mask operator|(Mask a, Mask b) { SIMD_FOR_LANES a.m[i] = a.m[i] || b.m[i]; return a; }
+	inline Mask operator&(Mask a, Mask b) { SIMD_FOR_LANES a.m[i] = a.m[i] && b.m[i]; return a; }
+	inline Mask operator~(Mask a) { SIMD_FOR_LANES a.m[i] = !a.m[i]; return a; }
+	inline bool any(Mask mask) { SIMD_FOR_LANES if (mask.m[i]) return true; return false; }
+	inline int bits(Mask mask) { int r = 0; SIMD_FOR_LANES r |= mask.m[i] ? (1 << i) : 0; return r; }
+
+	inline Floats gather(const float* base, Ints index) { Floats r; SIMD_FOR_LANES r.v[i] = base[index.v[i]]; return r; }
+
+#undef SIMD_FOR_LANES
+
+#endif
+}
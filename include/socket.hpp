@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ *  Blocking TCP stream over winsock or BSD sockets, just enough for the render farm.
+ *  Every call returns false once the connection is gone, there are no exceptions.
+ */
+class Socket
+{
+public:
+	Socket() = default;
+	~Socket();
+
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	// Listens on every interface.
+	static Socket listen(int port);
+	// host is a name or an address
+	static Socket connect(const std::string& host, int port);
+
+	bool valid() const { return m_Handle != invalidHandle; }
+	// Waits up to milliseconds for a connection or for data, false on timeout.
+	bool waitReadable(int milliseconds) const;
+	Socket accept(std::string& peer) const;
+
+	bool send(const void* data, std::size_t size);
+	bool sendLine(const std::string& line);
+	bool receive(void* data, std::size_t size);
+	// reads up to the next '\n', which is dropped
+	bool receiveLine(std::string& line);
+
+	void close();
+
+private:
+	using Handle = std::intptr_t;
+	static constexpr Handle invalidHandle = -1;
+
+	explicit Socket(Handle handle) : m_Handle(handle) {}
+
+	Handle m_Handle = invalidHandle;
+};
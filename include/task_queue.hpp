@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ *  Runs tasks in submission order on one background thread. push() blocks while
+ *  maxPending tasks are waiting, which bounds the memory held by queued work.
+ */
+class TaskQueue
+{
+public:
+	explicit TaskQueue(std::size_t maxPending = 4)
+		: m_MaxPending(maxPending), m_Thread([this] { run(); })
+	{
+	}
+
+	~TaskQueue()
+	{
+		finish();
+	}
+
+	TaskQueue(const TaskQueue&) = delete;
+	TaskQueue& operator=(const TaskQueue&) = delete;
+
+	void push(std::function<void()> task)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Space.wait(lock, [this] { return m_Tasks.size() < m_MaxPending; });
+		m_Tasks.push_back(std::move(task));
+		m_Ready.notify_one();
+	}
+
+	// Runs everything still queued and joins the thread.
+	void finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Closed = true;
+		}
+		m_Ready.notify_one();
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+private:
+	void run()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Ready.wait(lock, [this] { return m_Closed || !m_Tasks.empty(); });
+				if (m_Tasks.empty())
+					return;
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+			m_Space.notify_one();
+			task();
+		}
+	}
+
+	std::size_t m_MaxPending;
+	std::deque<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Ready, m_Space;
+	bool m_Closed = false;
+	std::thread m_Thread;
+};
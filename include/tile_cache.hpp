@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "camera.hpp"
+#include "delta_precision.hpp"
+#include "formula.hpp"
+
+// CpuRenderer::smooth(), one float per pixel
+const char* const cpuTileLayout = "cpu-smooth";
+
+// Everything a cached tile's values depend on. The palette, its offset and the coloring
+// mode are left out on purpose, a tile is recolored from its values without iterating.
+struct TileKey
+{
+	TileKey() = default;
+	TileKey(const Camera& camera, int width, int height, int maxIterations, const Formula& formula,
+		DeltaPrecision precision, bool interiorDetection, const std::string& layout)
+		: camera(camera), width(width), height(height), maxIterations(maxIterations), formula(formula)
+		, precision(precision), interiorDetection(interiorDetection), layout(layout)
+	{
+	}
+
+	Camera camera;
+	int width = 0, height = 0;
+	int maxIterations = 0;
+	Formula formula;
+	// the deltas' format, never Automatic, the CPU backend iterates float deltas
+	DeltaPrecision precision = DeltaPrecision::Float;
+	// interior tests stop pixels early with approximate smooth values and checkpoints
+	bool interiorDetection = true;
+	// what the values are, the backends store them differently: ProgressiveRenderer::resultLayout()
+	// or cpuTileLayout
+	std::string layout;
+
+	// canonical text of every field, full precision for the center
+	std::string text() const;
+};
+
+/**
+ *  Finished tiles on disk, so that repeated renders of the same view and recoloring with
+ *  another palette skip iterating entirely. A tile is a file in directory named after a
+ *  hash of its key: a small header with the key text, which rules out hash collisions, and
+ *  the float values of every pixel as the backend read them back. There is no index, the
+ *  file name is the lookup. Files are written to a temporary name and renamed, so several
+ *  renders can share a directory and a crashed one never leaves a torn tile behind.
+ */
+class TileCache
+{
+public:
+	explicit TileCache(const std::string& directory);
+
+	// Fills values with the tile of key if it is cached, channels floats per pixel.
+	bool load(const TileKey& key, int channels, std::vector<float>& values);
+	// Returns false if the tile could not be written, which only costs the next render.
+	bool store(const TileKey& key, int channels, const std::vector<float>& values);
+
+	const std::string& directory() const { return m_Directory; }
+	int hits() const { return m_Hits; }
+	int misses() const { return m_Misses; }
+
+private:
+	std::string path(const TileKey& key) const;
+
+	std::string m_Directory;
+	int m_Hits = 0, m_Misses = 0;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "camera.hpp"
+#include "fixed_point.hpp"
+#include "formula.hpp"
+#include "progressive_renderer.hpp"
+#include "render_target.hpp"
+
+class TileCache;
+struct TileKey;
+
+/**
+ *  Covers the view with square tiles at discrete zoom levels, like a map viewer. Level 0 is
+ *  a single tile of 4 x 4 complex units and every level halves the tile edge, so the four
+ *  children of a tile make up the next level. The view uses the coarsest level whose tile
+ *  pixels are no larger than the screen's.
+ *
+ *  One ProgressiveRenderer iterates the tiles one after another, at most passesPerFrame
+ *  passes per frame: the visible tiles nearest to the view center first, then the parent
+ *  level of the view for zooming out, then a ring around the view for panning. Finished
+ *  tiles are colored into the slots of one atlas texture and the least recently used ones
+ *  are evicted. A visible tile that is not finished yet is drawn from its closest finished
+ *  ancestor, scaled up, so fast pans and zooms always show something while the work of a
+ *  frame stays bounded.
+ *
+ *  Tiles hold colors, so a new palette, cap or formula clears the pyramid. With a TileCache
+ *  the tiles then come back from disk without iterating.
+ */
+class TilePyramid
+{
+public:
+	static constexpr int tileSize = 256;
+	// the atlas has atlasTiles^2 slots, enough for the view, its parents and the ring on a 4K screen
+	static constexpr int atlasTiles = 16;
+	// an ancestor this many levels up still has a whole pixel for the tile
+	static constexpr int maximumPlaceholderLevels = 8;
+
+	TilePyramid(IterationKernel kernel, int workGroupSize);
+
+	TilePyramid(const TilePyramid&) = delete;
+	TilePyramid& operator=(const TilePyramid&) = delete;
+
+	// The renderer of the tiles, for settings that do not change the picture, such as the
+	// kernel, the delta format or iterationsPerPass.
+	ProgressiveRenderer& renderer() { return m_Renderer; }
+	const ProgressiveRenderer& renderer() const { return m_Renderer; }
+	// looks tiles up in cache before iterating them and stores the iterated ones, may be null
+	void setTileCache(TileCache* cache) { m_Cache = cache; }
+
+	// Clears every tile if anything that changes their colors changed.
+	void configure(int maxIterations, const Formula& formula, int palette, float paletteOffset, int antialias);
+	// Picks the level and the tiles wanted for camera on a width x height screen.
+	void setView(const Camera& camera, int width, int height);
+	// Runs up to passesPerFrame passes on the wanted tiles.
+	void update();
+	// Draws the view into the first attachment of target, which must be the screen size.
+	void draw(const RenderTarget& target) const;
+
+	// True once every wanted tile, the prefetched ones included, is finished.
+	bool isComplete() const { return m_Wanted.empty(); }
+	int level() const { return m_Level; }
+	int residentTiles() const { return static_cast<int>(m_Resident.size()); }
+
+	int passesPerFrame = 8;
+
+private:
+	struct TileAddress
+	{
+		int level = 0;
+		// lower left corner
+		HighPrecision x, y;
+
+		bool operator<(const TileAddress& rhs) const
+		{
+			if (level != rhs.level)
+				return level < rhs.level;
+			if (x != rhs.x)
+				return x < rhs.x;
+			return y < rhs.y;
+		}
+		bool operator==(const TileAddress& rhs) const { return level == rhs.level && x == rhs.x && y == rhs.y; }
+	};
+
+	struct Slot
+	{
+		TileAddress address;
+		bool used = false;
+		// m_Frame of the last view that showed or wanted the tile
+		std::uint64_t lastUsed = 0;
+	};
+
+	// tile edge in complex units is 2^spanExponent(level)
+	static int spanExponent(int level) { return 2 - level; }
+	static TileAddress ancestor(const TileAddress& tile, int levelsUp);
+	Camera tileCamera(const TileAddress& tile) const;
+	// key of the tile at camera in the TileCache
+	TileKey tileKey(const Camera& camera) const;
+	// tiles of level covering the view grown by ring tiles on every side, nearest to the
+	// view center first
+	std::vector<TileAddress> coveringTiles(int level, int ring) const;
+	// the resident tile that stands in for tile, itself or an ancestor, or -1
+	int placeholderSlot(const TileAddress& tile, int& levelsUp) const;
+	void startTile();
+	void finishTile();
+	int allocateSlot();
+	void clear();
+
+	ProgressiveRenderer m_Renderer;
+	TileCache* m_Cache = nullptr;
+	int m_Antialias = 1;
+	float m_PaletteOffset = 0.0f;
+
+	// colored tile before it is copied into the atlas
+	RenderTarget m_Tile;
+	RenderTarget m_Atlas;
+	std::vector<Slot> m_Slots;
+	std::map<TileAddress, int> m_Resident;
+
+	Camera m_Camera;
+	int m_Width = 0, m_Height = 0;
+	int m_Level = 0;
+	std::uint64_t m_Frame = 0;
+	std::vector<TileAddress> m_Visible;
+	// not yet resident tiles in the order they are iterated
+	std::vector<TileAddress> m_Wanted;
+	// the tile m_Renderer works on, if m_Working
+	TileAddress m_Current;
+	bool m_Working = false;
+	// the current tile came from the cache and must not be stored again
+	bool m_Restored = false;
+	std::vector<float> m_Result;
+};
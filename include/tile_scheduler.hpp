@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+/**
+ *  Work-stealing scheduler for small tiles. The tiles are ordered along a Hilbert curve
+ *  and each thread gets a contiguous run of it, so the tiles a thread works on touch
+ *  neighbouring pixels. A thread takes tiles from the front of its own deque and, once
+ *  that is empty, steals from the back of the others, which keeps all cores busy even
+ *  though interior tiles cost orders of magnitude more than exterior ones.
+ */
+class TileScheduler
+{
+public:
+	struct ThreadStats
+	{
+		// time spent inside the tile callback
+		double busySeconds = 0.0;
+		int tiles = 0;
+		int stolen = 0;
+	};
+
+	// threads == 0 uses every hardware thread
+	explicit TileScheduler(int threads = 0);
+
+	// Calls work(tileX, tileY, thread) once for every tile of the grid, from all threads,
+	// and returns when every tile is done.
+	void run(int tilesX, int tilesY, const std::function<void(int, int, int)>& work);
+
+	int threads() const { return m_Threads; }
+	// per thread statistics of the last run()
+	const std::vector<ThreadStats>& stats() const { return m_Stats; }
+
+	// Tile indices (y * tilesX + x) of the grid in Hilbert curve order.
+	static std::vector<int> hilbertOrder(int tilesX, int tilesY);
+
+private:
+	int m_Threads;
+	std::vector<ThreadStats> m_Stats;
+};
@@ -9,11 +9,26 @@ workspace "MandelbrotSet"
         "Release"
     }
 
+newoption
+{
+    trigger = "simd",
+    value = "ISA",
+    description = "Vector extensions of the cpu backend, see include/simd.hpp",
+    default = "avx2",
+    allowed =
+    {
+        { "avx2", "8 float lanes" },
+        { "avx512", "16 float lanes" },
+        { "none", "plain 4 lane arrays, runs on any x64" }
+    }
+}
+
 -- variables
     -- cfg - configuration
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
-project "MandelbrotSet"
+-- everything but the sources is shared by the application and the benchmarks
+function renderer_settings()
     location "."
     kind "ConsoleApp"
     language "C++"
@@ -21,12 +36,6 @@ project "MandelbrotSet"
 
     targetdir ("bin/" .. outputdir .. "/%{prj.name}")
     objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
-    
-    files
-    {
-        "include/**.hpp",
-        "src/**.cpp"
-    }
 
     includedirs
     {
@@ -46,8 +55,11 @@ project "MandelbrotSet"
         links
         {
             "GL",
+            -- contexts on every GPU of the offline renderers, see include/gpu_devices.hpp
+            "EGL",
             "glfw",
-            "dl"
+            "dl",
+            "pthread"
         }
 
     -- everything under this filter only applies to windows
@@ -66,11 +78,72 @@ project "MandelbrotSet"
         links
         {
             "opengl32",
-            "glfw3"
+            "glfw3",
+            -- winsock of the render farm, see include/socket.hpp
+            "ws2_32"
         }
 
+    -- only the cpu backend picks its lane width from this, so the rest of every project still
+    -- runs on any x64 and the GPU paths never meet an instruction the CPU lacks
+    filter { "files:src/cpu_renderer.cpp", "options:simd=avx2" }
+        vectorextensions "AVX2"
+
+    filter { "files:src/cpu_renderer.cpp", "options:simd=avx512", "toolset:not msc*" }
+        buildoptions { "-mavx512f" }
+
+    filter { "files:src/cpu_renderer.cpp", "options:simd=avx512", "toolset:msc*" }
+        buildoptions { "/arch:AVX512" }
+
     filter { "configurations:Debug" }
         symbols "On"
-    
+
     filter { "configurations:Release" }
-        optimize "On"
\ No newline at end of file
+        optimize "On"
+
+    filter {}
+end
+
+project "MandelbrotSet"
+    renderer_settings()
+
+    files
+    {
+        "include/**.hpp",
+        "src/**.cpp"
+    }
+
+-- optimized against plain iteration kernel, see bench/kernel_benchmark.cpp
+project "KernelBenchmark"
+    renderer_settings()
+
+    files
+    {
+        "include/**.hpp",
+        "src/**.cpp",
+        "bench/kernel_benchmark.cpp"
+    }
+    removefiles { "src/main.cpp" }
+
+-- float, double-float and fp64 deltas, see bench/precision_benchmark.cpp
+project "PrecisionBenchmark"
+    renderer_settings()
+
+    files
+    {
+        "include/**.hpp",
+        "src/**.cpp",
+        "bench/precision_benchmark.cpp"
+    }
+    removefiles { "src/main.cpp" }
+
+-- canonical views on every backend as JSON lines, see bench/mandelbrot_bench.cpp
+project "MandelbrotBench"
+    renderer_settings()
+
+    files
+    {
+        "include/**.hpp",
+        "src/**.cpp",
+        "bench/mandelbrot_bench.cpp"
+    }
+    removefiles { "src/main.cpp" }
@@ -0,0 +1,440 @@
+#include "batch_renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "cpu_renderer.hpp"
+#include "farm.hpp"
+#include "frame_profiler.hpp"
+#include "histogram.hpp"
+#include "png_writer.hpp"
+#include "progressive_renderer.hpp"
+#include "readback_ring.hpp"
+#include "render_target.hpp"
+#include "task_queue.hpp"
+#include "tile_cache.hpp"
+
+namespace
+{
+	// offline rendering has no frame budget, so iterate in bigger chunks
+	const int batchIterationsPerPass = 4096;
+	// tiles in flight between rendering and the encoder thread
+	const int readbackSlots = 3;
+
+	// Everything the encoder thread touches, owned by it once rendering started.
+	struct StripEncoder
+	{
+		PngWriter writer;
+		std::vector<unsigned char> strip;
+		int tilesInStrip = 0;
+		std::atomic<bool> failed{ false };
+	};
+
+	// Runs pass between the profiler's queries if there is a profiler.
+	template <typename Pass>
+	void timed(FrameProfiler* profiler, ProfilePass name, Pass pass)
+	{
+		if (profiler)
+			profiler->begin(name);
+		pass();
+		if (profiler)
+			profiler->end(name);
+	}
+
+	// View of one tile, both backends use the same grid so their images line up.
+	Camera tileCamera(const Options& options, int tileX, int tileY)
+	{
+		// square pixels, the scale is half of the image height
+		const double pixelSize = 2.0 * options.camera.scale / options.height;
+		const int tileSize = options.tileSize;
+
+		// tiles are laid out from the top left, complex y grows upwards
+		Camera camera = options.camera;
+		camera.scale = 0.5 * tileSize * pixelSize;
+		camera.centerX += HighPrecision::fromDouble((tileX * tileSize + 0.5 * tileSize - 0.5 * options.width) * pixelSize);
+		camera.centerY += HighPrecision::fromDouble((0.5 * options.height - tileY * tileSize - 0.5 * tileSize) * pixelSize);
+		return camera;
+	}
+
+	// Size of the preview the shared histogram of histogram coloring is built from, the
+	// image itself if it is no larger, see histogram.hpp.
+	void previewSize(const Options& options, int& width, int& height)
+	{
+		const double shrink = std::min(1.0, static_cast<double>(histogramPreviewSize) / std::max(options.width, options.height));
+		width = std::max(1, static_cast<int>(std::lround(options.width * shrink)));
+		height = std::max(1, static_cast<int>(std::lround(options.height * shrink)));
+	}
+
+	// Copies the top rows of a tile of the CPU backend into its place in the strip.
+	void continueStrip(const Options& options, int tileX, int rows, const std::vector<unsigned char>& pixels,
+		std::vector<unsigned char>& strip)
+	{
+		const int tileSize = options.tileSize;
+		const int columns = std::min(tileSize, options.width - tileX * tileSize);
+		for (int row = 0; row < rows; ++row)
+		{
+			const unsigned char* source = &pixels[static_cast<std::size_t>(row) * tileSize * 3];
+			unsigned char* destination = &strip[(static_cast<std::size_t>(row) * options.width + tileX * tileSize) * 3];
+			std::copy(source, source + columns * 3, destination);
+		}
+	}
+
+	// Prints how many tiles came from the cache.
+	void reportTileCache(const TileCache* tileCache)
+	{
+		if (tileCache)
+			std::cout << "Tile cache " << tileCache->directory() << ": " << tileCache->hits() << " hits, "
+				<< tileCache->misses() << " misses\n";
+	}
+
+	// Workers iterate the tiles and send their smooth values back in order, the palette is
+	// applied here like on the CPU backend.
+	bool renderBatchOnFarm(const Options& options)
+	{
+		const int tileSize = options.tileSize;
+		const int tilesX = (options.width + tileSize - 1) / tileSize;
+		const int tilesY = (options.height + tileSize - 1) / tileSize;
+
+		PngWriter writer;
+		if (!writer.open(options.output, options.width, options.height))
+		{
+			std::cerr << "Failed to open " << options.output << "!\n";
+			return false;
+		}
+		if (options.antialias > 1)
+			std::cout << "Farm tiles are colored from their smooth values, ignoring --antialias\n";
+
+		// the histogram preview goes first, so that it is delivered before every tile
+		const int firstTile = options.histogramColoring ? 1 : 0;
+		std::vector<FarmWork> work(static_cast<std::size_t>(tilesX) * tilesY + firstTile);
+		if (options.histogramColoring)
+		{
+			work[0].camera = options.camera;
+			previewSize(options, work[0].width, work[0].height);
+		}
+		for (int index = 0; index < tilesX * tilesY; ++index)
+		{
+			work[firstTile + index].camera = tileCamera(options, index % tilesX, index / tilesX);
+			work[firstTile + index].width = work[firstTile + index].height = tileSize;
+		}
+
+		CpuRenderer colorer(1);
+		colorer.palette = options.palette;
+		colorer.paletteOffset = options.paletteOffset;
+		colorer.histogramColoring = options.histogramColoring;
+
+		std::vector<unsigned char> strip(static_cast<std::size_t>(options.width) * tileSize * 3);
+		std::vector<unsigned char> pixels;
+		const auto start = std::chrono::steady_clock::now();
+		const bool success = coordinateFarm(options, work, [&](int piece, const std::vector<float>& smooth)
+		{
+			if (piece < firstTile)
+			{
+				colorer.histogram = buildHistogram(smooth.data(), smooth.size());
+				return true;
+			}
+
+			const int index = piece - firstTile;
+			const int tileX = index % tilesX, tileY = index / tilesX;
+			const int rows = std::min(tileSize, options.height - tileY * tileSize);
+			colorer.colorize(smooth, pixels);
+			continueStrip(options, tileX, rows, pixels, strip);
+			if (tileX + 1 < tilesX)
+				return true;
+
+			if (!writer.writeRows(strip.data(), rows))
+			{
+				std::cerr << "Failed to write " << options.output << "!\n";
+				return false;
+			}
+			std::cout << "Rendered tile row " << tileY + 1 << "/" << tilesY << "\n";
+			return true;
+		});
+		if (!success)
+			return false;
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << tilesX * tilesY << " tiles in " << seconds << " s ("
+			<< tilesX * tilesY / std::max(seconds, 1e-9) << " tiles/s)\n";
+		return writer.close();
+	}
+
+	// The CPU renders a whole tile with all cores at once, so tiles are simply done in order.
+	bool renderBatchOnCpu(const Options& options)
+	{
+		const int tileSize = options.tileSize;
+		const int tilesX = (options.width + tileSize - 1) / tileSize;
+		const int tilesY = (options.height + tileSize - 1) / tileSize;
+
+		PngWriter writer;
+		if (!writer.open(options.output, options.width, options.height))
+		{
+			std::cerr << "Failed to open " << options.output << "!\n";
+			return false;
+		}
+
+		CpuRenderer renderer(options.threads);
+		renderer.formula = options.formula;
+		renderer.palette = options.palette;
+		renderer.paletteOffset = options.paletteOffset;
+		renderer.histogramColoring = options.histogramColoring;
+		renderer.maxIterations = options.maxIterations;
+		renderer.interiorDetection = options.interiorDetection;
+		renderer.boundaryTracing = options.boundaryTracing;
+		std::cout << "Rendering on the CPU with " << renderer.threads() << " threads\n";
+		if (options.antialias > 1)
+			std::cout << "The CPU backend does not supersample, ignoring --antialias\n";
+
+		std::unique_ptr<TileCache> tileCache;
+		if (!options.tileCache.empty())
+			tileCache.reset(new TileCache(options.tileCache));
+
+		std::vector<unsigned char> strip(static_cast<std::size_t>(options.width) * tileSize * 3);
+		std::vector<unsigned char> pixels;
+		std::vector<float> smooth;
+		std::uint64_t iterations = 0, filledPixels = 0, extraReferences = 0, glitchedPixels = 0;
+		std::vector<TileScheduler::ThreadStats> threadStats(renderer.threads());
+
+		const auto start = std::chrono::steady_clock::now();
+		if (options.histogramColoring)
+		{
+			int width, height;
+			previewSize(options, width, height);
+			renderer.render(options.camera, width, height, pixels);
+			renderer.histogram = buildHistogram(renderer.smooth().data(), renderer.smooth().size());
+		}
+		for (int tileY = 0; tileY < tilesY; ++tileY)
+		{
+			const int rows = std::min(tileSize, options.height - tileY * tileSize);
+			for (int tileX = 0; tileX < tilesX; ++tileX)
+			{
+				const Camera camera = tileCamera(options, tileX, tileY);
+				const TileKey key(camera, tileSize, tileSize, options.maxIterations, options.formula, DeltaPrecision::Float,
+					options.interiorDetection, cpuTileLayout);
+				if (tileCache && tileCache->load(key, 1, smooth))
+				{
+					renderer.colorize(smooth, pixels);
+					continueStrip(options, tileX, rows, pixels, strip);
+					continue;
+				}
+
+				renderer.render(camera, tileSize, tileSize, pixels);
+				if (tileCache)
+					tileCache->store(key, 1, renderer.smooth());
+				iterations += renderer.iterations();
+				filledPixels += renderer.filledPixels();
+				extraReferences += renderer.references() - 1;
+				glitchedPixels += renderer.glitchedPixels();
+				for (int thread = 0; thread < renderer.threads(); ++thread)
+				{
+					const TileScheduler::ThreadStats& stats = renderer.threadStats()[thread];
+					threadStats[thread].busySeconds += stats.busySeconds;
+					threadStats[thread].tiles += stats.tiles;
+					threadStats[thread].stolen += stats.stolen;
+				}
+
+				continueStrip(options, tileX, rows, pixels, strip);
+			}
+
+			if (!writer.writeRows(strip.data(), rows))
+			{
+				std::cerr << "Failed to write " << options.output << "!\n";
+				return false;
+			}
+			std::cout << "Rendered tile row " << tileY + 1 << "/" << tilesY << "\n";
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << tilesX * tilesY << " tiles in " << seconds << " s ("
+			<< tilesX * tilesY / std::max(seconds, 1e-9) << " tiles/s, "
+			<< iterations / std::max(seconds, 1e-9) / 1e6 << " Miterations/s)\n";
+		if (options.boundaryTracing)
+			std::cout << "Boundary tracing filled " << 100.0 * filledPixels / (static_cast<double>(tilesX) * tilesY * tileSize * tileSize)
+				<< "% of the pixels\n";
+		if (extraReferences > 0)
+			std::cout << "Glitch detection added " << extraReferences << " references, " << glitchedPixels
+				<< " pixels glitched with every one\n";
+
+		// near 100% everywhere means the blocks were balanced and scaling is about linear
+		double busySeconds = 0.0;
+		for (int thread = 0; thread < renderer.threads(); ++thread)
+		{
+			const TileScheduler::ThreadStats& stats = threadStats[thread];
+			busySeconds += stats.busySeconds;
+			std::cout << "Thread " << thread << ": busy " << stats.busySeconds << " s ("
+				<< 100.0 * stats.busySeconds / std::max(seconds, 1e-9) << "%), "
+				<< stats.tiles << " blocks, " << stats.stolen << " stolen\n";
+		}
+		std::cout << "Average utilization " << 100.0 * busySeconds / (renderer.threads() * std::max(seconds, 1e-9)) << "%\n";
+		reportTileCache(tileCache.get());
+
+		return writer.close();
+	}
+}
+
+bool renderBatch(const Options& options)
+{
+	if (options.distributed())
+		return renderBatchOnFarm(options);
+	if (options.backend == Backend::Cpu)
+		return renderBatchOnCpu(options);
+
+	const int tileSize = options.tileSize;
+	const int tilesX = (options.width + tileSize - 1) / tileSize;
+	const int tilesY = (options.height + tileSize - 1) / tileSize;
+	const std::size_t tileBytes = static_cast<std::size_t>(tileSize) * tileSize * 3;
+
+	auto encoder = std::make_shared<StripEncoder>();
+	if (!encoder->writer.open(options.output, options.width, options.height))
+	{
+		std::cerr << "Failed to open " << options.output << "!\n";
+		return false;
+	}
+	encoder->strip.resize(static_cast<std::size_t>(options.width) * tileSize * 3);
+
+	ProgressiveRenderer renderer(options.computeKernel ? IterationKernel::Compute : IterationKernel::Fragment, options.workGroupSize);
+	renderer.iterationsPerPass = batchIterationsPerPass;
+	renderer.setFormula(options.formula);
+	renderer.setOptimizedKernel(options.optimizedKernel);
+	renderer.setDeltaPrecision(options.deltaPrecision);
+	renderer.setPalette(options.palette);
+	renderer.paletteOffset = options.paletteOffset;
+	renderer.setHistogramColoring(options.histogramColoring);
+	renderer.setDistanceEstimation(options.antialias > 1);
+	renderer.setMaxIterations(options.maxIterations);
+	renderer.interiorDetection = options.interiorDetection;
+	renderer.resize(tileSize, tileSize);
+
+	RenderTarget tile;
+	tile.resize(tileSize, tileSize, { GL_RGBA8 });
+
+	std::unique_ptr<TileCache> tileCache;
+	if (!options.tileCache.empty())
+		tileCache.reset(new TileCache(options.tileCache));
+	std::vector<float> result;
+
+	// every tile is a frame of the trace
+	std::unique_ptr<FrameProfiler> profiler;
+	if (!options.profile.empty())
+		profiler.reset(new FrameProfiler(true));
+
+	ReadbackRing readback(readbackSlots, tileBytes);
+	TaskQueue encoderThread(readbackSlots);
+
+	// Hands the oldest finished read to the encoder thread, which copies it into the strip
+	// and writes the strip out once its last tile arrived. Tiles finish in order.
+	auto encodeOldest = [&]()
+	{
+		auto pixels = std::make_shared<std::vector<unsigned char>>();
+		const int index = readback.finish(*pixels);
+
+		encoderThread.push([=, &options]()
+		{
+			const int tileX = index % tilesX, tileY = index / tilesX;
+			const int rows = std::min(tileSize, options.height - tileY * tileSize);
+			const int columns = std::min(tileSize, options.width - tileX * tileSize);
+
+			// GL rows are bottom up, the strip is top down
+			for (int row = 0; row < rows; ++row)
+			{
+				const unsigned char* source = &(*pixels)[static_cast<std::size_t>(tileSize - 1 - row) * tileSize * 3];
+				unsigned char* destination = &encoder->strip[(static_cast<std::size_t>(row) * options.width + tileX * tileSize) * 3];
+				std::copy(source, source + columns * 3, destination);
+			}
+
+			if (++encoder->tilesInStrip == tilesX)
+			{
+				if (!encoder->writer.writeRows(encoder->strip.data(), rows))
+					encoder->failed = true;
+				encoder->tilesInStrip = 0;
+				std::cout << "Rendered tile row " << tileY + 1 << "/" << tilesY << "\n";
+			}
+		});
+	};
+
+	std::uint64_t supersampled = 0;
+	const auto start = std::chrono::steady_clock::now();
+	if (renderer.histogramColoring())
+	{
+		int width, height;
+		previewSize(options, width, height);
+		renderer.resize(width, height);
+		renderer.setCamera(options.camera);
+		while (!renderer.isComplete())
+			renderer.iterate();
+		const Histogram histogram = renderer.histogram();
+		renderer.resize(tileSize, tileSize);
+		renderer.setHistogram(histogram);
+	}
+	for (int index = 0; index < tilesX * tilesY && !encoder->failed; ++index)
+	{
+		const Camera camera = tileCamera(options, index % tilesX, index / tilesX);
+		if (profiler)
+			profiler->beginFrame();
+		renderer.setCamera(camera);
+		// a cached tile only needs its coloring passes
+		const TileKey key(camera, tileSize, tileSize, options.maxIterations, options.formula, renderer.selectPrecision(),
+			options.interiorDetection, renderer.resultLayout());
+		if (!tileCache || !tileCache->load(key, ProgressiveRenderer::resultChannels, result) || !renderer.restoreResult(result))
+		{
+			timed(profiler.get(), ProfilePass::Iterate, [&]()
+			{
+				while (!renderer.isComplete())
+					renderer.iterate();
+			});
+			if (profiler)
+				profiler->countIterations(renderer);
+			// reading the result back waits for the GPU, which only the cache pays for
+			if (tileCache && renderer.readResult(result))
+				tileCache->store(key, ProgressiveRenderer::resultChannels, result);
+		}
+		timed(profiler.get(), ProfilePass::Colorize, [&]() { renderer.colorize(tile, camera, false); });
+		if (options.antialias > 1)
+			timed(profiler.get(), ProfilePass::Supersample, [&]() { supersampled += renderer.supersample(tile, options.antialias); });
+
+		// the read of this tile overlaps with rendering the next ones
+		if (readback.full())
+			encodeOldest();
+		timed(profiler.get(), ProfilePass::Readback, [&]() { readback.start(tile.framebuffer(), tileSize, tileSize, index); });
+		if (profiler)
+			profiler->endFrame();
+	}
+	while (!readback.empty())
+		encodeOldest();
+	encoderThread.finish();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << tilesX * tilesY << " tiles in " << seconds << " s ("
+		<< tilesX * tilesY / std::max(seconds, 1e-9) << " tiles/s)\n";
+	if (options.antialias > 1)
+		std::cout << "Supersampled " << 100.0 * supersampled / (static_cast<double>(tilesX) * tilesY * tileSize * tileSize)
+			<< "% of the pixels at " << options.antialias * options.antialias << " samples\n";
+	reportTileCache(tileCache.get());
+
+	if (profiler)
+	{
+		profiler->flush();
+		const FrameProfiler::Frame average = profiler->average(FrameProfiler::historyFrames);
+		std::cout << "GPU per tile over the last " << profiler->history().size() << " tiles: " << average.gpuMilliseconds << " ms";
+		for (ProfilePass pass : { ProfilePass::Iterate, ProfilePass::Colorize, ProfilePass::Supersample, ProfilePass::Readback })
+			std::cout << ", " << profilePassName(pass) << " " << average.passMilliseconds[static_cast<int>(pass)] << " ms";
+		if (average.iterations >= 0)
+			std::cout << ", " << average.iterations / 1e6 << " Miterations";
+		std::cout << "\n";
+		if (!profiler->writeTrace(options.profile))
+			std::cerr << "Failed to write " << options.profile << "!\n";
+	}
+
+	if (encoder->failed)
+	{
+		std::cerr << "Failed to write " << options.output << "!\n";
+		return false;
+	}
+	return encoder->writer.close();
+}
@@ -0,0 +1,667 @@
+#include "cpu_renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <iostream>
+
+#include "glitch_detection.hpp"
+#include "histogram.hpp"
+#include "interior_detection.hpp"
+#include "palette.hpp"
+#include "progressive_renderer.hpp"
+#include "reference_orbit.hpp"
+#include "series_approximation.hpp"
+#include "simd.hpp"
+
+namespace
+{
+	// pixels per block edge, small enough that the threads stay balanced near the set
+	const int blockSize = 32;
+	// boundary tracing iterates rectangles up to this edge length directly
+	const int minimumTraceSize = 6;
+
+	enum PixelStatus : unsigned char
+	{
+		Unknown,
+		// queued as part of a rectangle border, so corners are not queued twice
+		Pending,
+		Escaped,
+		Interior,
+		// stopped by the glitch test, iterated again with another reference
+		Glitched
+	};
+
+	struct BlockWork
+	{
+		std::uint64_t iterations = 0;
+		std::uint64_t filledPixels = 0;
+
+		BlockWork& operator+=(const BlockWork& rhs)
+		{
+			iterations += rhs.iterations;
+			filledPixels += rhs.filledPixels;
+			return *this;
+		}
+	};
+
+	struct Complex
+	{
+		simd::Floats x, y;
+	};
+
+	Complex operator+(Complex lhs, Complex rhs) { return { lhs.x + rhs.x, lhs.y + rhs.y }; }
+	Complex operator-(Complex lhs, Complex rhs) { return { lhs.x - rhs.x, lhs.y - rhs.y }; }
+
+	Complex operator*(Complex lhs, Complex rhs)
+	{
+		return { lhs.x * rhs.x - lhs.y * rhs.y, lhs.x * rhs.y + lhs.y * rhs.x };
+	}
+
+	// (Z + delta)^Power - Z^Power, same expansion as perturbDelta() in the iteration shader
+	template <int Power>
+	Complex powerDelta(Complex Z, Complex delta)
+	{
+		Complex zPowers[Power];
+		zPowers[0] = { simd::set(1.0f), simd::set(0.0f) };
+		for (int i = 1; i < Power; ++i)
+			zPowers[i] = zPowers[i - 1] * Z;
+
+		Complex sum = { simd::set(1.0f), simd::set(0.0f) };
+		float binomial = 1.0f;
+		for (int k = Power - 1; k >= 1; --k)
+		{
+			binomial = binomial * static_cast<float>(k + 1) / static_cast<float>(Power - k);
+			const simd::Floats factor = simd::set(binomial);
+			sum = sum * delta + Complex{ factor * zPowers[Power - k].x, factor * zPowers[Power - k].y };
+		}
+		return sum * delta;
+	}
+
+	// |c + d| - |c| without cancelling the large terms
+	simd::Floats diffabs(simd::Floats c, simd::Floats d)
+	{
+		using namespace simd;
+		const Floats zero = set(0.0f), sum = c + d, twice = set(2.0f) * c + d;
+		const Floats positive = select(sum < zero, zero - twice, d);
+		const Floats negative = select(sum > zero, twice, zero - d);
+		return select(c < zero, negative, positive);
+	}
+
+	// The formulas of formula.hpp, one instantiation of the whole kernel each like the
+	// #if branches of the iteration shader.
+	template <int Power>
+	struct MandelbrotFormula
+	{
+		static constexpr bool cardioidTest = Power == 2;
+		static constexpr bool rebaseTowardsZero = true;
+		static constexpr bool glitchDetection = false;
+
+		static Complex perturbDelta(Complex Z, Complex delta, Complex deltaC) { return powerDelta<Power>(Z, delta) + deltaC; }
+	};
+
+	// every pixel shares c, so there is no deltaC term, and the orbit does not start at 0
+	template <int Power>
+	struct JuliaFormula
+	{
+		static constexpr bool cardioidTest = false;
+		static constexpr bool rebaseTowardsZero = false;
+		// without rebasing towards 0 deltas can outgrow the values, see glitch_detection.hpp
+		static constexpr bool glitchDetection = true;
+
+		static Complex perturbDelta(Complex Z, Complex delta, Complex) { return powerDelta<Power>(Z, delta); }
+	};
+
+	struct BurningShipFormula
+	{
+		static constexpr bool cardioidTest = false;
+		static constexpr bool rebaseTowardsZero = true;
+		static constexpr bool glitchDetection = false;
+
+		static Complex perturbDelta(Complex Z, Complex delta, Complex deltaC)
+		{
+			const simd::Floats two = simd::set(2.0f);
+			return {
+				(two * Z.x + delta.x) * delta.x - (two * Z.y + delta.y) * delta.y + deltaC.x,
+				two * diffabs(Z.x * Z.y, Z.x * delta.y + delta.x * Z.y + delta.x * delta.y) + deltaC.y };
+		}
+	};
+
+	// Everything about the view the workers share, in the float precision of the shader.
+	struct View
+	{
+		int width = 0, height = 0;
+		int maxIterations = 0;
+		float colorPeriod = 1.0f;
+		// see paletteTable()
+		std::vector<unsigned char> palette;
+		float paletteOffset = 0.0f;
+
+		// the reference orbit split into x and y so lanes can gather from it
+		std::vector<float> orbitX, orbitY;
+		int referenceLength = 0;
+
+		float pixelSize = 0.0f;
+		// where the reference sits relative to the view center, 0 but for the references
+		// placed in glitched regions
+		std::complex<float> referenceOffset;
+		float seriesScale = 1.0f;
+		int skipIterations = 0;
+		std::vector<std::complex<float>> coefficients;
+
+		// see glitch_detection.hpp, 0 turns the test off
+		float glitchTolerance = ::glitchTolerance;
+
+		// see the interior shortcuts of the iteration shader
+		bool cardioidTest = false;
+		std::complex<float> referenceCenter;
+		float periodicityEpsilon = 0.0f;
+
+		bool boundaryTracing = false;
+		// only iterate the pixels marked Glitched again
+		bool retryGlitched = false;
+
+		unsigned char* rgb = nullptr;
+		// smooth value of every pixel, NaN if it did not escape, for histogram coloring and
+		// the tile cache
+		float* smooth = nullptr;
+		// PixelStatus of every pixel
+		unsigned char* status = nullptr;
+	};
+
+	// moves the view onto another reference orbit and its series
+	void useReference(View& view, const ReferenceOrbit& orbit, const SeriesApproximation& series)
+	{
+		view.orbitX.clear();
+		view.orbitY.clear();
+		for (int i = 0; i < orbit.length(); ++i)
+		{
+			view.orbitX.push_back(orbit.points[2 * i]);
+			view.orbitY.push_back(orbit.points[2 * i + 1]);
+		}
+		view.referenceLength = orbit.length();
+		view.skipIterations = series.skipIterations;
+		view.coefficients.clear();
+		for (const std::complex<double>& coefficient : series.coefficients)
+			view.coefficients.emplace_back(static_cast<float>(coefficient.real()), static_cast<float>(coefficient.imag()));
+	}
+
+	// the palette lookup of the color shader, intensity = smooth / colorPeriod
+	void writeColor(const View& view, int pixel, bool escaped, float smooth)
+	{
+		if (view.smooth)
+			view.smooth[pixel] = escaped ? smooth : NAN;
+
+		unsigned char* destination = view.rgb + static_cast<std::size_t>(pixel) * 3;
+		const float intensity = escaped ? smooth / view.colorPeriod : 0.0f;
+		const float value = std::min(std::max(std::ceil(intensity), 0.0f), 1.0f);
+
+		const std::array<float, 3> color = samplePalette(view.palette, intensity + view.paletteOffset);
+		for (int channel = 0; channel < 3; ++channel)
+			destination[channel] = static_cast<unsigned char>(std::lround(value * color[channel] * 255.0f));
+	}
+
+	bool insideCardioidOrBulb(std::complex<float> c)
+	{
+		const float x = c.real() - 0.25f, y = c.imag();
+		const float q = x * x + y * y;
+		if (q * (q + x) <= 0.25f * y * y)
+			return true;
+		return (c.real() + 1.0f) * (c.real() + 1.0f) + y * y <= 0.0625f;
+	}
+
+	// Iterates the given pixels (indices into the image, top row first) to completion and
+	// colors them. Returns the number of iterations done.
+	template <class Kernel>
+	std::uint64_t iteratePixels(const View& view, const int* pixels, int pixelCount)
+	{
+		using namespace simd;
+
+		int nextPixel = 0;
+		std::uint64_t iterations = 0;
+
+		float deltaX[lanes], deltaY[lanes], deltaCX[lanes], deltaCY[lanes], radius[lanes];
+		float checkpointX[lanes], checkpointY[lanes];
+		int reference[lanes], iteration[lanes], pixel[lanes];
+
+		// Loads the next pixel of the list into a lane, idle lanes get pixel -1 and keep
+		// iterating harmless zeros until the whole vector is done.
+		auto startLane = [&](int lane)
+		{
+			deltaX[lane] = deltaY[lane] = deltaCX[lane] = deltaCY[lane] = 0.0f;
+			// far outside, so nothing matches it before the first checkpoint
+			checkpointX[lane] = checkpointY[lane] = 1e30f;
+			reference[lane] = iteration[lane] = 0;
+			pixel[lane] = -1;
+
+			while (nextPixel < pixelCount)
+			{
+				const int index = pixels[nextPixel++];
+				const int x = index % view.width, y = index / view.width;
+
+				// gl_FragCoord of this pixel, GL rows count from the bottom
+				const float fragX = static_cast<float>(x) + 0.5f;
+				const float fragY = static_cast<float>(view.height - 1 - y) + 0.5f;
+				const std::complex<float> deltaC = std::complex<float>(
+					(fragX - 0.5f * static_cast<float>(view.width)) * view.pixelSize,
+					(fragY - 0.5f * static_cast<float>(view.height)) * view.pixelSize) - view.referenceOffset;
+
+				if (view.skipIterations >= view.maxIterations
+					|| (Kernel::cardioidTest && view.cardioidTest && insideCardioidOrBulb(view.referenceCenter + deltaC)))
+				{
+					writeColor(view, index, false, 0.0f);
+					view.status[index] = Interior;
+					continue;
+				}
+
+				const std::complex<float> u = deltaC / view.seriesScale;
+				std::complex<float> delta(0.0f, 0.0f);
+				for (int k = static_cast<int>(view.coefficients.size()) - 1; k >= 0; --k)
+				{
+					const std::complex<float> sum = delta + view.coefficients[k];
+					delta = std::complex<float>(
+						sum.real() * u.real() - sum.imag() * u.imag(),
+						sum.real() * u.imag() + sum.imag() * u.real());
+				}
+
+				deltaX[lane] = delta.real();
+				deltaY[lane] = delta.imag();
+				deltaCX[lane] = deltaC.real();
+				deltaCY[lane] = deltaC.imag();
+				reference[lane] = iteration[lane] = view.skipIterations;
+				pixel[lane] = index;
+				return;
+			}
+		};
+
+		for (int lane = 0; lane < lanes; ++lane)
+			startLane(lane);
+
+		const Floats bailout = set(static_cast<float>(ProgressiveRenderer::bailout * ProgressiveRenderer::bailout));
+		const Ints one = set(1), zero = set(0), idle = set(-1);
+		const Ints lastReference = set(view.referenceLength - 1);
+		const Ints maxIterations = set(view.maxIterations);
+		const bool periodicity = view.periodicityEpsilon > 0.0f;
+		const Floats periodicityEpsilon = set(view.periodicityEpsilon * view.periodicityEpsilon);
+		const Floats tolerance = set(view.glitchTolerance);
+
+		Complex delta = { load(deltaX), load(deltaY) };
+		Complex deltaC = { load(deltaCX), load(deltaCY) };
+		Ints referenceIteration = load(reference), laneIteration = load(iteration);
+		Complex checkpoint = { load(checkpointX), load(checkpointY) };
+		Mask active = ~(load(pixel) == idle);
+		// Z_0 to rebase onto
+		const Complex origin = { set(view.orbitX[0]), set(view.orbitY[0]) };
+
+		while (any(active))
+		{
+			const Complex Z = { gather(view.orbitX.data(), referenceIteration), gather(view.orbitY.data(), referenceIteration) };
+			delta = Kernel::perturbDelta(Z, delta, deltaC);
+			referenceIteration = referenceIteration + one;
+
+			const Complex next = { gather(view.orbitX.data(), referenceIteration), gather(view.orbitY.data(), referenceIteration) };
+			const Complex z = next + delta;
+			const Floats radiusSquared = z.x * z.x + z.y * z.y;
+			const Mask escaped = (radiusSquared > bailout) & active;
+			Mask glitched = zero == one;
+			if (Kernel::glitchDetection)
+				glitched = (radiusSquared < tolerance * (next.x * next.x + next.y * next.y)) & active & ~escaped;
+
+			// rebase exactly like the shader does
+			Mask rebase = referenceIteration == lastReference;
+			if (Kernel::rebaseTowardsZero)
+				rebase = rebase | (radiusSquared < delta.x * delta.x + delta.y * delta.y);
+			const Complex rebased = z - origin;
+			delta = { select(rebase, rebased.x, delta.x), select(rebase, rebased.y, delta.y) };
+			referenceIteration = select(rebase, zero, referenceIteration);
+			laneIteration = laneIteration + one;
+
+			Mask finished = escaped | glitched | ((laneIteration >= maxIterations) & active);
+			if (periodicity)
+			{
+				// Brent, like the shader: checkpoints at powers of two, z coming back to the
+				// last one means the orbit settled into a cycle
+				const Mask atCheckpoint = (laneIteration & (laneIteration - one)) == zero;
+				const Complex difference = { z.x - checkpoint.x, z.y - checkpoint.y };
+				const Mask periodic = (difference.x * difference.x + difference.y * difference.y < periodicityEpsilon)
+					& ~atCheckpoint & active;
+				checkpoint = { select(atCheckpoint, z.x, checkpoint.x), select(atCheckpoint, z.y, checkpoint.y) };
+				finished = finished | (periodic & ~escaped & ~glitched);
+			}
+
+			if (!any(finished))
+				continue;
+
+			store(deltaX, delta.x);
+			store(deltaY, delta.y);
+			store(deltaCX, deltaC.x);
+			store(deltaCY, deltaC.y);
+			store(radius, radiusSquared);
+			store(reference, referenceIteration);
+			store(iteration, laneIteration);
+			store(checkpointX, checkpoint.x);
+			store(checkpointY, checkpoint.y);
+
+			const int finishedBits = bits(finished), escapedBits = bits(escaped), glitchedBits = bits(glitched);
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				if (!(finishedBits & (1 << lane)))
+					continue;
+
+				// the shader reports the iteration before its increment
+				const bool laneEscaped = (escapedBits & (1 << lane)) != 0;
+				const float smooth = static_cast<float>(iteration[lane] - 1)
+					- std::log(std::sqrt(radius[lane])) / std::log(16.0f);
+				writeColor(view, pixel[lane], laneEscaped, smooth);
+				view.status[pixel[lane]] = laneEscaped ? Escaped : (glitchedBits & (1 << lane)) ? Glitched : Interior;
+				iterations += iteration[lane] - view.skipIterations;
+
+				startLane(lane);
+			}
+
+			delta = { load(deltaX), load(deltaY) };
+			deltaC = { load(deltaCX), load(deltaCY) };
+			referenceIteration = load(reference);
+			laneIteration = load(iteration);
+			checkpoint = { load(checkpointX), load(checkpointY) };
+			active = ~(load(pixel) == idle);
+		}
+
+		return iterations;
+	}
+
+	// Mariani-Silver subdivision: iterate only the border of the rectangle and fill it if
+	// the whole border is inside the set. The set (and the region reaching any iteration
+	// cap) has no holes, so this only misses exterior channels thinner than a pixel that
+	// slip between the border samples. Otherwise split along the longer side, the children
+	// share the split line. Escaped borders are never filled, the smooth coloring varies
+	// inside them and filaments of the set could hide in there.
+	template <class Kernel>
+	BlockWork traceRectangle(const View& view, int x0, int y0, int x1, int y1, std::vector<int>& pixels)
+	{
+		BlockWork work;
+		auto queue = [&](int x, int y)
+		{
+			const int index = y * view.width + x;
+			if (view.status[index] == Unknown)
+			{
+				view.status[index] = Pending;
+				pixels.push_back(index);
+			}
+		};
+
+		pixels.clear();
+		if (x1 - x0 <= minimumTraceSize && y1 - y0 <= minimumTraceSize)
+		{
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+					queue(x, y);
+			work.iterations = iteratePixels<Kernel>(view, pixels.data(), static_cast<int>(pixels.size()));
+			return work;
+		}
+
+		for (int x = x0; x < x1; ++x)
+		{
+			queue(x, y0);
+			queue(x, y1 - 1);
+		}
+		for (int y = y0 + 1; y < y1 - 1; ++y)
+		{
+			queue(x0, y);
+			queue(x1 - 1, y);
+		}
+		work.iterations = iteratePixels<Kernel>(view, pixels.data(), static_cast<int>(pixels.size()));
+		if (x1 - x0 <= 2 || y1 - y0 <= 2)
+			return work;
+
+		bool uniform = true;
+		for (int x = x0; x < x1 && uniform; ++x)
+			uniform = view.status[y0 * view.width + x] == Interior && view.status[(y1 - 1) * view.width + x] == Interior;
+		for (int y = y0 + 1; y < y1 - 1 && uniform; ++y)
+			uniform = view.status[y * view.width + x0] == Interior && view.status[y * view.width + x1 - 1] == Interior;
+
+		if (uniform)
+		{
+			for (int y = y0 + 1; y < y1 - 1; ++y)
+			{
+				for (int x = x0 + 1; x < x1 - 1; ++x)
+				{
+					const int index = y * view.width + x;
+					if (view.status[index] != Unknown)
+						continue;
+					writeColor(view, index, false, 0.0f);
+					view.status[index] = Interior;
+					++work.filledPixels;
+				}
+			}
+			return work;
+		}
+
+		if (x1 - x0 >= y1 - y0)
+		{
+			const int middle = (x0 + x1) / 2;
+			work += traceRectangle<Kernel>(view, x0, y0, middle + 1, y1, pixels);
+			work += traceRectangle<Kernel>(view, middle, y0, x1, y1, pixels);
+		}
+		else
+		{
+			const int middle = (y0 + y1) / 2;
+			work += traceRectangle<Kernel>(view, x0, y0, x1, middle + 1, pixels);
+			work += traceRectangle<Kernel>(view, x0, middle, x1, y1, pixels);
+		}
+		return work;
+	}
+
+	// Renders one block, x0, y0 is its top left in image rows.
+	template <class Kernel>
+	BlockWork renderBlock(const View& view, int x0, int y0, int x1, int y1)
+	{
+		std::vector<int> pixels;
+		if (view.retryGlitched)
+		{
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+					if (view.status[y * view.width + x] == Glitched)
+						pixels.push_back(y * view.width + x);
+
+			BlockWork work;
+			work.iterations = iteratePixels<Kernel>(view, pixels.data(), static_cast<int>(pixels.size()));
+			return work;
+		}
+		if (view.boundaryTracing)
+			return traceRectangle<Kernel>(view, x0, y0, x1, y1, pixels);
+
+		for (int y = y0; y < y1; ++y)
+			for (int x = x0; x < x1; ++x)
+				pixels.push_back(y * view.width + x);
+
+		BlockWork work;
+		work.iterations = iteratePixels<Kernel>(view, pixels.data(), static_cast<int>(pixels.size()));
+		return work;
+	}
+
+	using BlockRenderer = BlockWork (*)(const View&, int, int, int, int);
+
+	template <template <int> class Kernel>
+	BlockRenderer blockRendererForPower(int power)
+	{
+		static_assert(minimumPower == 2 && maximumPower == 6, "instantiate every power of formula.hpp");
+		switch (power)
+		{
+		case 2: return &renderBlock<Kernel<2>>;
+		case 3: return &renderBlock<Kernel<3>>;
+		case 4: return &renderBlock<Kernel<4>>;
+		case 5: return &renderBlock<Kernel<5>>;
+		default: return &renderBlock<Kernel<6>>;
+		}
+	}
+
+	// picks the specialized kernel once per render instead of branching per iteration
+	BlockRenderer blockRenderer(const Formula& formula)
+	{
+		switch (formula.kind)
+		{
+		case FormulaKind::BurningShip:
+			return &renderBlock<BurningShipFormula>;
+		case FormulaKind::Julia:
+			return blockRendererForPower<JuliaFormula>(formula.power);
+		default:
+			return blockRendererForPower<MandelbrotFormula>(formula.power);
+		}
+	}
+}
+
+CpuRenderer::CpuRenderer(int threads)
+	: m_Scheduler(threads)
+{
+}
+
+void CpuRenderer::render(const Camera& camera, int width, int height, std::vector<unsigned char>& rgb)
+{
+	rgb.resize(static_cast<std::size_t>(width) * height * 3);
+	m_Iterations = m_FilledPixels = 0;
+	if (width <= 0 || height <= 0)
+		return;
+
+	// pieces of a farm or frames of a sequence can go deeper than the options checked
+	if (camera.scale < minimumFloatScale && !m_DepthWarned)
+	{
+		std::cerr << "The CPU backend's float deltas do not resolve scale " << camera.scale << ", below "
+			<< minimumFloatScale << " its pixels collapse onto the reference\n";
+		m_DepthWarned = true;
+	}
+
+	const double bailout = ProgressiveRenderer::bailout;
+	const ReferenceOrbit orbit = computeReferenceOrbit(camera.centerX, camera.centerY, formula, camera.scale, maxIterations, bailout);
+	const SeriesApproximation series = computeSeriesApproximation(
+		orbit, camera.scale, std::complex<double>(0.0, 0.0),
+		std::complex<double>(static_cast<double>(width) / height, 1.0),
+		ProgressiveRenderer::seriesTerms, maxIterations, bailout);
+
+	View view;
+	view.width = width;
+	view.height = height;
+	view.maxIterations = maxIterations;
+	view.colorPeriod = colorPeriod;
+	view.palette = paletteTable(palette);
+	view.paletteOffset = paletteOffset;
+	useReference(view, orbit, series);
+	// square pixels, the scale is half of the view height
+	view.pixelSize = static_cast<float>(2.0 * camera.scale / height);
+	view.seriesScale = static_cast<float>(camera.scale);
+	view.cardioidTest = interiorDetection && cardioidTestUsable(2.0 * camera.scale / height);
+	view.referenceCenter = std::complex<float>(
+		static_cast<float>(camera.centerX.toDouble()), static_cast<float>(camera.centerY.toDouble()));
+	view.periodicityEpsilon = interiorDetection ? periodicityEpsilon(2.0 * camera.scale / height) : 0.0f;
+	view.boundaryTracing = boundaryTracing;
+	view.rgb = rgb.data();
+	m_Status.assign(static_cast<std::size_t>(width) * height, Unknown);
+	view.status = m_Status.data();
+	m_Smooth.resize(static_cast<std::size_t>(width) * height);
+	view.smooth = m_Smooth.data();
+
+	const int blocksX = (width + blockSize - 1) / blockSize;
+	const int blocksY = (height + blockSize - 1) / blockSize;
+	std::atomic<std::uint64_t> iterations{ 0 }, filledPixels{ 0 };
+	const BlockRenderer renderBlockWithFormula = blockRenderer(formula);
+
+	m_Scheduler.run(blocksX, blocksY, [&](int blockX, int blockY, int)
+	{
+		const int x0 = blockX * blockSize, y0 = blockY * blockSize;
+		const BlockWork work = renderBlockWithFormula(
+			view, x0, y0, std::min(x0 + blockSize, width), std::min(y0 + blockSize, height));
+		iterations += work.iterations;
+		filledPixels += work.filledPixels;
+	});
+
+	// Pixels that lost the reference go again with one placed in their region, which they
+	// stay close to. Each round only iterates what is still glitched. Pixels a round could
+	// not fix glitch with any reference, their delta outgrew the orbit long ago, so they
+	// finish without the test like they did before it existed.
+	m_References = 1;
+	m_GlitchedPixels = 0;
+	std::vector<unsigned char> glitched(m_Status.size());
+	std::size_t previousCount = m_Status.size() + 1;
+	view.retryGlitched = true;
+	for (;;)
+	{
+		for (std::size_t pixel = 0; pixel < m_Status.size(); ++pixel)
+			glitched[pixel] = m_Status[pixel] == Glitched;
+		const std::size_t count = static_cast<std::size_t>(std::count(glitched.begin(), glitched.end(), 1));
+		int x, y;
+		if (count == 0)
+			break;
+
+		const auto run = [&]()
+		{
+			m_Scheduler.run(blocksX, blocksY, [&](int blockX, int blockY, int)
+			{
+				const int x0 = blockX * blockSize, y0 = blockY * blockSize;
+				iterations += renderBlockWithFormula(
+					view, x0, y0, std::min(x0 + blockSize, width), std::min(y0 + blockSize, height)).iterations;
+			});
+		};
+		if (count >= previousCount || m_References == maximumReferences
+			|| !pickGlitchReference(glitched, width, height, x, y))
+		{
+			m_GlitchedPixels = count;
+			view.glitchTolerance = 0.0f;
+			run();
+			break;
+		}
+		previousCount = count;
+		++m_References;
+
+		// the offset of that pixel, in the same float steps the kernel takes
+		const double offsetX = (x + 0.5 - 0.5 * width) * view.pixelSize;
+		const double offsetY = (height - 1 - y + 0.5 - 0.5 * height) * view.pixelSize;
+		const ReferenceOrbit secondary = computeReferenceOrbit(camera.centerX + HighPrecision::fromDouble(offsetX),
+			camera.centerY + HighPrecision::fromDouble(offsetY), formula, camera.scale, maxIterations, bailout);
+		useReference(view, secondary, computeSeriesApproximation(
+			secondary, camera.scale, std::complex<double>(-offsetX / camera.scale, -offsetY / camera.scale),
+			std::complex<double>(static_cast<double>(width) / height, 1.0),
+			ProgressiveRenderer::seriesTerms, maxIterations, bailout));
+		view.referenceOffset = std::complex<float>(static_cast<float>(offsetX), static_cast<float>(offsetY));
+		view.referenceCenter = std::complex<float>(static_cast<float>(camera.centerX.toDouble() + offsetX),
+			static_cast<float>(camera.centerY.toDouble() + offsetY));
+		run();
+	}
+
+	m_Iterations = iterations;
+	m_FilledPixels = filledPixels;
+
+	if (histogramColoring)
+		recolorByHistogram(view.palette, m_Smooth, rgb);
+}
+
+void CpuRenderer::colorize(const std::vector<float>& smooth, std::vector<unsigned char>& rgb) const
+{
+	rgb.resize(smooth.size() * 3);
+
+	View view;
+	view.colorPeriod = colorPeriod;
+	view.palette = paletteTable(palette);
+	view.paletteOffset = paletteOffset;
+	view.rgb = rgb.data();
+	for (std::size_t pixel = 0; pixel < smooth.size(); ++pixel)
+		writeColor(view, static_cast<int>(pixel), !std::isnan(smooth[pixel]), smooth[pixel]);
+
+	if (histogramColoring)
+		recolorByHistogram(view.palette, smooth, rgb);
+}
+
+void CpuRenderer::recolorByHistogram(const std::vector<unsigned char>& table, const std::vector<float>& smooth,
+	std::vector<unsigned char>& rgb) const
+{
+	// recolor every escaped pixel by its place in the histogram, as the GPU does
+	const Histogram used = histogram.cdf.empty() ? buildHistogram(smooth.data(), smooth.size()) : histogram;
+	for (std::size_t pixel = 0; pixel < smooth.size(); ++pixel)
+	{
+		if (std::isnan(smooth[pixel]))
+			continue;
+		const std::array<float, 3> color = samplePalette(table, histogramPosition(used, smooth[pixel]) + paletteOffset);
+		for (int channel = 0; channel < 3; ++channel)
+			rgb[pixel * 3 + channel] = static_cast<unsigned char>(std::lround(color[channel] * 255.0f));
+	}
+}
@@ -0,0 +1,626 @@
+#include "farm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "cpu_renderer.hpp"
+#include "gpu_devices.hpp"
+#include "progressive_renderer.hpp"
+#include "shader.hpp"
+#include "socket.hpp"
+#include "tile_cache.hpp"
+
+namespace
+{
+	// pieces a worker holds at once, so it never waits for the next one
+	const std::size_t piecesInFlight = 2;
+	const std::uint32_t resultMagic = 0x5246424D; // "MBFR"
+	// every fraction bit of HighPrecision
+	const int centerDigits = HighPrecision::decimalDigits;
+	// header word of a run of equal values, otherwise the word counts the literals that follow
+	const std::uint32_t runFlag = 0x80000000u;
+	// how often a waiting side looks whether the render is over
+	const int pollMilliseconds = 200;
+
+	struct ResultHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t index;
+		std::uint32_t width, height;
+		std::uint32_t words;
+	};
+
+	// Runs of at least three equal values, the interior and flat areas, become two words.
+	std::vector<std::uint32_t> compressValues(const std::vector<float>& values)
+	{
+		std::vector<std::uint32_t> bits(values.size());
+		std::copy_n(reinterpret_cast<const std::uint32_t*>(values.data()), values.size(), bits.data());
+
+		std::vector<std::uint32_t> words;
+		std::size_t literals = 0, literalStart = 0;
+		auto flushLiterals = [&]()
+		{
+			if (literals == 0)
+				return;
+			words.push_back(static_cast<std::uint32_t>(literals));
+			words.insert(words.end(), bits.begin() + literalStart, bits.begin() + literalStart + literals);
+			literals = 0;
+		};
+
+		for (std::size_t i = 0; i < bits.size();)
+		{
+			std::size_t run = 1;
+			while (i + run < bits.size() && bits[i + run] == bits[i] && run < runFlag - 1)
+				++run;
+			if (run >= 3)
+			{
+				flushLiterals();
+				words.push_back(runFlag | static_cast<std::uint32_t>(run));
+				words.push_back(bits[i]);
+			}
+			else
+			{
+				if (literals == 0)
+					literalStart = i;
+				literals += run;
+			}
+			i += run;
+		}
+		flushLiterals();
+		return words;
+	}
+
+	// Returns false if words do not expand to exactly count values.
+	bool decompressValues(const std::vector<std::uint32_t>& words, std::size_t count, std::vector<float>& values)
+	{
+		std::vector<std::uint32_t> bits;
+		bits.reserve(count);
+		for (std::size_t i = 0; i < words.size();)
+		{
+			const std::uint32_t header = words[i++];
+			const std::size_t length = header & ~runFlag;
+			if ((header & runFlag) ? i + 1 > words.size() : i + length > words.size())
+				return false;
+			if (bits.size() + length > count)
+				return false;
+			if (header & runFlag)
+				bits.insert(bits.end(), length, words[i++]);
+			else
+			{
+				bits.insert(bits.end(), words.begin() + i, words.begin() + i + length);
+				i += length;
+			}
+		}
+		if (bits.size() != count)
+			return false;
+
+		values.resize(count);
+		std::copy_n(bits.data(), count, reinterpret_cast<std::uint32_t*>(values.data()));
+		return true;
+	}
+
+	std::string scaleText(double scale)
+	{
+		std::ostringstream text;
+		text << std::hexfloat << scale;
+		return text.str();
+	}
+
+	// Everything of options that changes the values of a piece, the workers keep the rest.
+	std::string jobLine(const Options& options)
+	{
+		std::ostringstream line;
+		line << "job " << options.maxIterations << " " << options.formula.name() << " "
+			<< options.formula.juliaX.toString(centerDigits) << " " << options.formula.juliaY.toString(centerDigits)
+			<< " " << (options.interiorDetection ? "on" : "off") << " " << deltaPrecisionName(options.deltaPrecision)
+			<< " " << (options.optimizedKernel ? "on" : "off");
+		return line.str();
+	}
+
+	bool parseJobLine(const std::string& line, Options& options)
+	{
+		std::istringstream fields(line);
+		std::string tag, formula, juliaX, juliaY, interior, precision, optimized;
+		if (!(fields >> tag >> options.maxIterations >> formula >> juliaX >> juliaY >> interior >> precision >> optimized)
+			|| tag != "job" || !parseFormula(formula, options.formula) || !parseDeltaPrecision(precision, options.deltaPrecision))
+			return false;
+		options.formula.juliaX = HighPrecision::fromString(juliaX);
+		options.formula.juliaY = HighPrecision::fromString(juliaY);
+		options.interiorDetection = (interior == "on");
+		options.optimizedKernel = (optimized == "on");
+		return true;
+	}
+
+	std::string workLine(int index, const FarmWork& work)
+	{
+		std::ostringstream line;
+		line << "work " << index << " " << work.camera.centerX.toString(centerDigits) << " "
+			<< work.camera.centerY.toString(centerDigits) << " " << scaleText(work.camera.scale) << " "
+			<< work.width << " " << work.height;
+		return line.str();
+	}
+
+	bool parseWorkLine(const std::string& line, int& index, FarmWork& work)
+	{
+		std::istringstream fields(line);
+		std::string tag, centerX, centerY, scale;
+		if (!(fields >> tag >> index >> centerX >> centerY >> scale >> work.width >> work.height) || tag != "work"
+			|| work.width <= 0 || work.height <= 0)
+			return false;
+		work.camera.centerX = HighPrecision::fromString(centerX);
+		work.camera.centerY = HighPrecision::fromString(centerY);
+		work.camera.scale = std::strtod(scale.c_str(), nullptr);
+		return work.camera.scale > 0.0;
+	}
+
+	/**
+	 *  The coordinator's bookkeeping, shared by the threads that serve the workers. Pieces
+	 *  are handed out lowest index first and delivered strictly in index order.
+	 */
+	class FarmQueue
+	{
+	public:
+		explicit FarmQueue(int count)
+			: m_Holders(count, 0), m_Done(count, false)
+		{
+			for (int index = 0; index < count; ++index)
+				m_Pending.push_back(index);
+		}
+
+		// A pending piece, or else the oldest one a single other worker is still on.
+		bool take(const std::deque<int>& held, int& index)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Failed)
+				return false;
+			if (!m_Pending.empty())
+			{
+				index = m_Pending.front();
+				m_Pending.pop_front();
+				++m_Holders[index];
+				return true;
+			}
+			for (index = m_NextDelivery; index < static_cast<int>(m_Done.size()); ++index)
+			{
+				if (!m_Done[index] && m_Holders[index] == 1 && std::find(held.begin(), held.end(), index) == held.end())
+				{
+					++m_Holders[index];
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// The pieces of a lost worker, those nobody else has go back to the front.
+		void giveBack(const std::deque<int>& held)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for (auto index = held.rbegin(); index != held.rend(); ++index)
+			{
+				if (--m_Holders[*index] == 0 && !m_Done[*index])
+					m_Pending.push_front(*index);
+			}
+			m_Changed.notify_all();
+		}
+
+		// Returns false if another worker was faster and the result is not needed.
+		bool complete(int index, std::vector<float>&& smooth)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_Holders[index];
+			if (m_Done[index])
+				return false;
+			m_Done[index] = true;
+			m_Ready[index] = std::move(smooth);
+			m_Changed.notify_all();
+			return true;
+		}
+
+		// Delivers every result that is next in order, one thread at a time.
+		void deliverReady(const FarmDelivery& deliver)
+		{
+			std::lock_guard<std::mutex> deliveryLock(m_DeliveryMutex);
+			for (;;)
+			{
+				std::vector<float> smooth;
+				int index;
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					const auto ready = m_Ready.find(m_NextDelivery);
+					if (ready == m_Ready.end() || m_Failed)
+						return;
+					index = m_NextDelivery;
+					smooth = std::move(ready->second);
+					m_Ready.erase(ready);
+				}
+
+				const bool delivered = deliver(index, smooth);
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				++m_NextDelivery;
+				m_Failed = m_Failed || !delivered;
+				m_Changed.notify_all();
+			}
+		}
+
+		// Sleeps until something changed or a while passed.
+		void waitForChange()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Changed.wait_for(lock, std::chrono::milliseconds(pollMilliseconds));
+		}
+
+		// True once everything was delivered, or a delivery failed.
+		bool finished()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Failed || m_NextDelivery == static_cast<int>(m_Done.size());
+		}
+
+		bool failed()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Failed;
+		}
+
+	private:
+		std::mutex m_Mutex, m_DeliveryMutex;
+		std::condition_variable m_Changed;
+		std::deque<int> m_Pending;
+		// workers that are rendering every piece
+		std::vector<int> m_Holders;
+		std::vector<bool> m_Done;
+		// finished pieces waiting for the ones before them
+		std::map<int, std::vector<float>> m_Ready;
+		int m_NextDelivery = 0;
+		bool m_Failed = false;
+	};
+
+	// One thread per connected worker.
+	void serveWorker(Socket socket, const std::string& peer, const Options& options, const std::vector<FarmWork>& work,
+		FarmQueue& queue, const FarmDelivery& deliver)
+	{
+		std::deque<int> held;
+		int pieces = 0;
+		auto lose = [&](const char* reason)
+		{
+			std::cerr << "Lost worker " << peer << " (" << reason << "), " << held.size() << " pieces go back\n";
+			queue.giveBack(held);
+		};
+
+		if (!socket.sendLine(jobLine(options)))
+			return lose("send failed");
+
+		for (;;)
+		{
+			int index;
+			while (held.size() < piecesInFlight && queue.take(held, index))
+			{
+				held.push_back(index);
+				if (!socket.sendLine(workLine(index, work[index])))
+					return lose("send failed");
+			}
+
+			if (held.empty())
+			{
+				if (queue.finished())
+				{
+					socket.sendLine("done");
+					std::cerr << "Worker " << peer << " rendered " << pieces << " pieces\n";
+					return;
+				}
+				queue.waitForChange();
+				continue;
+			}
+
+			// a worker that hangs must not hold up the end of the render
+			while (!socket.waitReadable(pollMilliseconds))
+			{
+				if (queue.finished())
+				{
+					socket.sendLine("done");
+					return;
+				}
+			}
+
+			ResultHeader header;
+			std::vector<std::uint32_t> words;
+			std::vector<float> smooth;
+			if (!socket.receive(&header, sizeof(header)))
+				return lose("connection closed");
+			const auto heldIndex = std::find(held.begin(), held.end(), static_cast<int>(header.index));
+			if (header.magic != resultMagic || heldIndex == held.end()
+				|| static_cast<int>(header.width) != work[header.index].width || static_cast<int>(header.height) != work[header.index].height)
+				return lose("unexpected result");
+			// every run saves at least the header word of the literals after it, so no piece
+			// compresses to more than one word per value and one more
+			if (header.words > static_cast<std::uint64_t>(header.width) * header.height + 1)
+				return lose("unexpected result");
+			words.resize(header.words);
+			if (!socket.receive(words.data(), words.size() * sizeof(std::uint32_t))
+				|| !decompressValues(words, static_cast<std::size_t>(header.width) * header.height, smooth))
+				return lose("corrupt result");
+
+			held.erase(heldIndex);
+			++pieces;
+			if (queue.complete(header.index, std::move(smooth)))
+				queue.deliverReady(deliver);
+		}
+	}
+
+	// Renders pieces with the backend of options, the GPU one needs a current context.
+	class FarmRenderer
+	{
+	public:
+		explicit FarmRenderer(const Options& options)
+		{
+			if (!options.tileCache.empty())
+				m_Cache = std::make_unique<TileCache>(options.tileCache);
+
+			if (options.backend == Backend::Cpu)
+			{
+				m_Cpu = std::make_unique<CpuRenderer>(options.threads);
+				m_Cpu->formula = options.formula;
+				m_Cpu->maxIterations = options.maxIterations;
+				m_Cpu->interiorDetection = options.interiorDetection;
+				m_Cpu->boundaryTracing = options.boundaryTracing;
+				return;
+			}
+
+			m_Gpu = std::make_unique<ProgressiveRenderer>(
+				options.computeKernel ? IterationKernel::Compute : IterationKernel::Fragment, options.workGroupSize);
+			// offline rendering has no frame budget, so iterate in bigger chunks
+			m_Gpu->iterationsPerPass = 4096;
+			m_Gpu->setFormula(options.formula);
+			m_Gpu->setOptimizedKernel(options.optimizedKernel);
+			m_Gpu->setDeltaPrecision(options.deltaPrecision);
+			m_Gpu->setMaxIterations(options.maxIterations);
+			m_Gpu->interiorDetection = options.interiorDetection;
+		}
+
+		// smooth values of work, top row first
+		void render(const FarmWork& work, std::vector<float>& smooth)
+		{
+			if (m_Cpu)
+			{
+				const TileKey key(work.camera, work.width, work.height, m_Cpu->maxIterations, m_Cpu->formula, DeltaPrecision::Float,
+					m_Cpu->interiorDetection, cpuTileLayout);
+				if (m_Cache && m_Cache->load(key, 1, smooth))
+					return;
+				m_Cpu->render(work.camera, work.width, work.height, m_Pixels);
+				smooth = m_Cpu->smooth();
+				if (m_Cache)
+					m_Cache->store(key, 1, smooth);
+				return;
+			}
+
+			m_Gpu->resize(work.width, work.height);
+			m_Gpu->setCamera(work.camera);
+			const TileKey key(work.camera, work.width, work.height, m_Gpu->maxIterations(), m_Gpu->formula(), m_Gpu->selectPrecision(),
+				m_Gpu->interiorDetection, m_Gpu->resultLayout());
+			if (!m_Cache || !m_Cache->load(key, ProgressiveRenderer::resultChannels, m_Result) || !m_Gpu->restoreResult(m_Result))
+			{
+				while (!m_Gpu->isComplete())
+					m_Gpu->iterate();
+				m_Gpu->readResult(m_Result);
+				if (m_Cache)
+					m_Cache->store(key, ProgressiveRenderer::resultChannels, m_Result);
+			}
+
+			// GL rows are bottom up, and only escaped pixels have a smooth value
+			const int channels = ProgressiveRenderer::resultChannels;
+			smooth.resize(static_cast<std::size_t>(work.width) * work.height);
+			for (int row = 0; row < work.height; ++row)
+			{
+				for (int column = 0; column < work.width; ++column)
+				{
+					const float* result = &m_Result[(static_cast<std::size_t>(work.height - 1 - row) * work.width + column) * channels];
+					smooth[static_cast<std::size_t>(row) * work.width + column] = result[1] > 0.0f ? result[0] : NAN;
+				}
+			}
+		}
+
+	private:
+		std::unique_ptr<TileCache> m_Cache;
+		std::unique_ptr<CpuRenderer> m_Cpu;
+		std::unique_ptr<ProgressiveRenderer> m_Gpu;
+		std::vector<unsigned char> m_Pixels;
+		std::vector<float> m_Result;
+	};
+
+	// A GPU of this node, which takes pieces straight from the queue. Pulling one piece at a
+	// time deals them out by throughput, faster devices simply come back sooner.
+	void renderOnDevice(const GpuDevice& device, const Options& options, const std::vector<FarmWork>& work,
+		FarmQueue& queue, const FarmDelivery& deliver)
+	{
+		if (!device.makeCurrent())
+		{
+			std::cerr << "Failed to use " << device.name() << "!\n";
+			return;
+		}
+
+		{
+			ContextObjectScope objects;
+			FarmRenderer renderer(options);
+			const std::deque<int> held;
+			std::vector<float> smooth;
+			int pieces = 0;
+			const auto start = std::chrono::steady_clock::now();
+			while (!queue.finished())
+			{
+				int index;
+				if (!queue.take(held, index))
+				{
+					queue.waitForChange();
+					continue;
+				}
+
+				renderer.render(work[index], smooth);
+				++pieces;
+				if (queue.complete(index, std::move(smooth)))
+					queue.deliverReady(deliver);
+			}
+
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cerr << device.name() << ": " << pieces << " pieces, " << pieces / std::max(seconds, 1e-9) << " pieces/s\n";
+		}
+		device.release();
+	}
+
+	// One connection to the coordinator, with the context current on this thread if any.
+	bool workForCoordinator(const Options& options)
+	{
+		const std::size_t colon = options.farmCoordinator.rfind(':');
+		if (colon == std::string::npos)
+		{
+			std::cerr << "--farm-worker expects host:port\n";
+			return false;
+		}
+		const std::string host = options.farmCoordinator.substr(0, colon);
+		const int port = std::atoi(options.farmCoordinator.c_str() + colon + 1);
+
+		Socket socket = Socket::connect(host, port);
+		if (!socket.valid())
+		{
+			std::cerr << "Failed to connect to " << options.farmCoordinator << "!\n";
+			return false;
+		}
+
+		Options job = options;
+		std::string line;
+		if (!socket.receiveLine(line) || !parseJobLine(line, job))
+		{
+			std::cerr << "Unexpected job from " << options.farmCoordinator << ": " << line << "\n";
+			return false;
+		}
+		std::cout << "Rendering for " << options.farmCoordinator << " on the " << (job.backend == Backend::Cpu ? "CPU" : "GPU")
+			<< ", " << job.formula.name() << " at " << job.maxIterations << " iterations\n";
+
+		FarmRenderer renderer(job);
+		std::vector<float> smooth;
+		int pieces = 0;
+		const auto start = std::chrono::steady_clock::now();
+		while (socket.receiveLine(line))
+		{
+			if (line == "done")
+			{
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				std::cout << pieces << " pieces in " << seconds << " s\n";
+				return true;
+			}
+
+			int index;
+			FarmWork work;
+			if (!parseWorkLine(line, index, work))
+			{
+				std::cerr << "Unexpected work from " << options.farmCoordinator << ": " << line << "\n";
+				return false;
+			}
+
+			renderer.render(work, smooth);
+			const std::vector<std::uint32_t> words = compressValues(smooth);
+			ResultHeader header;
+			header.magic = resultMagic;
+			header.index = static_cast<std::uint32_t>(index);
+			header.width = static_cast<std::uint32_t>(work.width);
+			header.height = static_cast<std::uint32_t>(work.height);
+			header.words = static_cast<std::uint32_t>(words.size());
+			if (!socket.send(&header, sizeof(header)) || !socket.send(words.data(), words.size() * sizeof(std::uint32_t)))
+				break;
+			++pieces;
+		}
+
+		std::cerr << "Lost the connection to " << options.farmCoordinator << "!\n";
+		return false;
+	}
+}
+
+bool coordinateFarm(const Options& options, const std::vector<FarmWork>& work, const FarmDelivery& deliver)
+{
+	Socket listener;
+	if (options.farmPort != 0)
+	{
+		listener = Socket::listen(options.farmPort);
+		if (!listener.valid())
+		{
+			std::cerr << "Failed to listen on port " << options.farmPort << "!\n";
+			return false;
+		}
+		std::cerr << "Waiting for workers on port " << options.farmPort << " for " << work.size() << " pieces\n";
+	}
+
+	FarmQueue queue(static_cast<int>(work.size()));
+	std::vector<std::thread> workers;
+	if (options.gpus > 1)
+	{
+		for (const std::unique_ptr<GpuDevice>& device : gpuDevices())
+			workers.emplace_back([&, device = device.get()]() { renderOnDevice(*device, options, work, queue, deliver); });
+	}
+
+	while (!queue.finished())
+	{
+		if (!listener.valid())
+		{
+			queue.waitForChange();
+			continue;
+		}
+		if (!listener.waitReadable(pollMilliseconds))
+			continue;
+
+		std::string peer;
+		Socket connection = listener.accept(peer);
+		if (!connection.valid())
+			continue;
+		std::cerr << "Worker " << peer << " connected\n";
+		workers.emplace_back([&, peer, socket = std::move(connection)]() mutable
+		{
+			serveWorker(std::move(socket), peer, options, work, queue, deliver);
+		});
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+	return !queue.failed();
+}
+
+bool runFarmWorker(const Options& options)
+{
+	if (options.gpus <= 1)
+		return workForCoordinator(options);
+
+	// every GPU connects on its own, so the coordinator deals to them like to separate nodes
+	std::vector<std::thread> connections;
+	std::atomic<bool> success{ true };
+	for (const std::unique_ptr<GpuDevice>& device : gpuDevices())
+	{
+		connections.emplace_back([&, device = device.get()]()
+		{
+			if (!device->makeCurrent())
+			{
+				success = false;
+				return;
+			}
+			{
+				ContextObjectScope objects;
+				if (!workForCoordinator(options))
+					success = false;
+			}
+			device->release();
+		});
+	}
+	for (std::thread& connection : connections)
+		connection.join();
+	return success;
+}
@@ -0,0 +1,89 @@
+#include "formula.hpp"
+
+namespace
+{
+	// connected Julia sets with some interior to look at, per power
+	void presetJuliaConstant(Formula& formula)
+	{
+		const double constants[][2] =
+		{
+			{ -0.8, 0.156 },
+			{ -0.5, 0.55 },
+			{ 0.35, 0.35 },
+			{ -0.5, 0.5 },
+			{ 0.55, 0.45 }
+		};
+		const double* constant = constants[formula.power - minimumPower];
+		formula.juliaX = HighPrecision::fromDouble(constant[0]);
+		formula.juliaY = HighPrecision::fromDouble(constant[1]);
+	}
+}
+
+std::string Formula::name() const
+{
+	switch (kind)
+	{
+	case FormulaKind::BurningShip:
+		return "burning-ship";
+	case FormulaKind::Julia:
+		return "julia:" + std::to_string(power);
+	default:
+		return "mandelbrot:" + std::to_string(power);
+	}
+}
+
+std::string Formula::shaderDefines() const
+{
+	const char* kinds[] = { "FORMULA_MANDELBROT", "FORMULA_BURNING_SHIP", "FORMULA_JULIA" };
+	return std::string("#define ") + kinds[static_cast<int>(kind)] + "\n#define POWER " + std::to_string(power) + "\n";
+}
+
+bool parseFormula(const std::string& text, Formula& formula)
+{
+	const std::size_t colon = text.find(':');
+	const std::string kind = text.substr(0, colon);
+
+	Formula parsed;
+	if (kind == "burning-ship" && colon == std::string::npos)
+	{
+		parsed.kind = FormulaKind::BurningShip;
+		parsed.power = 2;
+	}
+	else if (kind == "mandelbrot" || kind == "julia")
+	{
+		parsed.kind = (kind == "julia") ? FormulaKind::Julia : FormulaKind::Mandelbrot;
+		parsed.power = 2;
+		if (colon != std::string::npos)
+		{
+			const std::string power = text.substr(colon + 1);
+			if (power.empty() || power.find_first_not_of("0123456789") != std::string::npos || power.size() > 2)
+				return false;
+			parsed.power = std::stoi(power);
+		}
+		if (parsed.power < minimumPower || parsed.power > maximumPower)
+			return false;
+		if (parsed.kind == FormulaKind::Julia)
+			presetJuliaConstant(parsed);
+	}
+	else
+		return false;
+
+	formula = parsed;
+	return true;
+}
+
+const std::vector<Formula>& formulaPresets()
+{
+	static const std::vector<Formula> presets = []
+	{
+		std::vector<Formula> formulas;
+		for (const char* name : { "mandelbrot:2", "mandelbrot:3", "mandelbrot:4", "burning-ship", "julia:2", "julia:3" })
+		{
+			Formula formula;
+			parseFormula(name, formula);
+			formulas.push_back(formula);
+		}
+		return formulas;
+	}();
+	return presets;
+}
@@ -0,0 +1,32 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// weight of the newest frame in the smoothed costs
+	const double smoothing = 0.25;
+}
+
+FramePacer::FramePacer(double targetMilliseconds, int initialIterations)
+	: m_TargetMilliseconds(targetMilliseconds)
+	, m_IterationsPerPass(std::min(std::max(initialIterations, minimumIterations), maximumIterations))
+{
+}
+
+void FramePacer::update(int iterationsPerPass, double iterateMilliseconds, double otherMilliseconds)
+{
+	// finished views do not iterate and say nothing about the cost
+	if (iterationsPerPass <= 0 || iterateMilliseconds <= 0.0)
+		return;
+
+	const double cost = iterateMilliseconds / iterationsPerPass;
+	m_Cost = (m_Cost > 0.0) ? (1.0 - smoothing) * m_Cost + smoothing * cost : cost;
+	m_OtherMilliseconds = (1.0 - smoothing) * m_OtherMilliseconds + smoothing * otherMilliseconds;
+
+	// whatever is left of the frame after the other passes, at least a tenth of it
+	const double available = std::max(m_TargetMilliseconds - m_OtherMilliseconds, 0.1 * m_TargetMilliseconds);
+	const double wanted = available / m_Cost;
+	const double limited = std::min(std::max(wanted, 0.5 * m_IterationsPerPass), 2.0 * m_IterationsPerPass);
+	m_IterationsPerPass = std::min(std::max(static_cast<int>(limited), minimumIterations), maximumIterations);
+}
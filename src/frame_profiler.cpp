@@ -0,0 +1,405 @@
+#include "frame_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include "progressive_renderer.hpp"
+#include "shader.hpp"
+
+namespace
+{
+	const char* overlay_vertex_text = R"(
+		#version 330 core
+
+		layout(location = 0) in vec3 a_Position;
+
+		out vec2 v_Position;
+
+		void main()
+		{
+			v_Position = a_Position.xy * 0.5f + 0.5f;
+			gl_Position = vec4(a_Position, 1.0f);
+		}
+	)";
+
+	// Column x is a frame of the history, row y a time; the pass whose cumulative time first
+	// exceeds that time colors the pixel, which stacks the passes bottom up.
+	const char* overlay_fragment_text = R"(
+		in vec2 v_Position;
+
+		out vec4 color;
+
+		// cumulative milliseconds at (frame, pass)
+		uniform sampler2D u_Stacked;
+		uniform float u_Milliseconds;
+		uniform float u_Budget;
+		uniform float u_Height;
+		uniform vec3 u_Colors[PASSES];
+
+		void main()
+		{
+			int frame = min(int(v_Position.x * float(HISTORY_FRAMES)), HISTORY_FRAMES - 1);
+			float milliseconds = v_Position.y * u_Milliseconds;
+
+			color = vec4(0.0f, 0.0f, 0.0f, 0.5f);
+			for(int pass = 0; pass < PASSES; ++pass)
+			{
+				if(milliseconds < texelFetch(u_Stacked, ivec2(frame, pass), 0).r)
+				{
+					color = vec4(u_Colors[pass], 0.9f);
+					break;
+				}
+			}
+
+			// a line at every multiple of the frame budget
+			float budgets = milliseconds / u_Budget;
+			if(round(budgets) > 0.0f && abs(budgets - round(budgets)) * u_Budget < 0.5f * u_Milliseconds / u_Height)
+				color = vec4(1.0f, 1.0f, 1.0f, 0.8f);
+		}
+	)";
+
+	const float passColors[profilePassCount * 3] =
+	{
+		1.0f, 0.5f, 0.1f,
+		1.0f, 0.9f, 0.2f,
+		0.2f, 0.6f, 1.0f,
+		0.9f, 0.3f, 0.9f,
+		0.3f, 0.9f, 0.4f,
+		0.6f, 0.6f, 0.6f
+	};
+
+	// 60 frames per second
+	const double frameBudget = 1000.0 / 60.0;
+	const double maximumBudgets = 4.0;
+	const int overlayWidth = 480, overlayHeight = 120, overlayMargin = 8;
+
+	double milliseconds(std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	bool endsWith(const std::string& text, const std::string& suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+}
+
+const char* profilePassName(ProfilePass pass)
+{
+	switch (pass)
+	{
+	case ProfilePass::Iterate:
+		return "iterate";
+	case ProfilePass::Preview:
+		return "preview";
+	case ProfilePass::Colorize:
+		return "colorize";
+	case ProfilePass::Supersample:
+		return "supersample";
+	case ProfilePass::Readback:
+		return "readback";
+	default:
+		return "present";
+	}
+}
+
+FrameProfiler::FrameProfiler(bool recordTrace)
+	: m_TimerQueries(timerQueriesAvailable()), m_RecordTrace(recordTrace), m_Slots(latency)
+	, m_CpuOrigin(std::chrono::steady_clock::now())
+{
+	for (Slot& slot : m_Slots)
+	{
+		glGenBuffers(1, &slot.counters);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, slot.counters);
+		glBufferData(GL_COPY_WRITE_BUFFER, maximumCounters * 2 * sizeof(GLuint), nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (!m_TimerQueries)
+		return;
+
+	m_OverlayTexels.resize(historyFrames * profilePassCount);
+	glGenTextures(1, &m_OverlayTexture);
+	glBindTexture(GL_TEXTURE_2D, m_OverlayTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, historyFrames, profilePassCount, 0, GL_RED, GL_FLOAT, m_OverlayTexels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	const std::string defines = "#version 330 core\n#define PASSES " + std::to_string(profilePassCount)
+		+ "\n#define HISTORY_FRAMES " + std::to_string(historyFrames) + "\n";
+	m_OverlayProgram = cachedProgram(overlay_vertex_text, defines + overlay_fragment_text);
+}
+
+FrameProfiler::~FrameProfiler()
+{
+	// the overlay program belongs to the program cache
+	for (Slot& slot : m_Slots)
+	{
+		if (!slot.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+		glDeleteBuffers(1, &slot.counters);
+	}
+	glDeleteTextures(1, &m_OverlayTexture);
+}
+
+bool FrameProfiler::timerQueriesAvailable()
+{
+	return GLAD_GL_VERSION_3_3 != 0;
+}
+
+int FrameProfiler::query(Slot& slot)
+{
+	if (slot.usedQueries == static_cast<int>(slot.queries.size()))
+	{
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		slot.queries.push_back(query);
+	}
+	return slot.usedQueries++;
+}
+
+void FrameProfiler::beginFrame()
+{
+	Slot& slot = m_Slots[m_Current];
+	if (slot.pending)
+		resolve(slot);
+
+	slot.usedQueries = slot.usedCounters = 0;
+	slot.events.clear();
+	slot.frame = Frame();
+	slot.frame.index = m_FrameIndex++;
+	m_FrameStart = std::chrono::steady_clock::now();
+	slot.frame.cpuStart = milliseconds(m_FrameStart - m_CpuOrigin);
+	m_OpenEvent = -1;
+
+	if (m_TimerQueries)
+	{
+		// the frame's own begin and end
+		glQueryCounter(slot.queries[query(slot)], GL_TIMESTAMP);
+		query(slot);
+	}
+}
+
+void FrameProfiler::begin(ProfilePass pass)
+{
+	if (!m_TimerQueries)
+		return;
+
+	Slot& slot = m_Slots[m_Current];
+	m_OpenEvent = static_cast<int>(slot.events.size());
+	slot.events.push_back({ pass, query(slot), -1 });
+	glQueryCounter(slot.queries[slot.events.back().begin], GL_TIMESTAMP);
+}
+
+void FrameProfiler::end(ProfilePass pass)
+{
+	if (!m_TimerQueries || m_OpenEvent < 0)
+		return;
+
+	Slot& slot = m_Slots[m_Current];
+	PendingEvent& event = slot.events[m_OpenEvent];
+	if (event.pass != pass)
+		return;
+	event.end = query(slot);
+	glQueryCounter(slot.queries[event.end], GL_TIMESTAMP);
+	m_OpenEvent = -1;
+}
+
+void FrameProfiler::countIterations(ProgressiveRenderer& renderer)
+{
+	Slot& slot = m_Slots[m_Current];
+	if (slot.usedCounters < maximumCounters
+		&& renderer.takeIterationCount(slot.counters, slot.usedCounters * 2 * sizeof(GLuint)))
+		++slot.usedCounters;
+}
+
+void FrameProfiler::endFrame()
+{
+	Slot& slot = m_Slots[m_Current];
+	if (m_TimerQueries)
+		glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+	slot.frame.cpuMilliseconds = milliseconds(std::chrono::steady_clock::now() - m_FrameStart);
+	slot.pending = true;
+	m_Current = (m_Current + 1) % latency;
+}
+
+void FrameProfiler::flush()
+{
+	// m_Current is the oldest frame in flight
+	for (int i = 0; i < latency; ++i)
+	{
+		Slot& slot = m_Slots[(m_Current + i) % latency];
+		if (slot.pending)
+			resolve(slot);
+	}
+}
+
+void FrameProfiler::resolve(Slot& slot)
+{
+	Frame& frame = slot.frame;
+	if (m_TimerQueries)
+	{
+		// latency frames later these are normally available and do not wait
+		std::vector<GLuint64> timestamps(slot.usedQueries);
+		for (int i = 0; i < slot.usedQueries; ++i)
+			glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+		if (!m_GpuOriginKnown)
+		{
+			m_GpuOrigin = timestamps[0];
+			m_GpuOriginKnown = true;
+		}
+		auto toMilliseconds = [&](GLuint64 timestamp) { return (static_cast<double>(timestamp) - static_cast<double>(m_GpuOrigin)) * 1e-6; };
+
+		frame.gpuStart = toMilliseconds(timestamps[0]);
+		frame.gpuMilliseconds = (static_cast<double>(timestamps[1]) - static_cast<double>(timestamps[0])) * 1e-6;
+		for (const PendingEvent& pending : slot.events)
+		{
+			// a pass that was never ended does not count
+			if (pending.end < 0)
+				continue;
+			const Event event = { pending.pass, toMilliseconds(timestamps[pending.begin]), toMilliseconds(timestamps[pending.end]) };
+			frame.passMilliseconds[static_cast<int>(event.pass)] += event.end - event.start;
+			frame.events.push_back(event);
+		}
+	}
+
+	// the copies of the counters came before the end query, so they are done as well
+	if (slot.usedCounters > 0)
+	{
+		std::vector<GLuint> counters(slot.usedCounters * 2);
+		glBindBuffer(GL_COPY_READ_BUFFER, slot.counters);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, counters.size() * sizeof(GLuint), counters.data());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		frame.iterations = 0;
+		for (int i = 0; i < slot.usedCounters; ++i)
+			frame.iterations += static_cast<std::int64_t>(counters[2 * i]) | (static_cast<std::int64_t>(counters[2 * i + 1]) << 32);
+	}
+
+	slot.pending = false;
+	m_History.push_back(frame);
+	if (static_cast<int>(m_History.size()) > historyFrames)
+		m_History.pop_front();
+	if (m_RecordTrace)
+		m_Trace.push_back(frame);
+}
+
+FrameProfiler::Frame FrameProfiler::average(int frames) const
+{
+	Frame average;
+	const int count = std::min(frames, static_cast<int>(m_History.size()));
+	if (count == 0)
+		return average;
+
+	int counted = 0;
+	std::int64_t iterations = 0;
+	for (auto frame = m_History.end() - count; frame != m_History.end(); ++frame)
+	{
+		average.cpuMilliseconds += frame->cpuMilliseconds / count;
+		average.gpuMilliseconds += frame->gpuMilliseconds / count;
+		for (int pass = 0; pass < profilePassCount; ++pass)
+			average.passMilliseconds[pass] += frame->passMilliseconds[pass] / count;
+		if (frame->iterations >= 0)
+		{
+			iterations += frame->iterations;
+			++counted;
+		}
+	}
+	average.index = m_History.back().index;
+	if (counted > 0)
+		average.iterations = iterations / counted;
+	return average;
+}
+
+bool FrameProfiler::writeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+	// microseconds of a long session still to the nanosecond
+	file << std::fixed << std::setprecision(3);
+
+	if (endsWith(path, ".csv"))
+	{
+		file << "frame,cpu_start_ms,cpu_ms,gpu_ms";
+		for (int pass = 0; pass < profilePassCount; ++pass)
+			file << "," << profilePassName(static_cast<ProfilePass>(pass)) << "_ms";
+		file << ",iterations\n";
+		for (const Frame& frame : m_Trace)
+		{
+			file << frame.index << "," << frame.cpuStart << "," << frame.cpuMilliseconds << "," << frame.gpuMilliseconds;
+			for (int pass = 0; pass < profilePassCount; ++pass)
+				file << "," << frame.passMilliseconds[pass];
+			file << "," << frame.iterations << "\n";
+		}
+		return static_cast<bool>(file);
+	}
+
+	// complete events in microseconds, the CPU frames and the GPU passes on two tracks and
+	// the iterations as a counter. Each track runs on its own clock from the first frame.
+	file << "{\"traceEvents\":[\n"
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"cpu frames\"}},\n"
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"gpu passes\"}}";
+	for (const Frame& frame : m_Trace)
+	{
+		file << ",\n{\"name\":\"frame\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << frame.cpuStart * 1e3
+			<< ",\"dur\":" << frame.cpuMilliseconds * 1e3 << ",\"args\":{\"frame\":" << frame.index
+			<< ",\"gpu_ms\":" << frame.gpuMilliseconds << "}}";
+		for (const Event& event : frame.events)
+			file << ",\n{\"name\":\"" << profilePassName(event.pass) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":"
+				<< event.start * 1e3 << ",\"dur\":" << (event.end - event.start) * 1e3 << ",\"args\":{\"frame\":" << frame.index << "}}";
+		if (frame.iterations >= 0)
+			file << ",\n{\"name\":\"iterations\",\"ph\":\"C\",\"pid\":0,\"ts\":" << frame.cpuStart * 1e3
+				<< ",\"args\":{\"iterations\":" << frame.iterations << "}}";
+	}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
+
+void FrameProfiler::drawOverlay(int width, int height)
+{
+	if (!m_TimerQueries || !m_OverlayProgram || m_History.empty())
+		return;
+
+	// the newest frame on the right, columns without a frame yet stay empty
+	double slowest = 0.0;
+	const int offset = historyFrames - static_cast<int>(m_History.size());
+	std::fill(m_OverlayTexels.begin(), m_OverlayTexels.end(), 0.0f);
+	for (int column = offset; column < historyFrames; ++column)
+	{
+		const Frame& frame = m_History[column - offset];
+		double stacked = 0.0;
+		for (int pass = 0; pass < profilePassCount; ++pass)
+		{
+			stacked += frame.passMilliseconds[pass];
+			m_OverlayTexels[pass * historyFrames + column] = static_cast<float>(stacked);
+		}
+		slowest = std::max(slowest, stacked);
+	}
+	// whole frame budgets, so that the scale only jumps when a frame crosses one, and slow
+	// outliers such as the first frame are cut off
+	const double top = frameBudget * std::min(std::max(std::ceil(slowest / frameBudget), 2.0), maximumBudgets);
+
+	glBindTexture(GL_TEXTURE_2D, m_OverlayTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, historyFrames, profilePassCount, GL_RED, GL_FLOAT, m_OverlayTexels.data());
+
+	const int graphWidth = std::min(overlayWidth, width - 2 * overlayMargin);
+	const int graphHeight = std::min(overlayHeight, height - 2 * overlayMargin);
+	if (graphWidth <= 0 || graphHeight <= 0)
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(overlayMargin, overlayMargin, graphWidth, graphHeight);
+	glUseProgram(m_OverlayProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_OverlayTexture);
+	glUniform1i(glGetUniformLocation(m_OverlayProgram, "u_Stacked"), 0);
+	glUniform1f(glGetUniformLocation(m_OverlayProgram, "u_Milliseconds"), static_cast<float>(top));
+	glUniform1f(glGetUniformLocation(m_OverlayProgram, "u_Budget"), static_cast<float>(frameBudget));
+	glUniform1f(glGetUniformLocation(m_OverlayProgram, "u_Height"), static_cast<float>(graphHeight));
+	glUniform3fv(glGetUniformLocation(m_OverlayProgram, "u_Colors"), profilePassCount, passColors);
+	drawFullscreenQuad();
+	glViewport(0, 0, width, height);
+}
@@ -0,0 +1,60 @@
+#include "glitch_detection.hpp"
+
+#include <deque>
+
+bool pickGlitchReference(const std::vector<unsigned char>& glitched, int width, int height, int& x, int& y)
+{
+	// Breadth first from every clean pixel, the image border counts as clean too. The queue
+	// has to stay in distance order, so the clean pixels go in before the glitched ones on the
+	// border.
+	std::vector<int> distance(glitched.size(), -1);
+	std::deque<int> queue;
+	bool any = false;
+	for (int pixel = 0; pixel < width * height; ++pixel)
+	{
+		if (!glitched[pixel])
+		{
+			distance[pixel] = 0;
+			queue.push_back(pixel);
+		}
+		any = any || glitched[pixel];
+	}
+	if (!any)
+		return false;
+	for (int pixel = 0; pixel < width * height; ++pixel)
+	{
+		const int column = pixel % width, row = pixel / width;
+		if (glitched[pixel] && (column == 0 || row == 0 || column == width - 1 || row == height - 1))
+		{
+			distance[pixel] = 1;
+			queue.push_back(pixel);
+		}
+	}
+
+	int deepest = -1;
+	while (!queue.empty())
+	{
+		const int pixel = queue.front();
+		queue.pop_front();
+		if (glitched[pixel] && (deepest < 0 || distance[pixel] > distance[deepest]))
+			deepest = pixel;
+
+		const int column = pixel % width, row = pixel / width;
+		const int neighbours[4][2] = { { column - 1, row }, { column + 1, row }, { column, row - 1 }, { column, row + 1 } };
+		for (const auto& neighbour : neighbours)
+		{
+			if (neighbour[0] < 0 || neighbour[1] < 0 || neighbour[0] >= width || neighbour[1] >= height)
+				continue;
+			const int next = neighbour[1] * width + neighbour[0];
+			if (distance[next] < 0)
+			{
+				distance[next] = distance[pixel] + 1;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	x = deepest % width;
+	y = deepest / width;
+	return true;
+}
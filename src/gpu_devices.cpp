@@ -0,0 +1,145 @@
+#include "gpu_devices.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#ifndef PLATFORM_WINDOWS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace
+{
+	std::vector<std::unique_ptr<GpuDevice>> devices;
+
+	// more than any render node holds
+	const int maximumDevices = 16;
+}
+
+const std::vector<std::unique_ptr<GpuDevice>>& gpuDevices()
+{
+	return devices;
+}
+
+void closeGpuDevices()
+{
+	devices.clear();
+}
+
+#ifdef PLATFORM_WINDOWS
+
+GpuDevice::~GpuDevice() = default;
+
+bool GpuDevice::makeCurrent() const
+{
+	return false;
+}
+
+void GpuDevice::release() const
+{
+}
+
+int openGpuDevices(int)
+{
+	return 0;
+}
+
+#else
+
+GpuDevice::~GpuDevice()
+{
+	if (m_Context)
+		eglDestroyContext(m_Display, m_Context);
+	if (m_Surface)
+		eglDestroySurface(m_Display, m_Surface);
+	if (m_Display)
+		eglTerminate(m_Display);
+}
+
+bool GpuDevice::makeCurrent() const
+{
+	// the client API is per thread, and a new thread starts out with OpenGL ES
+	return eglBindAPI(EGL_OPENGL_API) && eglMakeCurrent(m_Display, m_Surface, m_Surface, m_Context);
+}
+
+void GpuDevice::release() const
+{
+	eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+int openGpuDevices(int count)
+{
+	closeGpuDevices();
+
+	const auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+	const auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(eglGetProcAddress("eglQueryDeviceStringEXT"));
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	EGLDeviceEXT found[maximumDevices];
+	EGLint foundCount = 0;
+	if (!queryDevices || !queryDeviceString || !getPlatformDisplay || !queryDevices(maximumDevices, found, &foundCount))
+	{
+		std::cerr << "EGL can not enumerate devices!\n";
+		return 0;
+	}
+
+	for (EGLint index = 0; index < foundCount && (count == 0 || static_cast<int>(devices.size()) < count); ++index)
+	{
+		const char* extensions = queryDeviceString(found[index], EGL_EXTENSIONS);
+		if (extensions && std::strstr(extensions, "EGL_MESA_device_software"))
+			continue;
+
+		std::unique_ptr<GpuDevice> device(new GpuDevice());
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, found[index], nullptr);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+			continue;
+		device->m_Display = display;
+
+		const EGLint configAttributes[] =
+		{
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configs = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0)
+			continue;
+
+		// the renderers draw into their own framebuffers, the surface only has to exist
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		device->m_Surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		if (device->m_Surface == EGL_NO_SURFACE)
+		{
+			device->m_Surface = nullptr;
+			continue;
+		}
+
+		eglBindAPI(EGL_OPENGL_API);
+		device->m_Context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+		if (device->m_Context == EGL_NO_CONTEXT)
+		{
+			device->m_Context = nullptr;
+			continue;
+		}
+
+		if (!device->makeCurrent() || (devices.empty() && !gladLoadGLLoader((GLADloadproc)eglGetProcAddress)))
+		{
+			device->release();
+			continue;
+		}
+
+		// the same state glInit() leaves the GLFW context in
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		const GLubyte* renderer = glGetString(GL_RENDERER);
+		device->m_Name = renderer ? reinterpret_cast<const char*>(renderer) : "GPU";
+		device->release();
+		devices.push_back(std::move(device));
+	}
+
+	return static_cast<int>(devices.size());
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+	float binScale(const Histogram& histogram)
+	{
+		return histogram.maximum > histogram.minimum ? histogramBins / (histogram.maximum - histogram.minimum) : 0.0f;
+	}
+}
+
+Histogram buildHistogram(const float* smooth, std::size_t count)
+{
+	Histogram histogram;
+	histogram.minimum = INFINITY;
+	histogram.maximum = -INFINITY;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (std::isnan(smooth[i]))
+			continue;
+		histogram.minimum = std::min(histogram.minimum, smooth[i]);
+		histogram.maximum = std::max(histogram.maximum, smooth[i]);
+	}
+
+	histogram.cdf.assign(histogramBins, 0.0f);
+	if (histogram.minimum > histogram.maximum)
+		return histogram;
+
+	std::vector<std::uint32_t> bins(histogramBins, 0);
+	const float scale = binScale(histogram);
+	for (std::size_t i = 0; i < count; ++i)
+		if (!std::isnan(smooth[i]))
+			++bins[std::min(static_cast<int>((smooth[i] - histogram.minimum) * scale), histogramBins - 1)];
+
+	std::uint64_t total = 0;
+	for (std::uint32_t bin : bins)
+		total += bin;
+	std::uint64_t running = 0;
+	for (int i = 0; i < histogramBins; ++i)
+	{
+		running += bins[i];
+		histogram.cdf[i] = static_cast<float>(running) / static_cast<float>(total);
+	}
+	return histogram;
+}
+
+float histogramPosition(const Histogram& histogram, float smooth)
+{
+	const float position = (smooth - histogram.minimum) * binScale(histogram);
+	// values outside the range come from tiles of an image whose histogram is shared
+	const int bin = std::min(std::max(static_cast<int>(position), 0), histogramBins - 1);
+	const float below = bin > 0 ? histogram.cdf[bin - 1] : 0.0f;
+	const float weight = std::min(std::max(position - bin, 0.0f), 1.0f);
+	return below + weight * (histogram.cdf[bin] - below);
+}
@@ -11,120 +11,133 @@
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
-#include "linmath.h"
+#include "batch_renderer.hpp"
+#include "camera.hpp"
+#include "farm.hpp"
+#include "formula.hpp"
+#include "gpu_devices.hpp"
+#include "frame_pacer.hpp"
+#include "frame_profiler.hpp"
+#include "mailbox.hpp"
+#include "options.hpp"
+#include "palette.hpp"
+#include "progressive_renderer.hpp"
+#include "render_target.hpp"
+#include "sequence_renderer.hpp"
+#include "shader.hpp"
+#include "tile_cache.hpp"
+#include "tile_pyramid.hpp"
 
 namespace
 {
 	GLFWwindow* window;
-	GLuint vertex_array, vertex_buffer, index_buffer, program;
 
-	float vertices[4 * 3] =
+	// R/F double or halve the iteration cap, the renderer continues from where it was
+	int maxIterations = 100;
+	// I toggles the interior shortcuts, for comparing them against plain iteration
+	bool interiorDetection = true;
+	// M cycles through formulaPresets(), continuing after the formula of the command line
+	Formula formula;
+	int formulaPreset = 0;
+	// P cycles through palettes(), C starts or stops cycling the colors, both only rerun
+	// the coloring pass
+	int palette = 0;
+	bool colorCycling = false;
+	// H switches between coloring by iteration count and by histogram
+	bool histogramColoring = false;
+	// T shows the GPU time of the passes of the last frames, with averages in the title
+	bool profileOverlay = false;
+	// palette cycles per second while cycling
+	const double colorCycleSpeed = 0.25;
+	// the iteration count is stored in a float texture, which is exact up to 2^24
+	const int maximumIterationCap = 1 << 24;
+	// deepest zoom of the deltas' number format, see ProgressiveRenderer::minimumScale()
+	double minimumScale = minimumFloatScale;
+	// while zooming, fresh pixels are rendered at 1 / previewDownscale of the resolution
+	const int previewDownscale = 4;
+	// seconds between camera updates while a movement key is held
+	const double inputInterval = 0.002;
+
+	// Everything the render thread needs to know about the input, published by the main
+	// thread whenever it changes.
+	struct ViewState
 	{
-		-1.0f, -1.0f, 0.0f,
-		 1.0f, -1.0f, 0.0f,
-		 1.0f,  1.0f, 0.0f,
-		-1.0f,  1.0f, 0.0f
-	};
-
-	const char* vertex_shader_text = R"(
-		#version 330 core
-	
-		layout(location = 0) in vec3 a_Position;
-
-		uniform mat4 P;
-
-		out vec3 v_Position;
-		out vec2 v_ComplexValue;
-
-		void main()
+		Camera camera;
+		int width = 0, height = 0;
+		int maxIterations = 100;
+		bool interiorDetection = true;
+		Formula formula;
+		int palette = 0;
+		bool colorCycling = false;
+		bool histogramColoring = false;
+		bool profileOverlay = false;
+		// cleared once the window is closed, which ends the render thread
+		bool running = true;
+
+		bool operator==(const ViewState& rhs) const
 		{
-			v_Position = a_Position;
-			v_ComplexValue = 2.0f * (a_Position.xy) - vec2(1.0f, 0.0f);
-
-		    gl_Position = P * vec4(a_Position, 1.0f);
-		}
-	)";
-	
-	const char* fragment_shader_text = R"(
-		#version 330 core
-
-		precision highp float;
-
-		layout(location = 0) out vec4 color;
-
-		in vec3 v_Position;
-		in vec2 v_ComplexValue;
-
-		// All components are in the range [0…1], including hue.
-		vec3 hsv2rgb(vec3 c)
-		{
-			vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
-			vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
-			return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
-		}
-
-		vec2 squareImaginary(vec2 number){
-			return vec2(
-				pow(number.x,2)-pow(number.y,2),
-				2*number.x*number.y
-			);
+			return camera == rhs.camera && width == rhs.width && height == rhs.height
+				&& maxIterations == rhs.maxIterations && interiorDetection == rhs.interiorDetection
+				&& formula == rhs.formula && palette == rhs.palette && colorCycling == rhs.colorCycling
+				&& histogramColoring == rhs.histogramColoring && profileOverlay == rhs.profileOverlay
+				&& running == rhs.running;
 		}
+		bool operator!=(const ViewState& rhs) const { return !(*this == rhs); }
+	};
+}
 
-		vec2 mulImaginary(vec2 lhs, vec2 rhs)
+// Compiles the programs of every formula preset on a hidden context that shares objects with
+// the viewer's, so the first frame does not wait for them. A program the render thread needs
+// while it is being compiled here is waited for, not compiled twice, see cachedProgram().
+static void compilePresets(const Options& options, GLFWwindow* context, const std::atomic<bool>& quitting)
+{
+	glfwMakeContextCurrent(context);
+	{
+		// configured like the viewer's renderers, the preview does not estimate distances
+		const IterationKernel kernel = options.computeKernel ? IterationKernel::Compute : IterationKernel::Fragment;
+		ProgressiveRenderer plain(kernel, options.workGroupSize);
+		ProgressiveRenderer estimating(kernel, options.workGroupSize);
+		for (ProgressiveRenderer* renderer : { &plain, &estimating })
 		{
-			return vec2(
-				lhs.x * rhs.x - lhs.y * rhs.y,
-				lhs.x * rhs.y + lhs.y * rhs.x
-			);
+			renderer->setOptimizedKernel(options.optimizedKernel);
+			renderer->setDeltaPrecision(options.deltaPrecision);
 		}
+		estimating.setDistanceEstimation(options.antialias > 1);
 
-		float iterateMandebrot()
+		for (const Formula& preset : formulaPresets())
 		{
-			const int maxIterations = 100;
-			int iteration = 0;
-
-			vec2 z = vec2(0.0f, 0.0f);
-
-			for(iteration = 0; iteration < maxIterations; ++iteration)
-			{
-				// z = squareImaginary(z) + v_ComplexValue;
-				z = mulImaginary(squareImaginary(z), z) + v_ComplexValue;
-				// z = squareImaginary(squareImaginary(z)) + v_ComplexValue;
-
-				if(length(z) > 64)
-				{
-					return float(iteration - log(length(z))/log(16.0f)) / maxIterations;
-				}
-			}
-			return 0.0f;
+			if (quitting)
+				break;
+			plain.prepare(preset);
+			estimating.prepare(preset);
 		}
-
-		void main()
-		{
-			float intensity = iterateMandebrot();
-
-			// vec3 rgb = vec3(intensity);
-			// color = vec4(rgb, 1.0f);
-
-			vec3 hsv = ceil(intensity) * hsv2rgb(vec3(intensity, 1.0f, 1.0f));
-		    color = vec4(hsv, 1.0f);
-		}
-	)";
+	}
+	glfwMakeContextCurrent(NULL);
 }
 
-static void glInit()
+// Returns false if no window or context could be created.
+static bool glInit(bool visible)
 {
 	if (!glfwInit())
-		exit(EXIT_FAILURE);
+		return false;
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	// the offline renderer only needs a context, it draws into its own framebuffers
+	glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 	
 	window = glfwCreateWindow(
 		512, 512, "Mandelbrot Set", NULL, NULL);
@@ -132,7 +145,7 @@ static void glInit()
 	{
 		std::cerr << "Failed to create window!\n";
 		glfwTerminate();
-		exit(EXIT_FAILURE);
+		return false;
 	}
 
 	glfwMakeContextCurrent(window);
@@ -142,145 +155,500 @@ static void glInit()
 		std::cerr << "Failed to initialize glad!\n";
 	}
 
-	glfwSwapInterval(1);
-
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// Initialize VAO, VBO, IBO
-	glGenVertexArrays(1, &vertex_array);
-	glBindVertexArray(vertex_array);
-
-	glGenBuffers(1, &vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 12, vertices, GL_STATIC_DRAW);
-	
-	glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, nullptr);
+	createFullscreenQuad();
+	return true;
+}
 
-	glGenBuffers(1, &index_buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+static void keyCallback(GLFWwindow*, int key, int, int action, int)
+{
+	if (action != GLFW_PRESS)
+		return;
+
+	if (key == GLFW_KEY_R)
+		maxIterations = std::min(maxIterations * 2, maximumIterationCap);
+	else if (key == GLFW_KEY_F)
+		maxIterations = std::max(maxIterations / 2, 1);
+	else if (key == GLFW_KEY_I)
+	{
+		interiorDetection = !interiorDetection;
+		std::cout << "Interior detection " << (interiorDetection ? "on" : "off") << "\n";
+	}
+	else if (key == GLFW_KEY_M)
+	{
+		const std::vector<Formula>& presets = formulaPresets();
+		formulaPreset = (formulaPreset + 1) % static_cast<int>(presets.size());
+		formula = presets[formulaPreset];
+	}
+	else if (key == GLFW_KEY_P)
+	{
+		palette = (palette + 1) % static_cast<int>(palettes().size());
+		std::cout << "Palette " << palettes()[palette].name << "\n";
+	}
+	else if (key == GLFW_KEY_C)
+		colorCycling = !colorCycling;
+	else if (key == GLFW_KEY_H)
+	{
+		// without compute shaders the renderers stay at coloring by iteration count
+		histogramColoring = !histogramColoring && GLAD_GL_VERSION_4_3;
+		std::cout << "Histogram coloring " << (histogramColoring ? "on" : "off") << "\n";
+	}
+	else if (key == GLFW_KEY_T)
+		profileOverlay = !profileOverlay;
+}
 
-	unsigned int indices[6] = { 0, 1, 2, 3 };
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(float) * 4, indices, GL_STATIC_DRAW);
+// Fills everything but the camera and the framebuffer size from the key state.
+static void readKeyState(ViewState& view)
+{
+	view.maxIterations = maxIterations;
+	view.interiorDetection = interiorDetection;
+	view.formula = formula;
+	view.palette = palette;
+	view.colorCycling = colorCycling;
+	view.histogramColoring = histogramColoring;
+	view.profileOverlay = profileOverlay;
+}
 
-	// Initialize shader
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_text, 0);
-    glCompileShader(vertex_shader);
+// Body of the render thread. Owns the GL context and always renders the latest published
+// view, until one arrives that is no longer running. Titles go back to the main thread,
+// which is the only one allowed to set them.
+static void renderViewer(const Options& options, Mailbox<ViewState>& views, Mailbox<std::string>& titles)
+{
+	glfwMakeContextCurrent(window);
+	// without vsync a frame is shown as soon as it is done, which only paces it with --frame-time
+	glfwSwapInterval(options.vsync ? 1 : 0);
 
-	GLint isCompiled = 0;
-	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &isCompiled);
-	if (isCompiled == GL_FALSE)
+	// the GL objects below must be gone before the context is released
 	{
-		GLint maxLength = 0;
-		glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &maxLength);
+		// the main thread publishes the first view before starting us
+		ViewState view;
+		views.take(view);
+		const int antialias = options.antialias;
+		float paletteOffset = options.paletteOffset;
+
+		const IterationKernel kernel = options.computeKernel ? IterationKernel::Compute : IterationKernel::Fragment;
+		ProgressiveRenderer renderer(kernel, options.workGroupSize);
+		ProgressiveRenderer preview(kernel, options.workGroupSize);
+		renderer.setOptimizedKernel(options.optimizedKernel);
+		preview.setOptimizedKernel(options.optimizedKernel);
+		renderer.setDeltaPrecision(options.deltaPrecision);
+		preview.setDeltaPrecision(options.deltaPrecision);
+		// the preview is never supersampled
+		renderer.setDistanceEstimation(antialias > 1);
+		preview.iterationsPerPass = renderer.iterationsPerPass * previewDownscale;
+		// the programs of the other presets come from compilePresets(), so that M is instant
+
+		// the preview fills in for full resolution pixels until they are resolved
+		bool previewShown = false;
+
+		// the colored frame, redrawn only while the renderer still has work to do
+		RenderTarget cache;
+
+		// the frame is supersampled again once color cycling stops
+		bool wasCycling = false;
+		// a finished frame that still waits for its supersampling pass
+		bool supersampleDue = false;
+
+		// finished views are stored, and a view that was finished before skips iterating
+		std::unique_ptr<TileCache> tileCache;
+		if (!options.tileCache.empty())
+			tileCache.reset(new TileCache(options.tileCache));
+		std::vector<float> cachedResult;
+
+		// --pyramid shows tiles at discrete zoom levels instead of the two renderers
+		std::unique_ptr<TilePyramid> pyramid;
+		if (options.pyramid)
+		{
+			pyramid.reset(new TilePyramid(kernel, options.workGroupSize));
+			pyramid->renderer().setOptimizedKernel(options.optimizedKernel);
+			pyramid->renderer().setDeltaPrecision(options.deltaPrecision);
+			pyramid->setTileCache(tileCache.get());
+			std::cout << "Tiles are colored by iteration count at a fixed palette offset, H and C do not apply\n";
+		}
+		// the renderer whose passes are paced and reported in the title
+		ProgressiveRenderer& shown = pyramid ? pyramid->renderer() : renderer;
 
-		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
-		glGetShaderInfoLog(vertex_shader, maxLength, &maxLength, &infoLog[0]);
+		// always measures, so the overlay has a history as soon as it is shown
+		FrameProfiler profiler(!options.profile.empty());
 
-		for (std::vector<char>::const_iterator i = infoLog.begin(); i != infoLog.end(); ++i)
-    		std::cout << *i;
-		std::cout << "\n";
-	}
- 
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_text, 0);
-    glCompileShader(fragment_shader);
-
-	isCompiled = 0;
-	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &isCompiled);
-	if (isCompiled == GL_FALSE)
-	{
-		GLint maxLength = 0;
-		glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &maxLength);
+		// --frame-time sizes the iterations per pass from the GPU times of the profiler
+		std::unique_ptr<FramePacer> pacer;
+		if (options.frameTime > 0.0)
+		{
+			if (FrameProfiler::timerQueriesAvailable())
+				pacer.reset(new FramePacer(options.frameTime, shown.iterationsPerPass));
+			else
+				std::cerr << "Frame pacing needs GL 3.3 timer queries, iterating a fixed amount per frame\n";
+		}
+		// the iterations per pass of the frames still in flight, by frame index
+		const int pacedFrames = 2 * FrameProfiler::latency;
+		int pacedIterations[pacedFrames] = {};
+		int pacedFrame = -1;
+
+		int titleIterations = 0;
+		Formula titleFormula;
+		DeltaPrecision titlePrecision = DeltaPrecision::Automatic;
+		bool titleOverlay = false;
+		int titleLevel = -1;
+		double titleTime = 0.0;
+		double previousTime = glfwGetTime();
+		for (;;)
+		{
+			// whatever was published in the meantime replaces the view of the last frame
+			const Camera previousCamera = view.camera;
+			views.take(view);
+			if (!view.running)
+				break;
+
+			double currentTime = glfwGetTime();
+			double timeStep = currentTime - previousTime;
+			previousTime = currentTime;
+			profiler.beginFrame();
+
+			// a frame that came back from the GPU resizes the passes of this one
+			if (pacer && !profiler.history().empty() && profiler.history().back().index != pacedFrame)
+			{
+				const FrameProfiler::Frame& frame = profiler.history().back();
+				const double iterate = frame.passMilliseconds[static_cast<int>(ProfilePass::Iterate)];
+				pacer->update(pacedIterations[frame.index % pacedFrames], iterate, frame.gpuMilliseconds - iterate);
+				pacedFrame = frame.index;
+				shown.iterationsPerPass = pacer->iterationsPerPass();
+				preview.iterationsPerPass = shown.iterationsPerPass * previewDownscale;
+			}
+			pacedIterations[profiler.frameIndex() % pacedFrames] = shown.iterationsPerPass;
 
-		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
-		glGetShaderInfoLog(fragment_shader, maxLength, &maxLength, &infoLog[0]);
+			const Camera& camera = view.camera;
+			const bool moving = camera != previousCamera;
+			const bool zooming = camera.scale != previousCamera.scale;
 
-		for (std::vector<char>::const_iterator i = infoLog.begin(); i != infoLog.end(); ++i)
-    		std::cout << *i;
-		std::cout << "\n";
-	}
- 
-    program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glLinkProgram(program);
-
-	GLint isLinked = 0;
-	glGetProgramiv(program, GL_LINK_STATUS, (int *)&isLinked);
-	if (isLinked == GL_FALSE)
-	{
-		GLint maxLength = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
-
-		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
-		glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
-
-		// We don't need the program anymore.
-		glDeleteProgram(program);
-		
-		for (std::vector<char>::const_iterator i = infoLog.begin(); i != infoLog.end(); ++i)
-    		std::cout << *i;
-		std::cout << "\n";
+			const int width = view.width, height = view.height;
+			if (width > 0 && height > 0 && !pyramid)
+			{
+				renderer.resize(width, height);
+				preview.resize(std::max(width / previewDownscale, 1), std::max(height / previewDownscale, 1));
+			}
+			if (width > 0 && height > 0)
+				cache.resize(width, height, { GL_RGBA8 });
+
+			renderer.setMaxIterations(view.maxIterations);
+			preview.setMaxIterations(view.maxIterations);
+			renderer.interiorDetection = preview.interiorDetection = view.interiorDetection;
+			renderer.setFormula(view.formula);
+			preview.setFormula(view.formula);
+
+			// a new palette or offset recolors the finished frame without iterating it again
+			const bool recolor = view.palette != renderer.palette() || view.colorCycling || view.colorCycling != wasCycling
+				|| view.histogramColoring != renderer.histogramColoring();
+			wasCycling = view.colorCycling;
+			renderer.setPalette(view.palette);
+			preview.setPalette(view.palette);
+			renderer.setHistogramColoring(view.histogramColoring);
+			preview.setHistogramColoring(view.histogramColoring);
+			if (view.colorCycling)
+				paletteOffset = static_cast<float>(std::fmod(paletteOffset + timeStep * colorCycleSpeed, 1.0));
+			renderer.paletteOffset = preview.paletteOffset = paletteOffset;
+
+			if (pyramid)
+			{
+				pyramid->configure(view.maxIterations, view.formula, view.palette, options.paletteOffset, antialias);
+				pyramid->renderer().interiorDetection = view.interiorDetection;
+				pyramid->setView(camera, width, height);
+
+				profiler.begin(ProfilePass::Iterate);
+				pyramid->update();
+				profiler.end(ProfilePass::Iterate);
+				profiler.countIterations(pyramid->renderer());
+
+				profiler.begin(ProfilePass::Colorize);
+				pyramid->draw(cache);
+				profiler.end(ProfilePass::Colorize);
+			}
+			else if (zooming)
+			{
+				// Show the last full resolution frame rescaled to the new view right away, with
+				// whatever the low resolution preview managed to resolve this frame on top.
+				preview.setCamera(camera);
+				profiler.begin(ProfilePass::Preview);
+				preview.iterate();
+				profiler.end(ProfilePass::Preview);
+				profiler.countIterations(preview);
+
+				profiler.begin(ProfilePass::Colorize);
+				cache.bind();
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+				renderer.colorize(cache, camera, false);
+				preview.colorize(cache, camera, true);
+				profiler.end(ProfilePass::Colorize);
+				previewShown = true;
+				supersampleDue = false;
+			}
+			else
+			{
+				renderer.setCamera(camera);
+				const TileKey key(camera, width, height, view.maxIterations, view.formula, renderer.selectPrecision(),
+					view.interiorDetection, renderer.resultLayout());
+				if (tileCache && renderer.restarting() && tileCache->load(key, ProgressiveRenderer::resultChannels, cachedResult))
+					renderer.restoreResult(cachedResult);
+
+				bool redrawn = true;
+				if (!renderer.isComplete() || previewShown)
+				{
+					const bool iterating = !renderer.isComplete();
+					profiler.begin(ProfilePass::Iterate);
+					renderer.iterate();
+					profiler.end(ProfilePass::Iterate);
+					profiler.countIterations(renderer);
+					if (tileCache && iterating && renderer.readResult(cachedResult))
+						tileCache->store(key, ProgressiveRenderer::resultChannels, cachedResult);
+
+					profiler.begin(ProfilePass::Colorize);
+					cache.bind();
+					glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+					glClear(GL_COLOR_BUFFER_BIT);
+					if (previewShown)
+						preview.colorize(cache, camera, false);
+					renderer.colorize(cache, camera, previewShown);
+					profiler.end(ProfilePass::Colorize);
+					previewShown = !renderer.isComplete();
+				}
+				else if (recolor)
+				{
+					profiler.begin(ProfilePass::Colorize);
+					cache.bind();
+					renderer.colorize(cache, camera, false);
+					profiler.end(ProfilePass::Colorize);
+				}
+				else
+					redrawn = false;
+
+				// Antialias finished frames once, except while their colors change every frame.
+				// A view that is already waiting would most likely make the pass obsolete, so
+				// it is put off until the view stays.
+				supersampleDue = (supersampleDue || redrawn) && renderer.isComplete() && !view.colorCycling && antialias > 1;
+				if (supersampleDue && !views.pending())
+				{
+					profiler.begin(ProfilePass::Supersample);
+					renderer.supersample(cache, antialias);
+					profiler.end(ProfilePass::Supersample);
+					supersampleDue = false;
+				}
+			}
+
+			// with the overlay the title also carries its averages, refreshed twice a second
+			const bool titleStale = view.profileOverlay && currentTime - titleTime > 0.5;
+			if (titleIterations != view.maxIterations || titleFormula != view.formula
+				|| titlePrecision != shown.deltaPrecision() || titleOverlay != view.profileOverlay || titleStale
+				|| (pyramid && titleLevel != pyramid->level()))
+			{
+				std::ostringstream title;
+				title << "Mandelbrot Set - " << view.formula.name() << " - " << view.maxIterations << " iterations - "
+					<< deltaPrecisionName(shown.deltaPrecision()) << " deltas";
+				if (pyramid)
+					title << " - level " << pyramid->level();
+				if (view.profileOverlay)
+				{
+					const FrameProfiler::Frame average = profiler.average(60);
+					title << std::fixed << std::setprecision(2) << " - GPU " << average.gpuMilliseconds << " ms, CPU "
+						<< average.cpuMilliseconds << " ms";
+					if (pacer)
+						title << ", " << shown.iterationsPerPass << " iterations per pass";
+					if (average.iterations >= 0)
+						title << ", " << std::setprecision(1) << average.iterations / 1e6 << " Miterations per frame";
+				}
+				titles.publish(title.str());
+				glfwPostEmptyEvent();
+				titleIterations = view.maxIterations;
+				titleFormula = view.formula;
+				titlePrecision = shown.deltaPrecision();
+				titleOverlay = view.profileOverlay;
+				titleLevel = pyramid ? pyramid->level() : -1;
+				titleTime = currentTime;
+			}
+
+			profiler.begin(ProfilePass::Present);
+			if (cache.width() > 0)
+				cache.blitToScreen(width, height);
+			profiler.end(ProfilePass::Present);
+			if (view.profileOverlay)
+				profiler.drawOverlay(width, height);
+			profiler.endFrame();
+			glfwSwapBuffers(window);
+
+			// Nothing to render until the view changes, so sleep instead of spinning. The time
+			// spent waiting must not count as a time step.
+			const bool finished = pyramid ? pyramid->isComplete() : !view.colorCycling && renderer.isComplete() && !supersampleDue;
+			if (!moving && finished)
+			{
+				views.wait();
+				previousTime = glfwGetTime();
+			}
+		}
+
+		if (!options.profile.empty())
+		{
+			profiler.flush();
+			if (!profiler.writeTrace(options.profile))
+				std::cerr << "Failed to write " << options.profile << "!\n";
+		}
+
+		releaseProgramCache();
 	}
 
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+	glfwMakeContextCurrent(NULL);
 }
 
 int main(int argc, char* argv[])
 {
-	glInit();
+	Options options = parseOptions(argc, argv);
+	if (!options.shaderCache.empty())
+		setProgramBinaryDirectory(options.shaderCache);
+	if (options.batch() || options.farmWorker())
+	{
+		// every GPU but the default one needs an EGL context of its own
+		if (options.backend == Backend::Gpu && options.gpus != 1)
+		{
+			options.gpus = openGpuDevices(options.gpus);
+			for (const std::unique_ptr<GpuDevice>& device : gpuDevices())
+				std::cerr << "Rendering on " << device->name() << "\n";
+			if (options.gpus <= 1)
+			{
+				std::cerr << "Found no second GPU, rendering on one\n";
+				closeGpuDevices();
+				options.gpus = 1;
+			}
+		}
+		else
+			options.gpus = 1;
+
+		// headless render nodes may have no usable GL driver at all, and the farm coordinator
+		// only colors what the workers send
+		if (options.backend == Backend::Gpu && !options.distributed() && !glInit(false))
+		{
+			// the CPU's float deltas do not resolve deeper views, see delta_precision.hpp
+			if (options.camera.scale < minimumFloatScale)
+			{
+				std::cerr << "No GL for a view below " << minimumFloatScale << ", which the CPU backend does not resolve\n";
+				return EXIT_FAILURE;
+			}
+			std::cerr << "Falling back to the CPU backend\n";
+			options.backend = Backend::Cpu;
+		}
+
+		bool success;
+		if (options.farmWorker())
+			success = runFarmWorker(options);
+		else
+			success = options.animation() ? renderSequence(options) : renderBatch(options);
+		closeGpuDevices();
+		if (window)
+		{
+			releaseProgramCache();
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+		exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (!glInit(true))
+		exit(EXIT_FAILURE);
 
-	float ratio = 1.0f;
-	vec2 offset;
-	offset[0] = offset[1] = 0.0f;
-	GLint p_location = glGetUniformLocation(program, "P");
+	glfwSetKeyCallback(window, keyCallback);
+	maxIterations = std::min(options.maxIterations, maximumIterationCap);
+	interiorDetection = options.interiorDetection;
+	formula = options.formula;
+	palette = options.palette;
+	// without compute shaders the renderers stay at coloring by iteration count
+	histogramColoring = options.histogramColoring && GLAD_GL_VERSION_4_3;
+	const std::vector<Formula>& presets = formulaPresets();
+	// a formula that is no preset continues with the first one
+	const auto preset = std::find(presets.begin(), presets.end(), formula);
+	formulaPreset = static_cast<int>((preset != presets.end() ? preset : presets.end() - 1) - presets.begin());
+	minimumScale = ProgressiveRenderer::minimumScale(options.deltaPrecision);
+
+	// the hidden window's context shares the programs and compiles them in the background
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* compilerWindow = glfwCreateWindow(1, 1, "Mandelbrot Set compiler", NULL, window);
+	std::atomic<bool> quitting{ false };
+	std::thread compilerThread;
+	if (compilerWindow)
+		compilerThread = std::thread(compilePresets, std::cref(options), compilerWindow, std::cref(quitting));
+
+	// From here on the render thread owns the context. This thread only handles events and
+	// moves the camera, so a slow frame never delays the input.
+	Mailbox<ViewState> views;
+	Mailbox<std::string> titles;
+	ViewState view;
+	view.camera = options.camera;
+	glfwGetFramebufferSize(window, &view.width, &view.height);
+	readKeyState(view);
+	views.publish(view);
+	glfwMakeContextCurrent(NULL);
+	std::thread renderThread(renderViewer, std::cref(options), std::ref(views), std::ref(titles));
 
 	double previousTime = glfwGetTime();
 	while (!glfwWindowShouldClose(window))
 	{
 		double currentTime = glfwGetTime();
-		float timeStep = static_cast<float>(currentTime - previousTime);
+		double timeStep = currentTime - previousTime;
 		previousTime = currentTime;
 
-		glClearColor(1.0f, 0.0f, 0.1f, 1);
-		glClear(GL_COLOR_BUFFER_BIT);
+		ViewState next = view;
+		Camera& camera = next.camera;
 
+		// the zoom depth is bounded by the deltas instead of the float coordinates
 		if(glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-			ratio -= (ratio <= 0.0001f) ? 0.0f : timeStep * ratio;
+			camera.scale -= (camera.scale <= minimumScale) ? 0.0 : timeStep * camera.scale;
 		else if(glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-			ratio += (ratio >= 1.0f) ? 0.0f : timeStep * ratio;
+			camera.scale += (camera.scale >= 2.0) ? 0.0 : timeStep * camera.scale;
 
+		HighPrecision step = HighPrecision::fromDouble(timeStep * camera.scale);
 		if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-			offset[1] -= timeStep * ratio;
+			camera.centerY += step;
 		else if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-			offset[1] += timeStep * ratio;
+			camera.centerY -= step;
 		if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-			offset[0] += timeStep * ratio;
+			camera.centerX -= step;
 		else if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-			offset[0] -= timeStep * ratio;
-
-		glUseProgram(program);
+			camera.centerX += step;
 
-		mat4x4 p;
-		mat4x4_ortho(p, 
-			-ratio - offset[0], ratio - offset[0], -ratio - offset[1], ratio - offset[1], 
-			1.f, -1.f);
-		glUniformMatrix4fv(p_location, 1, GL_FALSE, (const GLfloat*)p);
+		const bool moving = camera != view.camera;
+		glfwGetFramebufferSize(window, &next.width, &next.height);
+		readKeyState(next);
+		if (next != view)
+		{
+			view = next;
+			views.publish(view);
+		}
 
-		glBindVertexArray(vertex_array);
-		glDrawArrays(GL_QUADS, 0, 4);
+		std::string title;
+		if (titles.take(title))
+			glfwSetWindowTitle(window, title.c_str());
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		// While the camera moves it is updated at a fixed rate, however long the frames take.
+		// Otherwise sleep until the next key press, window event or title. The time spent
+		// waiting must not count as a time step.
+		if (moving)
+			glfwWaitEventsTimeout(inputInterval);
+		else
+		{
+			glfwWaitEvents();
+			previousTime = glfwGetTime();
+		}
 	}
 
+	// the render thread releases the programs, so the compiler has to be done with them
+	quitting = true;
+	if (compilerThread.joinable())
+		compilerThread.join();
+	view.running = false;
+	views.publish(view);
+	renderThread.join();
+
+	if (compilerWindow)
+		glfwDestroyWindow(compilerWindow);
 	glfwDestroyWindow(window);
 
 	glfwTerminate();
@@ -0,0 +1,256 @@
+#include "options.hpp"
+
+#include "palette.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+static void printUsage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+		<< "  --center-x <decimal>  --center-y <decimal>  view center\n"
+		<< "  --scale <double>      half of the view height in complex units\n"
+		<< "  --iterations <int>    iteration cap\n"
+		<< "  --width <int>  --height <int>  output size in pixels\n"
+		<< "  --tile <int>          tile size of the offline renderer\n"
+		<< "  --output <file.png>   render offline instead of opening a window\n"
+		<< "  --sequence <file>     render a keyframed camera path, --output is then \"-\" for\n"
+		<< "                        raw RGB frames on stdout or a pattern like frame_%05d.png\n"
+		<< "  --backend <gpu|cpu>   offline renderer, gpu falls back to cpu without GL\n"
+		<< "  --threads <int>       worker threads of the cpu backend, 0 uses every core\n"
+		<< "  --interior <on|off>   skip pixels found inside the set early\n"
+		<< "  --boundary-tracing <on|off>  fill interior rectangles on the cpu backend\n"
+		<< "  --kernel <compute|fragment>  gpu iteration kernel, compute needs GL 4.3\n"
+		<< "  --work-group <int>    edge length of the compute work groups\n"
+		<< "  --optimized-kernel <on|off>  strength reduced escape test on the gpu\n"
+		<< "  --precision <auto|float|double-float|double|extended>  delta format of the gpu kernels\n"
+		<< "  --formula <name>      mandelbrot[:power], burning-ship or julia[:power], power 2-6\n"
+		<< "  --julia-x <decimal>  --julia-y <decimal>  constant of --formula julia\n"
+		<< "  --palette <name>      hsv, fire, ocean or grayscale\n"
+		<< "  --palette-offset <float>  shift of the palette in cycles\n"
+		<< "  --coloring <linear|histogram>  color by iteration count or by its histogram\n"
+		<< "  --antialias <int>     subsamples per axis near the boundary, 1-8, gpu only, 1 is off\n"
+		<< "  --vsync <on|off>      wait for the display refresh in the viewer\n"
+		<< "  --frame-time <ms>     adapt the iterations per frame to this gpu time, 0 is fixed\n"
+		<< "  --pyramid <on|off>    explore through cached tiles at discrete zoom levels\n"
+		<< "  --tile-cache <dir>    reuse finished tiles stored in dir and store new ones\n"
+		<< "  --farm-listen <port>  hand the offline render to workers connecting on port\n"
+		<< "  --farm-worker <host:port>  render for the coordinator at host:port\n"
+		<< "  --gpus <int>          gpus of the offline gpu backend, 0 uses every one\n"
+		<< "  --shader-cache <dir>  keep compiled shader binaries in dir across launches\n"
+		<< "  --profile <file>      write gpu pass timings per frame or tile, csv for a .csv file,\n"
+		<< "                        otherwise a chrome://tracing JSON trace\n";
+}
+
+Options parseOptions(int argc, char* argv[])
+{
+	Options options;
+	// applied once the formula is known, whichever order the options came in
+	std::string juliaX, juliaY;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string name = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << name << "\n";
+			printUsage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		const std::string value = argv[++i];
+
+		try
+		{
+			if (name == "--center-x")
+				options.camera.centerX = HighPrecision::fromString(value);
+			else if (name == "--center-y")
+				options.camera.centerY = HighPrecision::fromString(value);
+			else if (name == "--scale")
+				options.camera.scale = std::stod(value);
+			else if (name == "--iterations")
+				options.maxIterations = std::stoi(value);
+			else if (name == "--width")
+				options.width = std::stoi(value);
+			else if (name == "--height")
+				options.height = std::stoi(value);
+			else if (name == "--tile")
+				options.tileSize = std::stoi(value);
+			else if (name == "--vsync" && (value == "on" || value == "off"))
+				options.vsync = (value == "on");
+			else if (name == "--frame-time")
+				options.frameTime = std::stod(value);
+			else if (name == "--pyramid" && (value == "on" || value == "off"))
+				options.pyramid = (value == "on");
+			else if (name == "--tile-cache")
+				options.tileCache = value;
+			else if (name == "--farm-listen")
+				options.farmPort = std::stoi(value);
+			else if (name == "--farm-worker")
+				options.farmCoordinator = value;
+			else if (name == "--gpus")
+				options.gpus = std::stoi(value);
+			else if (name == "--shader-cache")
+				options.shaderCache = value;
+			else if (name == "--profile")
+				options.profile = value;
+			else if (name == "--output")
+				options.output = value;
+			else if (name == "--sequence")
+				options.sequence = value;
+			else if (name == "--backend" && (value == "gpu" || value == "cpu"))
+				options.backend = (value == "cpu") ? Backend::Cpu : Backend::Gpu;
+			else if (name == "--threads")
+				options.threads = std::stoi(value);
+			else if (name == "--interior" && (value == "on" || value == "off"))
+				options.interiorDetection = (value == "on");
+			else if (name == "--boundary-tracing" && (value == "on" || value == "off"))
+				options.boundaryTracing = (value == "on");
+			else if (name == "--kernel" && (value == "compute" || value == "fragment"))
+				options.computeKernel = (value == "compute");
+			else if (name == "--work-group")
+				options.workGroupSize = std::stoi(value);
+			else if (name == "--optimized-kernel" && (value == "on" || value == "off"))
+				options.optimizedKernel = (value == "on");
+			else if (name == "--precision")
+			{
+				if (!parseDeltaPrecision(value, options.deltaPrecision))
+					throw std::invalid_argument(value);
+			}
+			else if (name == "--formula")
+			{
+				if (!parseFormula(value, options.formula))
+					throw std::invalid_argument(value);
+			}
+			else if (name == "--julia-x")
+				juliaX = value;
+			else if (name == "--julia-y")
+				juliaY = value;
+			else if (name == "--palette")
+			{
+				options.palette = findPalette(value);
+				if (options.palette < 0)
+					throw std::invalid_argument(value);
+			}
+			else if (name == "--palette-offset")
+				options.paletteOffset = std::stof(value);
+			else if (name == "--antialias")
+				options.antialias = std::stoi(value);
+			else if (name == "--coloring" && (value == "linear" || value == "histogram"))
+				options.histogramColoring = (value == "histogram");
+			else if (name == "--backend" || name == "--interior" || name == "--boundary-tracing" || name == "--kernel"
+				|| name == "--optimized-kernel" || name == "--coloring" || name == "--vsync"
+				|| name == "--pyramid")
+				throw std::invalid_argument(value);
+			else
+			{
+				std::cerr << "Unknown option " << name << "\n";
+				printUsage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+		}
+		catch (const std::exception&)
+		{
+			std::cerr << "Invalid value '" << value << "' for " << name << "\n";
+			printUsage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (options.formula.kind != FormulaKind::Julia && (!juliaX.empty() || !juliaY.empty()))
+	{
+		std::cerr << "--julia-x and --julia-y need --formula julia\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	try
+	{
+		if (!juliaX.empty())
+			options.formula.juliaX = HighPrecision::fromString(juliaX);
+		if (!juliaY.empty())
+			options.formula.juliaY = HighPrecision::fromString(juliaY);
+	}
+	catch (const std::exception&)
+	{
+		std::cerr << "Invalid Julia constant '" << juliaX << "', '" << juliaY << "'\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.width <= 0 || options.height <= 0 || options.tileSize <= 0 || options.workGroupSize <= 0
+		|| options.maxIterations <= 0 || !(options.camera.scale > 0.0))
+	{
+		std::cerr << "Sizes, iterations and scale must be positive\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.antialias < 1 || options.antialias > 8)
+	{
+		std::cerr << "--antialias takes 1 to 8 samples per axis\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!(options.frameTime >= 0.0))
+	{
+		std::cerr << "--frame-time must not be negative\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.threads < 0)
+	{
+		std::cerr << "--threads must not be negative\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.gpus < 0 || (options.gpus != 1 && !options.batch() && !options.farmWorker()))
+	{
+		std::cerr << "--gpus must not be negative and needs --output or --farm-worker\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.farmPort != 0 && (!options.batch() || options.farmPort < 1 || options.farmPort > 65535))
+	{
+		std::cerr << "--farm-listen needs --output and a port from 1 to 65535\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	// the coordinator sends the view, a worker only takes its backend from the command line
+	if (options.farmWorker() && options.batch())
+	{
+		std::cerr << "--farm-worker does not take --output, the coordinator writes the image\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.backend == Backend::Cpu && !options.batch() && !options.farmWorker())
+	{
+		std::cerr << "--backend cpu needs --output, the viewer always uses the GPU\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.backend == Backend::Cpu && options.camera.scale < minimumFloatScale)
+	{
+		std::cerr << "--backend cpu iterates float deltas, which resolve scales down to " << minimumFloatScale << "\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (options.animation() && !options.batch())
+	{
+		std::cerr << "--sequence needs --output\n";
+		printUsage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	return options;
+}
@@ -0,0 +1,65 @@
+#include "palette.hpp"
+
+#include <cmath>
+
+const std::vector<Palette>& palettes()
+{
+	static const std::vector<Palette> list =
+	{
+		// hsv2rgb() at full saturation and value is piecewise linear between these
+		{ "hsv", { { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 } } },
+		{ "fire", { { 0.1f, 0, 0 }, { 0.8f, 0.1f, 0 }, { 1, 0.6f, 0 }, { 1, 1, 0.6f }, { 1, 0.6f, 0 }, { 0.8f, 0.1f, 0 } } },
+		{ "ocean", { { 0, 0.05f, 0.2f }, { 0, 0.4f, 0.7f }, { 0.9f, 0.95f, 1 }, { 1, 0.7f, 0.2f }, { 0.1f, 0.3f, 0.5f } } },
+		{ "grayscale", { { 0.1f, 0.1f, 0.1f }, { 1, 1, 1 } } }
+	};
+	return list;
+}
+
+int findPalette(const std::string& name)
+{
+	for (std::size_t i = 0; i < palettes().size(); ++i)
+		if (name == palettes()[i].name)
+			return static_cast<int>(i);
+	return -1;
+}
+
+std::vector<unsigned char> paletteTable(int palette)
+{
+	const std::vector<std::array<float, 3>>& stops = palettes()[palette].stops;
+	const int count = static_cast<int>(stops.size());
+
+	std::vector<unsigned char> table(paletteSize * 4);
+	for (int i = 0; i < paletteSize; ++i)
+	{
+		const float position = (i + 0.5f) / paletteSize * count;
+		const int stop = static_cast<int>(position);
+		const float weight = position - stop;
+		const std::array<float, 3>& from = stops[stop % count];
+		const std::array<float, 3>& to = stops[(stop + 1) % count];
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			const float value = from[channel] + weight * (to[channel] - from[channel]);
+			table[4 * i + channel] = static_cast<unsigned char>(std::lround(value * 255.0f));
+		}
+		table[4 * i + 3] = 255;
+	}
+	return table;
+}
+
+std::array<float, 3> samplePalette(const std::vector<unsigned char>& table, float position)
+{
+	// texel i is centered at (i + 0.5) / paletteSize
+	const float texel = (position - std::floor(position)) * paletteSize - 0.5f;
+	const float base = std::floor(texel);
+	const float weight = texel - base;
+	const int from = (static_cast<int>(base) + paletteSize) % paletteSize;
+	const int to = (from + 1) % paletteSize;
+
+	std::array<float, 3> color;
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		const float lower = table[4 * from + channel] / 255.0f, upper = table[4 * to + channel] / 255.0f;
+		color[channel] = lower + weight * (upper - lower);
+	}
+	return color;
+}
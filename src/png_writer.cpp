@@ -0,0 +1,165 @@
+#include "png_writer.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// largest payload of a stored deflate block
+	const std::size_t maxStoredBlock = 65535;
+
+	uint32_t crcTable[256];
+	bool crcTableReady = false;
+
+	uint32_t crc32(uint32_t crc, const unsigned char* data, std::size_t size)
+	{
+		if (!crcTableReady)
+		{
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				crcTable[n] = c;
+			}
+			crcTableReady = true;
+		}
+
+		crc = ~crc;
+		for (std::size_t i = 0; i < size; ++i)
+			crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	uint32_t adler32(uint32_t adler, const unsigned char* data, std::size_t size)
+	{
+		// 5552 is the most bytes that can be summed before b overflows 32 bits
+		uint32_t a = adler & 0xFFFF, b = adler >> 16;
+		while (size > 0)
+		{
+			const std::size_t run = std::min<std::size_t>(size, 5552);
+			for (std::size_t i = 0; i < run; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += run;
+			size -= run;
+		}
+		return (b << 16) | a;
+	}
+
+	void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(static_cast<unsigned char>(value >> 24));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value));
+	}
+}
+
+PngWriter::~PngWriter()
+{
+	if (m_File)
+		std::fclose(m_File);
+}
+
+bool PngWriter::open(const std::string& path, int width, int height)
+{
+	m_File = std::fopen(path.c_str(), "wb");
+	if (!m_File)
+		return false;
+
+	m_Width = width;
+	m_Height = height;
+	m_RowsWritten = 0;
+	m_Adler = 1;
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::fwrite(signature, 1, sizeof(signature), m_File);
+
+	// 8 bit depth, color type 2 (RGB), default compression, filter and no interlace
+	std::vector<unsigned char> header;
+	putBigEndian(header, static_cast<uint32_t>(width));
+	putBigEndian(header, static_cast<uint32_t>(height));
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	writeChunk("IHDR", header.data(), header.size());
+
+	// zlib header without a preset dictionary
+	const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+	writeChunk("IDAT", zlibHeader, sizeof(zlibHeader));
+
+	return std::ferror(m_File) == 0;
+}
+
+bool PngWriter::writeRows(const unsigned char* rgb, int rows)
+{
+	if (!m_File)
+		return false;
+	rows = std::min(rows, m_Height - m_RowsWritten);
+
+	// every scanline gets filter type 0 (none)
+	const std::size_t rowBytes = static_cast<std::size_t>(m_Width) * 3;
+	std::vector<unsigned char> scanlines;
+	scanlines.reserve(rows * (rowBytes + 1));
+	for (int row = 0; row < rows; ++row)
+	{
+		scanlines.push_back(0);
+		scanlines.insert(scanlines.end(), rgb + row * rowBytes, rgb + (row + 1) * rowBytes);
+	}
+	m_Adler = adler32(m_Adler, scanlines.data(), scanlines.size());
+
+	// split into non-final stored blocks, the final empty block is written in close()
+	std::vector<unsigned char> blocks;
+	blocks.reserve(scanlines.size() + (scanlines.size() / maxStoredBlock + 1) * 5);
+	for (std::size_t offset = 0; offset < scanlines.size(); offset += maxStoredBlock)
+	{
+		const uint16_t length = static_cast<uint16_t>(std::min(maxStoredBlock, scanlines.size() - offset));
+		const uint16_t inverted = static_cast<uint16_t>(~length);
+		blocks.insert(blocks.end(), {
+			0,
+			static_cast<unsigned char>(length), static_cast<unsigned char>(length >> 8),
+			static_cast<unsigned char>(inverted), static_cast<unsigned char>(inverted >> 8) });
+		blocks.insert(blocks.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+	}
+	writeChunk("IDAT", blocks.data(), blocks.size());
+
+	m_RowsWritten += rows;
+	return std::ferror(m_File) == 0;
+}
+
+bool PngWriter::close()
+{
+	if (!m_File)
+		return false;
+
+	// final empty stored block and the checksum of the uncompressed data
+	std::vector<unsigned char> tail = { 1, 0x00, 0x00, 0xFF, 0xFF };
+	putBigEndian(tail, m_Adler);
+	writeChunk("IDAT", tail.data(), tail.size());
+	writeChunk("IEND", nullptr, 0);
+
+	const bool complete = m_RowsWritten == m_Height && std::ferror(m_File) == 0;
+	const bool closed = std::fclose(m_File) == 0;
+	m_File = nullptr;
+	return complete && closed;
+}
+
+void PngWriter::writeChunk(const char* type, const unsigned char* data, std::size_t size)
+{
+	std::vector<unsigned char> length;
+	putBigEndian(length, static_cast<uint32_t>(size));
+	std::fwrite(length.data(), 1, length.size(), m_File);
+
+	uint32_t crc = crc32(0, reinterpret_cast<const unsigned char*>(type), 4);
+	crc = crc32(crc, data, size);
+	std::fwrite(type, 1, 4, m_File);
+	if (size > 0)
+		std::fwrite(data, 1, size, m_File);
+
+	std::vector<unsigned char> checksum;
+	putBigEndian(checksum, crc);
+	std::fwrite(checksum.data(), 1, checksum.size(), m_File);
+}
@@ -0,0 +1,2143 @@
+#include "progressive_renderer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "histogram.hpp"
+#include "interior_detection.hpp"
+#include "palette.hpp"
+#include "shader.hpp"
+
+namespace
+{
+	// re-reference once the view has been panned this many screens away from the reference
+	const int maximumPanScreens = 1;
+	// result.y of the pixels the glitch test stopped, GLITCHED in the iteration shader
+	const float glitchedStatus = -2.0f;
+	// byte offset of glitchedPixels in the compute kernel's statistics buffer
+	const GLintptr glitchedPixelsOffset = 4 * sizeof(GLuint);
+
+	// orderedKey() and orderedValue() of histogram_common_text
+	GLuint orderedKey(float value)
+	{
+		GLuint bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) != 0u ? ~bits : bits | 0x80000000u;
+	}
+
+	float orderedValue(GLuint key)
+	{
+		const GLuint bits = (key & 0x80000000u) != 0u ? key & 0x7fffffffu : ~key;
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// (hi.x, hi.y, lo.x, lo.y) of a double-float pair, see iterate_precise_text
+	std::array<float, 4> splitDoubleFloat(double x, double y)
+	{
+		const float highX = static_cast<float>(x), highY = static_cast<float>(y);
+		return { highX, highY, static_cast<float>(x - highX), static_cast<float>(y - highY) };
+	}
+
+	// (mantissa.x, mantissa.y, exponent.x, exponent.y) of an extended float pair, zero gets the
+	// exponent DELTA_EXTENDED's ZERO_EXPONENT gives it
+	std::array<float, 4> splitExtended(double x, double y)
+	{
+		int exponentX, exponentY;
+		const double mantissaX = std::frexp(x, &exponentX), mantissaY = std::frexp(y, &exponentY);
+		return { static_cast<float>(mantissaX), static_cast<float>(mantissaY),
+			x == 0.0 ? -1e9f : static_cast<float>(exponentX), y == 0.0 ? -1e9f : static_cast<float>(exponentY) };
+	}
+
+	const char* vertex_shader_text = R"(
+		#version 330 core
+	
+		layout(location = 0) in vec3 a_Position;
+
+		out vec3 v_Position;
+
+		void main()
+		{
+			v_Position = a_Position;
+
+		    gl_Position = vec4(a_Position, 1.0f);
+		}
+	)";
+
+	// Shared by both iteration kernels, which prepend their #version line and the
+	// formula's #defines, see Formula::shaderDefines().
+	const char* iterate_common_text = R"(
+		precision highp float;
+
+		uniform sampler2D u_State;
+		uniform sampler2D u_Result;
+		// dz / dc of the running pixels, only with DISTANCE_ESTIMATION
+		uniform sampler2D u_Derivative;
+		uniform bool u_Reset;
+		// state of this pixel in the previous pass is at pixel + u_Shift
+		uniform ivec2 u_Shift;
+		uniform int u_MaxIterations;
+		uniform int u_IterationsPerPass;
+
+		uniform samplerBuffer u_ReferenceOrbit;
+		uniform int u_ReferenceLength;
+
+		// deltaC = (u_PixelOffset + pixel - size / 2) * u_PixelSize
+		uniform vec2 u_PixelOffset;
+		uniform vec2 u_PixelSize;
+
+		// series approximation of the first u_SkipIterations iterations in u = deltaC / u_SeriesScale,
+		// see series_approximation.hpp
+		#define MAX_SERIES_TERMS 16
+		uniform float u_SeriesScale;
+		uniform int u_SkipIterations;
+		uniform int u_SeriesTerms;
+		uniform vec2 u_SeriesCoefficients[MAX_SERIES_TERMS];
+
+		// interior shortcuts: closed form cardioid / bulb test around u_ReferenceCenter, only
+		// for the quadratic Mandelbrot set, and Brent style periodicity checking, off when the
+		// epsilon is 0
+		uniform bool u_CardioidTest;
+		uniform vec2 u_ReferenceCenter;
+		uniform float u_PeriodicityEpsilon;
+
+		// glitch detection of the Julia sets, see glitch_detection.hpp: pixels whose |z|^2 falls
+		// below u_GlitchTolerance |Z|^2 stop with result.y = GLITCHED, and the first pass with
+		// u_RetryGlitched starts them over against the reference u_GlitchOffset pixels away
+		#define GLITCHED -2.0f
+		uniform float u_GlitchTolerance;
+		uniform bool u_RetryGlitched;
+		uniform vec2 u_GlitchOffset;
+
+		vec2 mulImaginary(vec2 lhs, vec2 rhs)
+		{
+			return vec2(
+				lhs.x * rhs.x - lhs.y * rhs.y,
+				lhs.x * rhs.y + lhs.y * rhs.x
+			);
+		}
+
+		// Perturbation: each pixel iterates only its delta to the high precision reference
+		// orbit Z_n, so the float loop stays accurate far beyond float's own resolution.
+	#if defined(FORMULA_BURNING_SHIP)
+		// |c + d| - |c| without cancelling the large terms
+		float diffabs(float c, float d)
+		{
+			if(c >= 0.0f)
+				return c + d >= 0.0f ? d : -(2.0f * c + d);
+			return c + d > 0.0f ? 2.0f * c + d : -d;
+		}
+
+		// (|X + dx| + i |Y + dy|)^2 + (C + dc) - (|X| + i |Y|)^2 - C
+		//     = (2X + dx) dx - (2Y + dy) dy + 2i (|XY + X dy + dx Y + dx dy| - |XY|) + dc
+		vec2 perturbDelta(vec2 Z, vec2 delta, vec2 deltaC)
+		{
+			return vec2(
+				(2.0f * Z.x + delta.x) * delta.x - (2.0f * Z.y + delta.y) * delta.y,
+				2.0f * diffabs(Z.x * Z.y, Z.x * delta.y + delta.x * Z.y + delta.x * delta.y)
+			) + deltaC;
+		}
+	#else
+		//     (Z + d)^p + (C + dc) - (Z^p + C) = sum_{k=1}^{p} binom(p, k) Z^(p-k) d^k + dc
+		// Julia sets share c, so their pixels only differ in z_0 and there is no dc term.
+		vec2 perturbDelta(vec2 Z, vec2 delta, vec2 deltaC)
+		{
+			vec2 zPowers[POWER];
+			zPowers[0] = vec2(1.0f, 0.0f);
+			for(int i = 1; i < POWER; ++i)
+				zPowers[i] = mulImaginary(zPowers[i - 1], Z);
+
+			// Horner's scheme in delta, starting from the binom(p, p) = 1 term
+			vec2 sum = vec2(1.0f, 0.0f);
+			float binomial = 1.0f;
+			for(int k = POWER - 1; k >= 1; --k)
+			{
+				binomial = binomial * float(k + 1) / float(POWER - k);
+				sum = mulImaginary(sum, delta) + binomial * zPowers[POWER - k];
+			}
+		#if defined(FORMULA_JULIA)
+			return mulImaginary(sum, delta);
+		#else
+			return mulImaginary(sum, delta) + deltaC;
+		#endif
+		}
+	#endif
+
+		// one step of the derivative dz / dc (dz / dz_0 for Julia sets) at the old z
+	#if defined(FORMULA_BURNING_SHIP)
+		// the fold flips the sign of the imaginary part wherever xy < 0
+		vec2 derivativeStep(vec2 z, vec2 dz)
+		{
+			return vec2(2.0f * (z.x * dz.x - z.y * dz.y) + 1.0f, 2.0f * sign(z.x * z.y) * (z.y * dz.x + z.x * dz.y));
+		}
+	#else
+		vec2 derivativeStep(vec2 z, vec2 dz)
+		{
+			vec2 step = float(POWER) * dz;
+			for(int i = 1; i < POWER; ++i)
+				step = mulImaginary(step, z);
+		#if defined(FORMULA_JULIA)
+			return step;
+		#else
+			return step + vec2(1.0f, 0.0f);
+		#endif
+		}
+	#endif
+
+		bool insideCardioidOrBulb(vec2 c)
+		{
+			float x = c.x - 0.25f;
+			float q = x * x + c.y * c.y;
+			if(q * (q + x) <= 0.25f * c.y * c.y)
+				return true;
+			return (c.x + 1.0f) * (c.x + 1.0f) + c.y * c.y <= 0.0625f;
+		}
+
+		// Continues one pixel for up to u_IterationsPerPass iterations. Fresh pixels start from
+		// the series, the others from their previous state and result. Returns true while the
+		// pixel has neither escaped nor reached the iteration cap. With DISTANCE_ESTIMATION
+		// the derivative is carried along, and escaped pixels store their distance to the set
+		// in pixels in result.z. The precise kernels bring their own, see iterate_precise_text.
+	#if !defined(PRECISE_DELTA)
+		bool iteratePixel(vec2 fragCoord, ivec2 size, bool fresh, vec4 previousState, vec4 previousResult,
+			vec2 previousDerivative, out vec4 state, out vec4 result, out vec2 derivative)
+		{
+			vec2 deltaC = (u_PixelOffset - u_GlitchOffset + fragCoord - 0.5f * vec2(size)) * u_PixelSize;
+
+			vec2 delta = vec2(0.0f, 0.0f);
+			int referenceIteration = 0;
+			int iteration = 0;
+			// far outside, so nothing matches it before the first checkpoint
+			vec2 checkpoint = vec2(1e30f);
+			vec2 dz = previousDerivative;
+			derivative = dz;
+
+			if(fresh)
+			{
+		#if defined(FORMULA_MANDELBROT) && POWER == 2
+				if(u_CardioidTest && insideCardioidOrBulb(u_ReferenceCenter + deltaC))
+				{
+					// interior pixels keep the iterations they actually did, for the counts
+					state = vec4(0.0f, 0.0f, 0.0f, float(u_SkipIterations));
+					result = vec4(0.0f, -1.0f, 0.0f, 0.0f);
+					return false;
+				}
+		#endif
+
+				// start from the iteration the whole view shares
+				vec2 u = deltaC / u_SeriesScale;
+				for(int k = u_SeriesTerms - 1; k >= 0; --k)
+					delta = mulImaginary(delta + u_SeriesCoefficients[k], u);
+				referenceIteration = iteration = u_SkipIterations;
+		#if defined(DISTANCE_ESTIMATION)
+				// the derivative of the series, d delta / du / scale
+				dz = vec2(0.0f, 0.0f);
+				for(int k = u_SeriesTerms - 1; k >= 0; --k)
+					dz = mulImaginary(dz, u) + float(k + 1) * u_SeriesCoefficients[k];
+				dz /= u_SeriesScale;
+		#endif
+			}
+			else
+			{
+				result = previousResult;
+				if(result.y != 0.0f)
+				{
+					state = previousState;
+					return false;
+				}
+
+				delta = previousState.xy;
+				referenceIteration = int(previousState.z);
+				iteration = int(previousState.w);
+				checkpoint = result.zw;
+			}
+
+			result = vec4(0.0f, 0.0f, checkpoint);
+
+			int lastIteration = min(u_MaxIterations, iteration + u_IterationsPerPass);
+			for(; iteration < lastIteration; ++iteration)
+			{
+				vec2 Z = texelFetch(u_ReferenceOrbit, referenceIteration).xy;
+		#if defined(DISTANCE_ESTIMATION)
+				dz = derivativeStep(Z + delta, dz);
+		#endif
+				delta = perturbDelta(Z, delta, deltaC);
+				++referenceIteration;
+
+				vec2 nextZ = texelFetch(u_ReferenceOrbit, referenceIteration).xy;
+				vec2 z = nextZ + delta;
+		#if defined(OPTIMIZED_KERNEL)
+				// compare |z|^2 against the squared bailout, the square root is only taken
+				// once the pixel escapes, and the rebase test below reuses |z|^2
+				float radiusSquared = dot(z, z);
+				if(radiusSquared > BAILOUT * BAILOUT)
+				{
+					result = vec4(float(iteration) - log(sqrt(radiusSquared))/log(16.0f), 1.0f, 0.0f, 0.0f);
+		#if defined(DISTANCE_ESTIMATION)
+					result.z = 0.5f * sqrt(radiusSquared) * log(sqrt(radiusSquared)) / length(dz) / u_PixelSize.y;
+		#endif
+					break;
+				}
+		#else
+				if(length(z) > BAILOUT)
+				{
+					result = vec4(float(iteration) - log(length(z))/log(16.0f), 1.0f, 0.0f, 0.0f);
+		#if defined(DISTANCE_ESTIMATION)
+					result.z = 0.5f * length(z) * log(length(z)) / length(dz) / u_PixelSize.y;
+		#endif
+					break;
+				}
+		#endif
+		#if defined(FORMULA_JULIA)
+				if(dot(z, z) < u_GlitchTolerance * dot(nextZ, nextZ))
+				{
+					result = vec4(0.0f, GLITCHED, 0.0f, 0.0f);
+					break;
+				}
+		#endif
+
+				// Brent: remember z every power of two iterations, an orbit that comes back
+				// to it before the next one has settled into a cycle and never escapes
+				if(u_PeriodicityEpsilon > 0.0f)
+				{
+					int count = iteration + 1;
+					vec2 difference = z - result.zw;
+					if((count & (count - 1)) == 0)
+						result.zw = z;
+					else if(dot(difference, difference) < u_PeriodicityEpsilon * u_PeriodicityEpsilon)
+					{
+						result = vec4(0.0f, -1.0f, 0.0f, 0.0f);
+						break;
+					}
+				}
+
+				// Rebase onto the start of the orbit when the reference runs out or when the
+				// full value gets closer to zero than the delta, which keeps delta small. Julia
+				// orbits start at the reference point instead of 0, so that only pays off for
+				// the Mandelbrot style formulas.
+		#if defined(FORMULA_JULIA)
+				if(referenceIteration == u_ReferenceLength - 1)
+		#elif defined(OPTIMIZED_KERNEL)
+				if(referenceIteration == u_ReferenceLength - 1 || radiusSquared < dot(delta, delta))
+		#else
+				if(referenceIteration == u_ReferenceLength - 1 || dot(z, z) < dot(delta, delta))
+		#endif
+				{
+					delta = z - texelFetch(u_ReferenceOrbit, 0).xy;
+					referenceIteration = 0;
+				}
+			}
+
+			state = vec4(delta, float(referenceIteration), float(iteration));
+			derivative = dz;
+			return result.y == 0.0f && iteration < u_MaxIterations;
+		}
+	#endif
+	)";
+
+	// Precise delta arithmetic, appended to iterate_common_text with DELTA_DOUBLE,
+	// DELTA_DOUBLE_FLOAT or DELTA_EXTENDED, see delta_precision.hpp. It replaces the float
+	// iteratePixel(): Delta holds both components of a complex delta, and the orbit, the pixel
+	// size, the series and the stored delta carry the extra precision or range as well. The escape, interior and periodicity
+	// tests still look at the full value z in float. Distance estimation stays with the float
+	// kernel, its derivative outgrows float's range as soon as the pixels get that small.
+	const char* iterate_precise_text = R"(
+		// the delta of the running pixels, bit for bit, state.xy only holds it rounded to float
+		uniform usampler2D u_PreciseDelta;
+
+	#if defined(DELTA_DOUBLE)
+		#define Delta dvec2
+
+		Delta toDelta(vec2 value) { return dvec2(value); }
+		vec2 roundDelta(Delta value) { return vec2(value); }
+		Delta addDelta(Delta lhs, Delta rhs) { return lhs + rhs; }
+		// component-wise, exact for the small integers the kernel scales by
+		Delta mulDelta(Delta lhs, Delta rhs) { return lhs * rhs; }
+		Delta scaleDelta(Delta value, vec2 factors) { return value * dvec2(factors); }
+		Delta selectDelta(Delta lhs, Delta rhs, bvec2 pick) { return mix(lhs, rhs, pick); }
+		// (lhs.x, rhs.x), (lhs.y, rhs.y) and (value.y, value.x), the shuffles of the products
+		Delta firsts(Delta lhs, Delta rhs) { return dvec2(lhs.x, rhs.x); }
+		Delta seconds(Delta lhs, Delta rhs) { return dvec2(lhs.y, rhs.y); }
+		Delta swapDelta(Delta value) { return value.yx; }
+		bool normBelow(Delta lhs, Delta rhs) { return dot(lhs, lhs) < dot(rhs, rhs); }
+
+		uvec4 packDelta(Delta value) { return uvec4(unpackDouble2x32(value.x), unpackDouble2x32(value.y)); }
+		Delta unpackDelta(uvec4 bits) { return dvec2(packDouble2x32(bits.xy), packDouble2x32(bits.zw)); }
+
+		// the orbit texture holds Z rounded to float and the residual
+		Delta orbitPoint(int iteration)
+		{
+			vec4 point = texelFetch(u_ReferenceOrbit, iteration);
+			return dvec2(point.xy) + dvec2(point.zw);
+		}
+	#elif defined(DELTA_EXTENDED)
+		// (mantissa.x, mantissa.y, exponent.x, exponent.y), every component is m 2^e with
+		// 0.5 <= |m| < 1, whole float exponents. Zero sits far below every other exponent so
+		// that sums ignore it. The shifts are clamped, past 64 bits one side vanishes anyway.
+		#define Delta vec4
+		#define ZERO_EXPONENT -1e9f
+
+		Delta normalizeDelta(vec2 mantissa, vec2 exponent)
+		{
+			ivec2 shift;
+			mantissa = frexp(mantissa, shift);
+			return vec4(mantissa, mix(exponent + vec2(shift), vec2(ZERO_EXPONENT), equal(mantissa, vec2(0.0f))));
+		}
+		ivec2 clampShift(vec2 shift) { return ivec2(clamp(shift, -64.0f, 64.0f)); }
+
+		Delta toDelta(vec2 value) { return normalizeDelta(value, vec2(0.0f)); }
+		// flushed to 0 below float's range, which is all the float tests need
+		vec2 roundDelta(Delta value)
+		{
+			vec2 rounded = ldexp(value.xy, ivec2(clamp(value.zw, -125.0f, 128.0f)));
+			return mix(rounded, vec2(0.0f), lessThan(value.zw, vec2(-125.0f)));
+		}
+		Delta addDelta(Delta lhs, Delta rhs)
+		{
+			vec2 exponent = max(lhs.zw, rhs.zw);
+			return normalizeDelta(ldexp(lhs.xy, clampShift(lhs.zw - exponent)) + ldexp(rhs.xy, clampShift(rhs.zw - exponent)), exponent);
+		}
+		Delta mulDelta(Delta lhs, Delta rhs) { return normalizeDelta(lhs.xy * rhs.xy, lhs.zw + rhs.zw); }
+		Delta scaleDelta(Delta value, vec2 factors) { return mulDelta(value, toDelta(factors)); }
+		Delta selectDelta(Delta lhs, Delta rhs, bvec2 pick) { return mix(lhs, rhs, pick.xyxy); }
+		Delta firsts(Delta lhs, Delta rhs) { return vec4(lhs.x, rhs.x, lhs.z, rhs.z); }
+		Delta seconds(Delta lhs, Delta rhs) { return vec4(lhs.y, rhs.y, lhs.w, rhs.w); }
+		Delta swapDelta(Delta value) { return value.yxwz; }
+		bool normBelow(Delta lhs, Delta rhs)
+		{
+			// (|lhs|^2, |rhs|^2), compared as mantissas on the larger of their exponents
+			Delta lhsSquares = mulDelta(lhs, lhs), rhsSquares = mulDelta(rhs, rhs);
+			Delta norms = addDelta(firsts(lhsSquares, rhsSquares), seconds(lhsSquares, rhsSquares));
+			vec2 aligned = ldexp(norms.xy, clampShift(norms.zw - vec2(max(norms.z, norms.w))));
+			return aligned.x < aligned.y;
+		}
+
+		uvec4 packDelta(Delta value) { return floatBitsToUint(value); }
+		Delta unpackDelta(uvec4 bits) { return uintBitsToFloat(bits); }
+
+		// Z needs no more than float, only its difference to z does
+		Delta orbitPoint(int iteration) { return toDelta(texelFetch(u_ReferenceOrbit, iteration).xy); }
+	#else
+		// (hi.x, hi.y, lo.x, lo.y), every component is the unevaluated sum hi + lo. precise
+		// keeps the compiler from contracting or reassociating the error terms away.
+		#define Delta vec4
+
+		Delta toDelta(vec2 value) { return vec4(value, 0.0f, 0.0f); }
+		vec2 roundDelta(Delta value) { return value.xy + value.zw; }
+		Delta addDelta(Delta lhs, Delta rhs)
+		{
+			// two-sum of the high parts, the low parts go into its error
+			precise vec2 sum = lhs.xy + rhs.xy;
+			precise vec2 shift = sum - lhs.xy;
+			precise vec2 error = (lhs.xy - (sum - shift)) + (rhs.xy - shift) + lhs.zw + rhs.zw;
+			precise vec2 high = sum + error;
+			return vec4(high, error - (high - sum));
+		}
+		Delta mulDelta(Delta lhs, Delta rhs)
+		{
+			// the fused multiply-add gives the exact error of the high product
+			precise vec2 product = lhs.xy * rhs.xy;
+			precise vec2 error = fma(lhs.xy, rhs.xy, -product) + (lhs.xy * rhs.zw + lhs.zw * rhs.xy);
+			precise vec2 high = product + error;
+			return vec4(high, error - (high - product));
+		}
+		Delta scaleDelta(Delta value, vec2 factors) { return mulDelta(value, vec4(factors, 0.0f, 0.0f)); }
+		Delta selectDelta(Delta lhs, Delta rhs, bvec2 pick) { return mix(lhs, rhs, pick.xyxy); }
+		Delta firsts(Delta lhs, Delta rhs) { return vec4(lhs.x, rhs.x, lhs.z, rhs.z); }
+		Delta seconds(Delta lhs, Delta rhs) { return vec4(lhs.y, rhs.y, lhs.w, rhs.w); }
+		Delta swapDelta(Delta value) { return value.yxwz; }
+		// the high parts decide, there is no exponent range beyond float's to gain here
+		bool normBelow(Delta lhs, Delta rhs) { return dot(lhs.xy, lhs.xy) < dot(rhs.xy, rhs.xy); }
+
+		uvec4 packDelta(Delta value) { return floatBitsToUint(value); }
+		Delta unpackDelta(uvec4 bits) { return uintBitsToFloat(bits); }
+
+		Delta orbitPoint(int iteration) { return texelFetch(u_ReferenceOrbit, iteration); }
+	#endif
+
+		// counterparts of u_PixelSize and u_SeriesCoefficients, u = pixel * u_PixelStep
+		uniform Delta u_PrecisePixelSize;
+		uniform Delta u_PixelStep;
+		uniform Delta u_PreciseSeriesCoefficients[MAX_SERIES_TERMS];
+
+		Delta mulComplex(Delta lhs, Delta rhs)
+		{
+			// (lhs.x rhs.x, lhs.y rhs.y) and (lhs.x rhs.y, lhs.y rhs.x)
+			Delta straight = mulDelta(lhs, rhs);
+			Delta crossed = mulDelta(lhs, swapDelta(rhs));
+			return addDelta(firsts(straight, crossed), seconds(scaleDelta(straight, vec2(1.0f, -1.0f)), crossed));
+		}
+
+		// the same expansions as the float perturbDelta()
+	#if defined(FORMULA_BURNING_SHIP)
+		// diffabs() on both components, the sign tests only need the high parts
+		Delta diffabs(Delta c, Delta d)
+		{
+			vec2 cSign = roundDelta(c);
+			vec2 sum = roundDelta(addDelta(c, d));
+			// c >= 0: c + d >= 0 ? d : -(2c + d), c < 0: c + d > 0 ? 2c + d : -d
+			bvec2 flipped, negated;
+			for(int i = 0; i < 2; ++i)
+			{
+				bool positive = cSign[i] >= 0.0f;
+				flipped[i] = positive ? sum[i] < 0.0f : sum[i] > 0.0f;
+				negated[i] = positive ? sum[i] < 0.0f : sum[i] <= 0.0f;
+			}
+			Delta folded = selectDelta(d, addDelta(scaleDelta(c, vec2(2.0f)), d), flipped);
+			return scaleDelta(folded, mix(vec2(1.0f), vec2(-1.0f), negated));
+		}
+
+		Delta perturbDelta(Delta Z, Delta delta, Delta deltaC)
+		{
+			// ((2X + dx) dx, (2Y + dy) dy), (X dy, Y dx) and (dx dy, XY)
+			Delta squares = mulDelta(addDelta(scaleDelta(Z, vec2(2.0f)), delta), delta);
+			Delta mixed = mulDelta(Z, swapDelta(delta));
+			Delta products = mulDelta(firsts(delta, Z), seconds(delta, Z));
+			Delta zero = toDelta(vec2(0.0f));
+
+			// (real part, X dy + dx Y + dx dy)
+			Delta sums = addDelta(firsts(squares, mixed), seconds(scaleDelta(squares, vec2(1.0f, -1.0f)), mixed));
+			sums = addDelta(sums, firsts(zero, products));
+			// only the second component of the fold is used
+			Delta imaginary = scaleDelta(diffabs(seconds(zero, products), sums), vec2(2.0f));
+			return addDelta(firsts(sums, swapDelta(imaginary)), deltaC);
+		}
+	#else
+		Delta perturbDelta(Delta Z, Delta delta, Delta deltaC)
+		{
+			Delta zPowers[POWER];
+			zPowers[0] = toDelta(vec2(1.0f, 0.0f));
+			for(int i = 1; i < POWER; ++i)
+				zPowers[i] = mulComplex(zPowers[i - 1], Z);
+
+			Delta sum = toDelta(vec2(1.0f, 0.0f));
+			float binomial = 1.0f;
+			for(int k = POWER - 1; k >= 1; --k)
+			{
+				binomial = binomial * float(k + 1) / float(POWER - k);
+				sum = addDelta(mulComplex(sum, delta), scaleDelta(zPowers[POWER - k], vec2(binomial)));
+			}
+		#if defined(FORMULA_JULIA)
+			return mulComplex(sum, delta);
+		#else
+			return addDelta(mulComplex(sum, delta), deltaC);
+		#endif
+		}
+	#endif
+
+		// The float iteratePixel() with precise deltas, previousDelta and preciseDelta take the
+		// place of the derivative.
+		bool iteratePixel(vec2 fragCoord, ivec2 size, bool fresh, vec4 previousState, vec4 previousResult,
+			uvec4 previousDelta, out vec4 state, out vec4 result, out uvec4 preciseDelta)
+		{
+			vec2 pixel = u_PixelOffset - u_GlitchOffset + fragCoord - 0.5f * vec2(size);
+			Delta deltaC = mulDelta(toDelta(pixel), u_PrecisePixelSize);
+
+			Delta delta = toDelta(vec2(0.0f));
+			int referenceIteration = 0;
+			int iteration = 0;
+			vec2 checkpoint = vec2(1e30f);
+			preciseDelta = uvec4(0u);
+
+			if(fresh)
+			{
+		#if defined(FORMULA_MANDELBROT) && POWER == 2
+				if(u_CardioidTest && insideCardioidOrBulb(u_ReferenceCenter + roundDelta(deltaC)))
+				{
+					// interior pixels keep the iterations they actually did, for the counts
+					state = vec4(0.0f, 0.0f, 0.0f, float(u_SkipIterations));
+					result = vec4(0.0f, -1.0f, 0.0f, 0.0f);
+					return false;
+				}
+		#endif
+
+				Delta u = mulDelta(toDelta(pixel), u_PixelStep);
+				for(int k = u_SeriesTerms - 1; k >= 0; --k)
+					delta = mulComplex(addDelta(delta, u_PreciseSeriesCoefficients[k]), u);
+				referenceIteration = iteration = u_SkipIterations;
+			}
+			else
+			{
+				result = previousResult;
+				if(result.y != 0.0f)
+				{
+					state = previousState;
+					preciseDelta = previousDelta;
+					return false;
+				}
+
+				delta = unpackDelta(previousDelta);
+				referenceIteration = int(previousState.z);
+				iteration = int(previousState.w);
+				checkpoint = result.zw;
+			}
+
+			result = vec4(0.0f, 0.0f, checkpoint);
+
+			int lastIteration = min(u_MaxIterations, iteration + u_IterationsPerPass);
+			for(; iteration < lastIteration; ++iteration)
+			{
+				delta = perturbDelta(orbitPoint(referenceIteration), delta, deltaC);
+				++referenceIteration;
+
+				// always the strength reduced escape test, see OPTIMIZED_KERNEL
+				Delta nextZ = orbitPoint(referenceIteration);
+				Delta fullZ = addDelta(nextZ, delta);
+				vec2 z = roundDelta(fullZ);
+				float radiusSquared = dot(z, z);
+				if(radiusSquared > BAILOUT * BAILOUT)
+				{
+					result = vec4(float(iteration) - log(sqrt(radiusSquared))/log(16.0f), 1.0f, 0.0f, 0.0f);
+					break;
+				}
+		#if defined(FORMULA_JULIA)
+				if(radiusSquared < u_GlitchTolerance * dot(roundDelta(nextZ), roundDelta(nextZ)))
+				{
+					result = vec4(0.0f, GLITCHED, 0.0f, 0.0f);
+					break;
+				}
+		#endif
+
+				if(u_PeriodicityEpsilon > 0.0f)
+				{
+					int count = iteration + 1;
+					vec2 difference = z - result.zw;
+					if((count & (count - 1)) == 0)
+						result.zw = z;
+					else if(dot(difference, difference) < u_PeriodicityEpsilon * u_PeriodicityEpsilon)
+					{
+						result = vec4(0.0f, -1.0f, 0.0f, 0.0f);
+						break;
+					}
+				}
+
+		#if defined(FORMULA_JULIA)
+				if(referenceIteration == u_ReferenceLength - 1)
+		#else
+				if(referenceIteration == u_ReferenceLength - 1 || normBelow(fullZ, delta))
+		#endif
+				{
+					delta = addDelta(fullZ, scaleDelta(orbitPoint(0), vec2(-1.0f)));
+					referenceIteration = 0;
+				}
+			}
+
+			state = vec4(roundDelta(delta), float(referenceIteration), float(iteration));
+			preciseDelta = packDelta(delta);
+			return result.y == 0.0f && iteration < u_MaxIterations;
+		}
+	)";
+
+	const char* iterate_fragment_text = R"(
+		layout(location = 0) out vec4 state;
+		// smooth value / escaped (1), found interior (-1) or GLITCHED / z at the last periodicity checkpoint,
+		// or the distance estimate once escaped
+		layout(location = 1) out vec4 result;
+	#if defined(DISTANCE_ESTIMATION)
+		layout(location = 2) out vec2 derivative;
+	#elif defined(PRECISE_DELTA)
+		layout(location = 2) out uvec4 preciseDelta;
+	#endif
+
+		in vec3 v_Position;
+
+		void main()
+		{
+			ivec2 size = textureSize(u_State, 0);
+			ivec2 source = ivec2(gl_FragCoord.xy) + u_Shift;
+
+			// pixels scrolled in from outside the previous view start fresh
+			bool fresh = u_Reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size));
+			vec4 previousState = vec4(0.0f), previousResult = vec4(0.0f);
+			vec2 previousDerivative = vec2(0.0f);
+			uvec4 previousDelta = uvec4(0u);
+			if(!fresh)
+			{
+				previousState = texelFetch(u_State, source, 0);
+				previousResult = texelFetch(u_Result, source, 0);
+		#if defined(DISTANCE_ESTIMATION)
+				previousDerivative = texelFetch(u_Derivative, source, 0).xy;
+		#elif defined(PRECISE_DELTA)
+				previousDelta = texelFetch(u_PreciseDelta, source, 0);
+		#endif
+			}
+			// glitched pixels start over against the new reference
+			fresh = fresh || (u_RetryGlitched && previousResult.y == GLITCHED);
+
+			vec4 nextState, nextResult;
+		#if defined(PRECISE_DELTA)
+			uvec4 nextDelta;
+			iteratePixel(gl_FragCoord.xy, size, fresh, previousState, previousResult, previousDelta,
+				nextState, nextResult, nextDelta);
+			preciseDelta = nextDelta;
+		#else
+			vec2 nextDerivative;
+			iteratePixel(gl_FragCoord.xy, size, fresh, previousState, previousResult, previousDerivative,
+				nextState, nextResult, nextDerivative);
+		#endif
+			state = nextState;
+			result = nextResult;
+		#if defined(DISTANCE_ESTIMATION)
+			derivative = nextDerivative;
+		#endif
+		}
+	)";
+
+	// Every work group is one tile of WORK_GROUP_SIZE^2 pixels.
+	const char* iterate_compute_text = R"(
+		layout(local_size_x = WORK_GROUP_SIZE, local_size_y = WORK_GROUP_SIZE) in;
+
+		// same layout as the fragment kernel's outputs
+		layout(rgba32f, binding = 0) uniform image2D u_StateImage;
+		layout(rgba32f, binding = 1) uniform image2D u_ResultImage;
+	#if defined(DISTANCE_ESTIMATION)
+		layout(rg32f, binding = 2) uniform image2D u_DerivativeImage;
+	#elif defined(PRECISE_DELTA)
+		layout(rgba32ui, binding = 2) uniform uimage2D u_PreciseDeltaImage;
+	#endif
+		// continue the pixels in the images themselves instead of reading u_State / u_Result
+		uniform bool u_InPlace;
+
+		// Either every tile runs, or only the ones listed in u_Active. Tiles that still have
+		// running pixels append themselves to u_Next, whose count doubles as the group count
+		// of the next indirect dispatch.
+		uniform bool u_AllTiles;
+		uniform int u_TilesX;
+		layout(std430, binding = 0) readonly buffer ActiveTiles { uint groups[3]; uint tiles[]; } u_Active;
+		layout(std430, binding = 1) buffer NextTiles { uint groups[3]; uint tiles[]; } u_Next;
+		// iterations counts on across passes as a 64 bit { low, high } pair, see takeIterationCount().
+		// glitchedPixels is recounted by every full pass, later passes add the pixels that newly
+		// glitched, see retryGlitches().
+		layout(std430, binding = 2) buffer Statistics
+		{
+			uint runningPixels;
+			uint runningTiles;
+			uint iterations[2];
+			uint glitchedPixels;
+		} u_Statistics;
+
+		shared uint s_Running;
+		shared uint s_Iterations;
+		shared uint s_Glitched;
+
+		void main()
+		{
+			uint tile = u_AllTiles ? gl_WorkGroupID.x : u_Active.tiles[gl_WorkGroupID.x];
+			ivec2 pixel = ivec2(int(tile) % u_TilesX, int(tile) / u_TilesX) * WORK_GROUP_SIZE + ivec2(gl_LocalInvocationID.xy);
+			ivec2 size = imageSize(u_StateImage);
+
+			if(gl_LocalInvocationIndex == 0u)
+				s_Running = s_Iterations = s_Glitched = 0u;
+			memoryBarrierShared();
+			barrier();
+
+			if(all(lessThan(pixel, size)))
+			{
+				ivec2 source = u_InPlace ? pixel : pixel + u_Shift;
+				bool fresh = u_Reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size));
+				vec4 previousState = vec4(0.0f), previousResult = vec4(0.0f);
+				vec2 previousDerivative = vec2(0.0f);
+				uvec4 previousDelta = uvec4(0u);
+				if(!fresh && u_InPlace)
+				{
+					previousState = imageLoad(u_StateImage, pixel);
+					previousResult = imageLoad(u_ResultImage, pixel);
+		#if defined(DISTANCE_ESTIMATION)
+					previousDerivative = imageLoad(u_DerivativeImage, pixel).xy;
+		#elif defined(PRECISE_DELTA)
+					previousDelta = imageLoad(u_PreciseDeltaImage, pixel);
+		#endif
+				}
+				else if(!fresh)
+				{
+					previousState = texelFetch(u_State, source, 0);
+					previousResult = texelFetch(u_Result, source, 0);
+		#if defined(DISTANCE_ESTIMATION)
+					previousDerivative = texelFetch(u_Derivative, source, 0).xy;
+		#elif defined(PRECISE_DELTA)
+					previousDelta = texelFetch(u_PreciseDelta, source, 0);
+		#endif
+				}
+				fresh = fresh || (u_RetryGlitched && previousResult.y == GLITCHED);
+
+				vec4 state, result;
+		#if defined(PRECISE_DELTA)
+				uvec4 delta;
+				bool running = iteratePixel(vec2(pixel) + 0.5f, size, fresh, previousState, previousResult, previousDelta,
+					state, result, delta);
+				imageStore(u_PreciseDeltaImage, pixel, delta);
+		#else
+				vec2 derivative;
+				bool running = iteratePixel(vec2(pixel) + 0.5f, size, fresh, previousState, previousResult, previousDerivative,
+					state, result, derivative);
+		#endif
+				if(running)
+					atomicAdd(s_Running, 1u);
+				if(result.y == GLITCHED && (u_AllTiles || previousResult.y != GLITCHED))
+					atomicAdd(s_Glitched, 1u);
+				// finished pixels come back unchanged and add nothing
+				float start = fresh ? float(u_SkipIterations) : previousState.w;
+				atomicAdd(s_Iterations, uint(max(state.w - start, 0.0f)));
+				imageStore(u_StateImage, pixel, state);
+				imageStore(u_ResultImage, pixel, result);
+		#if defined(DISTANCE_ESTIMATION)
+				imageStore(u_DerivativeImage, pixel, vec4(derivative, 0.0f, 0.0f));
+		#endif
+			}
+
+			memoryBarrierShared();
+			barrier();
+
+			// finished tiles drop out of the next dispatch
+			if(gl_LocalInvocationIndex == 0u && s_Running > 0u)
+			{
+				u_Next.tiles[atomicAdd(u_Next.groups[0], 1u)] = tile;
+				atomicAdd(u_Statistics.runningPixels, s_Running);
+				atomicAdd(u_Statistics.runningTiles, 1u);
+			}
+			// carry into the high word when the low one wraps around
+			if(gl_LocalInvocationIndex == 0u && s_Iterations > 0u)
+			{
+				uint low = atomicAdd(u_Statistics.iterations[0], s_Iterations);
+				if(low + s_Iterations < low)
+					atomicAdd(u_Statistics.iterations[1], 1u);
+			}
+			if(gl_LocalInvocationIndex == 0u && s_Glitched > 0u)
+				atomicAdd(u_Statistics.glitchedPixels, s_Glitched);
+		}
+	)";
+
+	// The histogram buffer of histogram coloring, shared by its compute passes and the color
+	// shader. The range holds orderedKey() of the smallest and largest smooth value.
+	const char* histogram_common_text = R"(
+		layout(std430, binding = 3) buffer Histogram
+		{
+			uint range[2];
+			uint bins[HISTOGRAM_BINS];
+			// cumulative fraction of the escaped pixels up to the end of every bin
+			float cdf[HISTOGRAM_BINS];
+		} u_Histogram;
+
+		// maps floats to uints of the same order, for atomicMin / atomicMax
+		uint orderedKey(float value)
+		{
+			uint bits = floatBitsToUint(value);
+			return (bits & 0x80000000u) != 0u ? ~bits : bits | 0x80000000u;
+		}
+
+		float orderedValue(uint key)
+		{
+			return uintBitsToFloat((key & 0x80000000u) != 0u ? key & 0x7fffffffu : ~key);
+		}
+
+		float binScale(float minimum, float maximum)
+		{
+			return maximum > minimum ? float(HISTOGRAM_BINS) / (maximum - minimum) : 0.0f;
+		}
+	)";
+
+	// Every work group covers a tile of HISTOGRAM_TILE^2 pixels, so that only a few hundred
+	// groups merge their local results into the global buffer even at 4K.
+	const char* histogram_pixels_text = R"(
+		#define HISTOGRAM_TILE 128
+		layout(local_size_x = 16, local_size_y = 16) in;
+
+		uniform sampler2D u_Result;
+
+		// calls ESCAPED(smooth value) for every escaped pixel of this invocation
+		#define FOR_ESCAPED_PIXELS(ESCAPED) \
+			ivec2 size = textureSize(u_Result, 0); \
+			ivec2 origin = ivec2(gl_WorkGroupID.xy) * HISTOGRAM_TILE + ivec2(gl_LocalInvocationID.xy); \
+			for(int y = 0; y < HISTOGRAM_TILE; y += 16) \
+				for(int x = 0; x < HISTOGRAM_TILE; x += 16) \
+				{ \
+					ivec2 pixel = origin + ivec2(x, y); \
+					if(all(lessThan(pixel, size))) \
+					{ \
+						vec2 result = texelFetch(u_Result, pixel, 0).xy; \
+						if(result.y > 0.0f) \
+							ESCAPED(result.x); \
+					} \
+				}
+	)";
+
+	// first pass: parallel min / max reduction of the smooth values
+	const char* histogram_range_text = R"(
+		shared uint s_Minimum, s_Maximum;
+		uint minimum = 0xffffffffu, maximum = 0u;
+
+		void extend(float value)
+		{
+			uint key = orderedKey(value);
+			minimum = min(minimum, key);
+			maximum = max(maximum, key);
+		}
+
+		void main()
+		{
+			if(gl_LocalInvocationIndex == 0u)
+			{
+				s_Minimum = 0xffffffffu;
+				s_Maximum = 0u;
+			}
+			memoryBarrierShared();
+			barrier();
+
+			FOR_ESCAPED_PIXELS(extend)
+			atomicMin(s_Minimum, minimum);
+			atomicMax(s_Maximum, maximum);
+
+			memoryBarrierShared();
+			barrier();
+
+			if(gl_LocalInvocationIndex == 0u && s_Maximum != 0u)
+			{
+				atomicMin(u_Histogram.range[0], s_Minimum);
+				atomicMax(u_Histogram.range[1], s_Maximum);
+			}
+		}
+	)";
+
+	// second pass: counts into shared memory, merged with one atomic per used bin and group
+	const char* histogram_count_text = R"(
+		shared uint s_Bins[HISTOGRAM_BINS];
+		float minimum, scale;
+
+		void count(float value)
+		{
+			atomicAdd(s_Bins[min(int((value - minimum) * scale), HISTOGRAM_BINS - 1)], 1u);
+		}
+
+		void main()
+		{
+			// no pixel escaped
+			if(u_Histogram.range[1] == 0u)
+				return;
+
+			for(uint i = gl_LocalInvocationIndex; i < uint(HISTOGRAM_BINS); i += 256u)
+				s_Bins[i] = 0u;
+			memoryBarrierShared();
+			barrier();
+
+			minimum = orderedValue(u_Histogram.range[0]);
+			scale = binScale(minimum, orderedValue(u_Histogram.range[1]));
+			FOR_ESCAPED_PIXELS(count)
+
+			memoryBarrierShared();
+			barrier();
+
+			for(uint i = gl_LocalInvocationIndex; i < uint(HISTOGRAM_BINS); i += 256u)
+				if(s_Bins[i] != 0u)
+					atomicAdd(u_Histogram.bins[i], s_Bins[i]);
+		}
+	)";
+
+	// third pass: one work group turns the bins into the CDF with a shared memory prefix sum
+	const char* histogram_scan_text = R"(
+		#define SCAN_SIZE 1024
+		#define BINS_PER_INVOCATION (HISTOGRAM_BINS / SCAN_SIZE)
+		layout(local_size_x = SCAN_SIZE) in;
+
+		shared uint s_Sums[SCAN_SIZE];
+
+		void main()
+		{
+			uint index = gl_LocalInvocationIndex;
+			uint first = index * uint(BINS_PER_INVOCATION);
+			uint sum = 0u;
+			for(int i = 0; i < BINS_PER_INVOCATION; ++i)
+				sum += u_Histogram.bins[first + uint(i)];
+			s_Sums[index] = sum;
+			memoryBarrierShared();
+			barrier();
+
+			// Hillis-Steele inclusive scan
+			for(uint offset = 1u; offset < uint(SCAN_SIZE); offset <<= 1)
+			{
+				uint value = index >= offset ? s_Sums[index - offset] : 0u;
+				memoryBarrierShared();
+				barrier();
+				s_Sums[index] += value;
+				memoryBarrierShared();
+				barrier();
+			}
+
+			float total = float(s_Sums[SCAN_SIZE - 1]);
+			uint running = s_Sums[index] - sum;
+			for(int i = 0; i < BINS_PER_INVOCATION; ++i)
+			{
+				running += u_Histogram.bins[first + uint(i)];
+				u_Histogram.cdf[first + uint(i)] = total > 0.0f ? float(running) / total : 0.0f;
+			}
+		}
+	)";
+
+	// The palette lookup of the color and supersampling shaders, which prepend it to their
+	// own text after the #version line and the histogram declarations if HISTOGRAM_COLORING.
+	const char* palette_color_text = R"(
+		uniform float u_ColorPeriod;
+		// palette lookup table, see palette.hpp
+		uniform sampler1D u_Palette;
+		uniform float u_PaletteOffset;
+
+		// pixels that have not escaped (yet) stay black like the interior
+		vec3 paletteColor(vec2 result)
+		{
+		#ifdef HISTOGRAM_COLORING
+			float minimum = orderedValue(u_Histogram.range[0]);
+			float position = (result.x - minimum) * binScale(minimum, orderedValue(u_Histogram.range[1]));
+			int bin = clamp(int(position), 0, HISTOGRAM_BINS - 1);
+			float below = bin > 0 ? u_Histogram.cdf[bin - 1] : 0.0f;
+			float intensity = mix(below, u_Histogram.cdf[bin], clamp(position - float(bin), 0.0f, 1.0f));
+			float value = result.y > 0.0f ? 1.0f : 0.0f;
+		#else
+			float intensity = result.y > 0.0f ? result.x / u_ColorPeriod : 0.0f;
+			float value = clamp(ceil(intensity), 0.0f, 1.0f);
+		#endif
+			return value * texture(u_Palette, intensity + u_PaletteOffset).rgb;
+		}
+	)";
+
+	const char* color_shader_text = R"(
+		precision highp float;
+
+		layout(location = 0) out vec4 color;
+
+		uniform sampler2D u_State;
+		uniform sampler2D u_Result;
+		// maps target pixels to our pixels, which lets a different view be reprojected
+		uniform vec4 u_Transform;
+		// leave pixels that are still iterating to whatever was drawn underneath
+		uniform bool u_DiscardUnresolved;
+		uniform float u_MaxIterations;
+
+		void main()
+		{
+			ivec2 pixel = ivec2(floor(gl_FragCoord.xy * u_Transform.xy + u_Transform.zw));
+			if(any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, textureSize(u_Result, 0))))
+				discard;
+
+			// found interior pixels have result.y < 0 and stay black
+			vec2 result = texelFetch(u_Result, pixel, 0).xy;
+			if(u_DiscardUnresolved && result.y == 0.0f && texelFetch(u_State, pixel, 0).w < u_MaxIterations)
+				discard;
+
+		    color = vec4(paletteColor(result), 1.0f);
+		}
+	)";
+
+	// Adaptive supersampling of a finished state: pixels whose distance estimate puts the
+	// boundary within u_DistanceThreshold pixels, or whose color differs from a neighbour's by
+	// more than u_ColorThreshold in a channel, iterate u_Samples^2 subsamples from scratch and
+	// take their average color. Prefixed with the iteration shader's common text and
+	// palette_color_text.
+	const char* supersample_common_text = R"(
+		uniform int u_Samples;
+		uniform float u_DistanceThreshold;
+		uniform float u_ColorThreshold;
+
+		bool needsRefinement(ivec2 pixel, ivec2 size)
+		{
+			vec4 center = texelFetch(u_Result, pixel, 0);
+			if(center.y > 0.0f && center.z < u_DistanceThreshold)
+				return true;
+
+			vec3 centerColor = paletteColor(center.xy);
+			const ivec2 neighbours[4] = ivec2[4](ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1));
+			for(int i = 0; i < 4; ++i)
+			{
+				vec2 neighbour = texelFetch(u_Result, clamp(pixel + neighbours[i], ivec2(0), size - 1), 0).xy;
+				vec3 difference = abs(paletteColor(neighbour) - centerColor);
+				if(max(difference.r, max(difference.g, difference.b)) > u_ColorThreshold)
+					return true;
+			}
+			return false;
+		}
+
+		// u_IterationsPerPass is the iteration cap, so every subsample finishes in one call
+		vec3 subsampleColor(ivec2 pixel, ivec2 size, int index)
+		{
+			vec2 position = vec2(pixel) + (vec2(index % u_Samples, index / u_Samples) + 0.5f) / float(u_Samples);
+			vec4 state, result;
+		#if defined(PRECISE_DELTA)
+			uvec4 delta;
+			iteratePixel(position, size, true, vec4(0.0f), vec4(0.0f), uvec4(0u), state, result, delta);
+		#else
+			vec2 derivative;
+			iteratePixel(position, size, true, vec4(0.0f), vec4(0.0f), vec2(0.0f), state, result, derivative);
+		#endif
+			return paletteColor(result.xy);
+		}
+	)";
+
+	// Without compute shaders every pixel is tested and refined in one fragment pass, drawn
+	// over the colored state. The other pixels are discarded.
+	const char* supersample_fragment_text = R"(
+		layout(location = 0) out vec4 color;
+
+		void main()
+		{
+			ivec2 size = textureSize(u_Result, 0);
+			ivec2 pixel = ivec2(gl_FragCoord.xy);
+			if(!needsRefinement(pixel, size))
+				discard;
+
+			vec3 sum = vec3(0.0f);
+			for(int i = 0; i < u_Samples * u_Samples; ++i)
+				sum += subsampleColor(pixel, size, i);
+			color = vec4(sum / float(u_Samples * u_Samples), 1.0f);
+		}
+	)";
+
+	// The compute path first compacts the pixels to refine into a list, so that the
+	// subsamples run densely packed instead of next to discarded pixels, which would leave
+	// most of every SIMD group idle. The list doubles as the indirect dispatch arguments of
+	// the resolve pass.
+	const char* supersample_list_text = R"(
+		// one resolve work group per SUPERSAMPLE_PIXELS listed pixels
+		layout(std430, binding = 4) buffer RefineList { uint groups[3]; uint count; uint pixels[]; } u_Refine;
+	)";
+
+	const char* supersample_select_text = R"(
+		layout(local_size_x = 16, local_size_y = 16) in;
+
+		void main()
+		{
+			ivec2 size = textureSize(u_Result, 0);
+			ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+			if(any(greaterThanEqual(pixel, size)) || !needsRefinement(pixel, size))
+				return;
+
+			uint index = atomicAdd(u_Refine.count, 1u);
+			u_Refine.pixels[index] = uint(pixel.y * size.x + pixel.x);
+			if(index % uint(SUPERSAMPLE_PIXELS) == 0u)
+				atomicAdd(u_Refine.groups[0], 1u);
+		}
+	)";
+
+	// one invocation per subsample, averaged in shared memory by the pixel's first one
+	const char* supersample_resolve_text = R"(
+		#define SUBSAMPLES (SUPERSAMPLE_SAMPLES * SUPERSAMPLE_SAMPLES)
+		// SUBSAMPLES * SUPERSAMPLE_PIXELS, layout qualifiers only take literals before GLSL 4.40
+		layout(local_size_x = SUPERSAMPLE_GROUP_SIZE) in;
+
+		layout(rgba8, binding = 0) writeonly uniform image2D u_Target;
+
+		shared vec3 s_Colors[SUBSAMPLES * SUPERSAMPLE_PIXELS];
+
+		void main()
+		{
+			ivec2 size = textureSize(u_Result, 0);
+			uint entry = gl_WorkGroupID.x * uint(SUPERSAMPLE_PIXELS) + gl_LocalInvocationID.x / uint(SUBSAMPLES);
+			int subsample = int(gl_LocalInvocationID.x % uint(SUBSAMPLES));
+			ivec2 pixel = ivec2(0);
+			if(entry < u_Refine.count)
+			{
+				uint index = u_Refine.pixels[entry];
+				pixel = ivec2(int(index) % size.x, int(index) / size.x);
+				s_Colors[gl_LocalInvocationID.x] = subsampleColor(pixel, size, subsample);
+			}
+			memoryBarrierShared();
+			barrier();
+
+			if(entry < u_Refine.count && subsample == 0)
+			{
+				vec3 sum = vec3(0.0f);
+				for(int i = 0; i < SUBSAMPLES; ++i)
+					sum += s_Colors[gl_LocalInvocationID.x + uint(i)];
+				imageStore(u_Target, pixel, vec4(sum / float(SUBSAMPLES), 1.0f));
+			}
+		}
+	)";
+
+	// declarations in front of palette_color_text, histogram coloring needs GL 4.3
+	std::string coloringDefines(bool histogram)
+	{
+		if (!histogram)
+			return "";
+		return "#define HISTOGRAM_BINS " + std::to_string(histogramBins) + "\n"
+			+ histogram_common_text + "#define HISTOGRAM_COLORING\n";
+	}
+}
+
+ProgressiveRenderer::ProgressiveRenderer(IterationKernel kernel, int workGroupSize)
+	: m_Kernel(kernel), m_WorkGroupSize(workGroupSize)
+{
+	m_ColorProgram = cachedProgram(vertex_shader_text, std::string("#version 330 core\n") + palette_color_text + color_shader_text);
+	selectPrograms();
+
+	glGenBuffers(1, &m_OrbitBuffer);
+	glGenTextures(1, &m_OrbitTexture);
+
+	glGenTextures(1, &m_PaletteTexture);
+	glBindTexture(GL_TEXTURE_1D, m_PaletteTexture);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	m_Palette = -1;
+	setPalette(0);
+
+	if (m_Kernel == IterationKernel::Compute)
+	{
+		glGenBuffers(2, m_TileLists);
+		glGenBuffers(1, &m_StatisticsBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_StatisticsBuffer);
+		const GLuint noStatistics[5] = { 0, 0, 0, 0, 0 };
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(noStatistics), noStatistics, GL_DYNAMIC_READ);
+	}
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+	// the programs belong to the program cache
+	glDeleteTextures(1, &m_OrbitTexture);
+	glDeleteTextures(1, &m_PaletteTexture);
+	glDeleteBuffers(1, &m_OrbitBuffer);
+	glDeleteBuffers(2, m_TileLists);
+	glDeleteBuffers(1, &m_StatisticsBuffer);
+	glDeleteBuffers(1, &m_HistogramBuffer);
+	glDeleteBuffers(1, &m_RefineList);
+}
+
+std::string ProgressiveRenderer::programDefines(const Formula& formula, bool distanceEstimation) const
+{
+	std::string defines = formula.shaderDefines() + "#define BAILOUT " + std::to_string(bailout) + "f\n";
+	if (m_OptimizedKernel)
+		defines += "#define OPTIMIZED_KERNEL\n";
+	if (distanceEstimation)
+		defines += "#define DISTANCE_ESTIMATION\n";
+	if (m_Precision == DeltaPrecision::Double)
+		defines += "#define PRECISE_DELTA\n#define DELTA_DOUBLE\n";
+	else if (m_Precision == DeltaPrecision::DoubleFloat)
+		defines += "#define PRECISE_DELTA\n#define DELTA_DOUBLE_FLOAT\n";
+	else if (m_Precision == DeltaPrecision::Extended)
+		defines += "#define PRECISE_DELTA\n#define DELTA_EXTENDED\n";
+	return defines;
+}
+
+std::string ProgressiveRenderer::iterationSource(const Formula& formula, bool distanceEstimation) const
+{
+	std::string source = programDefines(formula, distanceEstimation) + iterate_common_text;
+	if (m_Precision != DeltaPrecision::Float)
+		source += iterate_precise_text;
+	return source;
+}
+
+const char* ProgressiveRenderer::fragmentVersion() const
+{
+	// dvec2, fma(), frexp() and precise are GLSL 4.00
+	return m_Precision == DeltaPrecision::Float ? "#version 330 core\n" : "#version 400 core\n";
+}
+
+void ProgressiveRenderer::prepare(const Formula& formula) const
+{
+	const std::string source = iterationSource(formula, estimatesDistance());
+	cachedProgram(vertex_shader_text, fragmentVersion() + source + iterate_fragment_text);
+	if (m_Kernel == IterationKernel::Compute)
+		cachedComputeProgram("#version 430 core\n#define WORK_GROUP_SIZE " + std::to_string(m_WorkGroupSize) + "\n"
+			+ source + iterate_compute_text);
+}
+
+void ProgressiveRenderer::selectPrograms()
+{
+	const std::string source = iterationSource(m_Formula, estimatesDistance());
+	m_IterateProgram = cachedProgram(vertex_shader_text, fragmentVersion() + source + iterate_fragment_text);
+
+	m_ComputeProgram = 0;
+	if (m_Kernel == IterationKernel::Compute && GLAD_GL_VERSION_4_3)
+		m_ComputeProgram = cachedComputeProgram("#version 430 core\n#define WORK_GROUP_SIZE " + std::to_string(m_WorkGroupSize) + "\n"
+			+ source + iterate_compute_text);
+	if (m_Kernel == IterationKernel::Compute && !m_ComputeProgram)
+	{
+		std::cout << "Compute shaders unavailable, iterating with the fragment kernel\n";
+		m_Kernel = IterationKernel::Fragment;
+	}
+}
+
+void ProgressiveRenderer::setOptimizedKernel(bool optimized)
+{
+	if (optimized == m_OptimizedKernel)
+		return;
+
+	m_OptimizedKernel = optimized;
+	m_Reset = true;
+	selectPrograms();
+}
+
+void ProgressiveRenderer::setDistanceEstimation(bool distanceEstimation)
+{
+	if (distanceEstimation == m_DistanceEstimation)
+		return;
+
+	m_DistanceEstimation = distanceEstimation;
+	m_Reset = true;
+	selectPrograms();
+	// adds or drops the derivative attachment
+	if (width() > 0)
+		resize(width(), height());
+}
+
+bool ProgressiveRenderer::deltaPrecisionAvailable(DeltaPrecision precision)
+{
+	if (precision == DeltaPrecision::Float || precision == DeltaPrecision::Automatic)
+		return true;
+	return GLAD_GL_VERSION_4_0;
+}
+
+double ProgressiveRenderer::minimumScale(DeltaPrecision precision)
+{
+	const bool deep = (precision == DeltaPrecision::Automatic || precision == DeltaPrecision::Double
+		|| precision == DeltaPrecision::Extended) && deltaPrecisionAvailable(DeltaPrecision::Double);
+	return deep ? minimumDeepScale : minimumFloatScale;
+}
+
+void ProgressiveRenderer::setDeltaPrecision(DeltaPrecision precision)
+{
+	if (precision == m_RequestedPrecision)
+		return;
+	if (!deltaPrecisionAvailable(precision))
+		std::cout << "Precise deltas need GL 4.0, iterating with float deltas\n";
+
+	// switched to at the restart, see selectPrecision()
+	m_RequestedPrecision = precision;
+	m_Reset = true;
+}
+
+DeltaPrecision ProgressiveRenderer::selectPrecision() const
+{
+	if (!deltaPrecisionAvailable(DeltaPrecision::Double))
+		return DeltaPrecision::Float;
+	if (m_RequestedPrecision != DeltaPrecision::Automatic)
+		return m_RequestedPrecision;
+	return m_Camera.scale < minimumFloatScale ? DeltaPrecision::Double : DeltaPrecision::Float;
+}
+
+void ProgressiveRenderer::setHistogramColoring(bool histogram)
+{
+	if (histogram == m_HistogramColoring)
+		return;
+	if (histogram && !GLAD_GL_VERSION_4_3)
+	{
+		std::cout << "Histogram coloring needs compute shaders, coloring by iteration count\n";
+		return;
+	}
+
+	m_HistogramColoring = histogram;
+	m_SharedHistogram = false;
+	if (histogram && !m_HistogramBuffer)
+	{
+		const std::string defines = "#version 430 core\n#define HISTOGRAM_BINS " + std::to_string(histogramBins) + "\n"
+			+ histogram_common_text;
+		m_HistogramPrograms[0] = cachedComputeProgram(defines + histogram_pixels_text + histogram_range_text);
+		m_HistogramPrograms[1] = cachedComputeProgram(defines + histogram_pixels_text + histogram_count_text);
+		m_HistogramPrograms[2] = cachedComputeProgram(defines + histogram_scan_text);
+		m_HistogramColorProgram = cachedProgram(vertex_shader_text, "#version 430 core\n" + coloringDefines(true) + palette_color_text + color_shader_text);
+
+		glGenBuffers(1, &m_HistogramBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_HistogramBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, (2 + 2 * histogramBins) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	if (histogram && width() > 0)
+		buildHistogram();
+}
+
+void ProgressiveRenderer::setHistogram(const Histogram& histogram)
+{
+	m_SharedHistogram = m_HistogramColoring && !histogram.cdf.empty();
+	if (!m_SharedHistogram)
+	{
+		if (m_HistogramColoring && width() > 0)
+			buildHistogram();
+		return;
+	}
+
+	// an empty range is the one buildHistogram() starts from
+	const bool empty = histogram.minimum > histogram.maximum;
+	const GLuint range[2] = { empty ? 0xffffffffu : orderedKey(histogram.minimum), empty ? 0u : orderedKey(histogram.maximum) };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_HistogramBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(range), range);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, (2 + histogramBins) * sizeof(GLuint), histogramBins * sizeof(float),
+		histogram.cdf.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+Histogram ProgressiveRenderer::histogram() const
+{
+	Histogram histogram;
+	if (!m_HistogramColoring)
+		return histogram;
+
+	GLuint range[2];
+	histogram.cdf.resize(histogramBins);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_HistogramBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(range), range);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (2 + histogramBins) * sizeof(GLuint), histogramBins * sizeof(float),
+		histogram.cdf.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// no pixel escaped, as buildHistogram() on the CPU reports it
+	if (range[1] == 0u)
+	{
+		histogram.minimum = INFINITY;
+		histogram.maximum = -INFINITY;
+		return histogram;
+	}
+	histogram.minimum = orderedValue(range[0]);
+	histogram.maximum = orderedValue(range[1]);
+	return histogram;
+}
+
+void ProgressiveRenderer::setFormula(const Formula& formula)
+{
+	if (formula == m_Formula)
+		return;
+
+	m_Formula = formula;
+	m_Reset = true;
+	selectPrograms();
+}
+
+void ProgressiveRenderer::resize(int width, int height)
+{
+	bool resized = false;
+	for (RenderTarget& state : m_State)
+	{
+		if (estimatesDistance())
+			resized = state.resize(width, height, { GL_RGBA32F, GL_RGBA32F, GL_RG32F }) || resized;
+		else if (m_Precision != DeltaPrecision::Float)
+			resized = state.resize(width, height, { GL_RGBA32F, GL_RGBA32F, GL_RGBA32UI }) || resized;
+		else
+			resized = state.resize(width, height, { GL_RGBA32F, GL_RGBA32F }) || resized;
+	}
+
+	m_Reset = m_Reset || resized;
+
+	if (m_Kernel != IterationKernel::Compute)
+		return;
+
+	const int tilesX = (width + m_WorkGroupSize - 1) / m_WorkGroupSize;
+	const int tileCount = tilesX * ((height + m_WorkGroupSize - 1) / m_WorkGroupSize);
+	if (tileCount == m_TileCount && tilesX == m_TilesX)
+		return;
+
+	// every tile is one work group along x
+	GLint maximumGroups = 0;
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maximumGroups);
+	if (tileCount > maximumGroups)
+	{
+		std::cout << "Too many tiles for one dispatch, iterating with the fragment kernel\n";
+		m_Kernel = IterationKernel::Fragment;
+		return;
+	}
+
+	m_TilesX = tilesX;
+	m_TileCount = tileCount;
+	for (GLuint list : m_TileLists)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, list);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, (3 + tileCount) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ProgressiveRenderer::setCamera(const Camera& camera)
+{
+	if (camera == m_Camera)
+		return;
+
+	m_Camera = camera;
+	if (m_Reset || camera.scale != m_GridScale)
+	{
+		m_Reset = true;
+		return;
+	}
+
+	// snap the new center to the pixel grid around the reference
+	int offset[2] =
+	{
+		static_cast<int>(std::lround((camera.centerX - m_Orbit.centerX).toDouble() / m_PixelSize[0])),
+		static_cast<int>(std::lround((camera.centerY - m_Orbit.centerY).toDouble() / m_PixelSize[1]))
+	};
+	if (std::abs(offset[0]) > maximumPanScreens * width() || std::abs(offset[1]) > maximumPanScreens * height())
+	{
+		m_Reset = true;
+		return;
+	}
+
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		m_PendingShift[axis] += offset[axis] - m_PixelOffset[axis];
+		m_PixelOffset[axis] = offset[axis];
+	}
+}
+
+void ProgressiveRenderer::setMaxIterations(int maxIterations)
+{
+	// Lowering the cap needs a restart, raising it just lets the running pixels continue.
+	// A restored state has no deltas to continue from, and after glitch rounds they belong
+	// to different references.
+	if (maxIterations < m_MaxIterations || (maxIterations > m_MaxIterations && (m_Restored || m_References > 1)))
+		m_Reset = true;
+	// pixels at the old cap left the tile list, so the next pass has to visit every tile
+	if (maxIterations > m_MaxIterations)
+		m_TileListStale = true;
+	m_MaxIterations = maxIterations;
+}
+
+void ProgressiveRenderer::setPalette(int palette)
+{
+	if (palette == m_Palette)
+		return;
+
+	m_Palette = palette;
+	const std::vector<unsigned char> table = paletteTable(palette);
+	glBindTexture(GL_TEXTURE_1D, m_PaletteTexture);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, paletteSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, table.data());
+	glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+bool ProgressiveRenderer::isComplete() const
+{
+	return !m_Reset && m_PendingShift[0] == 0 && m_PendingShift[1] == 0
+		&& m_CompletedIterations >= m_MaxIterations;
+}
+
+void ProgressiveRenderer::updateReference()
+{
+	if (m_Reset && (m_Orbit.points.empty() || m_Orbit.centerX != m_Camera.centerX || m_Orbit.centerY != m_Camera.centerY
+		|| m_Orbit.formula != m_Formula || m_Orbit.limbs < referenceLimbs(m_Camera.scale)))
+		m_Orbit = computeReferenceOrbit(m_Camera.centerX, m_Camera.centerY, m_Formula, m_Camera.scale, m_MaxIterations, bailout);
+	else if (m_Orbit.length() <= m_MaxIterations && !m_Orbit.escaped)
+		extendReferenceOrbit(m_Orbit, m_MaxIterations, bailout);
+	else if (!m_OrbitFormatStale)
+		return;
+	m_OrbitFormatStale = false;
+	uploadOrbit(m_Orbit);
+}
+
+void ProgressiveRenderer::uploadOrbit(const ReferenceOrbit& orbit)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, m_OrbitBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, m_OrbitTexture);
+	if (m_Precision == DeltaPrecision::Float)
+	{
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * orbit.points.size(), orbit.points.data(), GL_DYNAMIC_DRAW);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, m_OrbitBuffer);
+		return;
+	}
+
+	// Z_n rounded to float next to its residual, see orbitPoint() in iterate_precise_text
+	std::vector<float> texels;
+	texels.reserve(2 * orbit.points.size());
+	for (std::size_t i = 0; i < orbit.points.size(); i += 2)
+		texels.insert(texels.end(), { orbit.points[i], orbit.points[i + 1], orbit.residuals[i], orbit.residuals[i + 1] });
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * texels.size(), texels.data(), GL_DYNAMIC_DRAW);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_OrbitBuffer);
+}
+
+void ProgressiveRenderer::updateSeries()
+{
+	// the series is in u = deltaC / scale, so the view is viewCenter +- (aspect, 1)
+	const std::complex<double> viewCenter(
+		(m_PixelOffset[0] - m_GlitchOffset[0]) * m_PixelSize[0] / m_Camera.scale,
+		(m_PixelOffset[1] - m_GlitchOffset[1]) * m_PixelSize[1] / m_Camera.scale);
+	const std::complex<double> viewRadius(static_cast<double>(width()) / height(), 1.0);
+	m_Series = computeSeriesApproximation(
+		referenceOrbit(), m_Camera.scale, viewCenter, viewRadius, seriesTerms, m_MaxIterations, bailout);
+
+	m_SeriesCoefficients.clear();
+	for (const std::complex<double>& coefficient : m_Series.coefficients)
+	{
+		m_SeriesCoefficients.push_back(static_cast<float>(coefficient.real()));
+		m_SeriesCoefficients.push_back(static_cast<float>(coefficient.imag()));
+	}
+}
+
+void ProgressiveRenderer::restartGrid()
+{
+	// re-anchor the pixel grid at the view center
+	m_PixelOffset[0] = m_PixelOffset[1] = 0;
+	m_PendingShift[0] = m_PendingShift[1] = 0;
+	// square pixels, the scale is half of the view height
+	m_PixelSize[0] = m_PixelSize[1] = 2.0 * m_Camera.scale / height();
+	m_GridScale = m_Camera.scale;
+	m_Restored = false;
+	resetGlitchRounds();
+
+	const DeltaPrecision precision = selectPrecision();
+	if (precision != m_Precision)
+	{
+		m_Precision = precision;
+		m_OrbitFormatStale = true;
+		selectPrograms();
+		// the precise delta takes the place of the derivative
+		resize(width(), height());
+	}
+}
+
+void ProgressiveRenderer::iterate()
+{
+	if (width() == 0 || isComplete())
+		return;
+
+	if (m_Reset)
+		restartGrid();
+
+	// the pixels scrolled in start against the primary reference again
+	const bool shifted = m_PendingShift[0] != 0 || m_PendingShift[1] != 0;
+	if (shifted)
+		resetGlitchRounds();
+
+	updateReference();
+
+	if (m_Reset || shifted)
+	{
+		// fresh pixels start at the skip of the current view's series
+		updateSeries();
+		m_CompletedIterations = m_Reset
+			? m_Series.skipIterations
+			: std::min(m_CompletedIterations, m_Series.skipIterations);
+	}
+
+	// the compute kernel continues in place unless the stored state has to move
+	if (m_Kernel == IterationKernel::Compute)
+		iterateCompute(m_Reset || shifted || m_TileListStale);
+	else
+		iterateFragment();
+
+	m_CompletedIterations = std::min(m_MaxIterations, m_CompletedIterations + iterationsPerPass);
+	m_PendingShift[0] = m_PendingShift[1] = 0;
+	m_Reset = false;
+	m_TileListStale = false;
+	m_RetryGlitched = false;
+
+	if (m_CompletedIterations >= m_MaxIterations)
+		retryGlitches();
+
+	if (m_HistogramColoring && !m_SharedHistogram)
+		buildHistogram();
+}
+
+void ProgressiveRenderer::resetGlitchRounds()
+{
+	// the primary reference goes back into the orbit texture with the next updateReference()
+	if (m_References > 1)
+		m_OrbitFormatStale = true;
+	m_References = 1;
+	m_GlitchOrbit = ReferenceOrbit();
+	m_GlitchOffset[0] = m_GlitchOffset[1] = 0.0;
+	m_GlitchedPixels = std::numeric_limits<std::size_t>::max();
+	m_GlitchTolerance = glitchTolerance;
+}
+
+bool ProgressiveRenderer::retryGlitches()
+{
+	// only Julia pixels glitch, and nothing follows the round without the test
+	if (m_Formula.kind != FormulaKind::Julia || m_GlitchTolerance == 0.0f)
+		return false;
+
+	// The compute kernel counts the glitched pixels as it marks them, so a clean round, which
+	// most views are, only reads that count back.
+	if (m_Kernel == IterationKernel::Compute)
+	{
+		GLuint counted = 0;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_StatisticsBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, glitchedPixelsOffset, sizeof(counted), &counted);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		if (counted == 0)
+			return false;
+	}
+
+	// where they are comes from the status channel alone, a quarter of the result texture
+	std::vector<float> status(static_cast<std::size_t>(width()) * height());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_State[m_Current].framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT1);
+	glReadPixels(0, 0, width(), height(), GL_GREEN, GL_FLOAT, status.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	std::vector<unsigned char> glitched(status.size());
+	for (std::size_t pixel = 0; pixel < glitched.size(); ++pixel)
+		glitched[pixel] = status[pixel] == glitchedStatus;
+	const std::size_t count = static_cast<std::size_t>(std::count(glitched.begin(), glitched.end(), 1));
+	if (count == 0)
+		return false;
+
+	// Pixels a round could not fix glitch with any reference, their delta outgrew the orbit
+	// long ago, so they finish without the test like they did before it existed.
+	int x = 0, y = 0;
+	if (count >= m_GlitchedPixels || m_References == maximumReferences
+		|| !pickGlitchReference(glitched, width(), height(), x, y))
+		m_GlitchTolerance = 0.0f;
+	else
+	{
+		// the new reference sits on the picked pixel, rows count from the bottom here
+		++m_References;
+		m_GlitchOffset[0] = m_PixelOffset[0] + x + 0.5 - 0.5 * width();
+		m_GlitchOffset[1] = m_PixelOffset[1] + y + 0.5 - 0.5 * height();
+		m_GlitchOrbit = computeReferenceOrbit(m_Orbit.centerX + HighPrecision::fromDouble(m_GlitchOffset[0] * m_PixelSize[0]),
+			m_Orbit.centerY + HighPrecision::fromDouble(m_GlitchOffset[1] * m_PixelSize[1]), m_Formula, m_Camera.scale,
+			m_MaxIterations, bailout);
+		uploadOrbit(m_GlitchOrbit);
+		updateSeries();
+	}
+
+	m_GlitchedPixels = count;
+	m_RetryGlitched = true;
+	m_TileListStale = true;
+	m_CompletedIterations = m_Series.skipIterations;
+	return true;
+}
+
+void ProgressiveRenderer::buildHistogram()
+{
+	// empty range and bins, the CDF is overwritten by the scan
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_HistogramBuffer);
+	glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, (2 + histogramBins) * sizeof(GLuint),
+		GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	const GLuint emptyMinimum = 0xffffffffu;
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyMinimum), &emptyMinimum);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_HistogramBuffer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(1));
+
+	// must match HISTOGRAM_TILE of the shaders
+	const int tile = 128;
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		glUseProgram(m_HistogramPrograms[pass]);
+		if (pass < 2)
+		{
+			glUniform1i(glGetUniformLocation(m_HistogramPrograms[pass], "u_Result"), 0);
+			glDispatchCompute((width() + tile - 1) / tile, (height() + tile - 1) / tile, 1);
+		}
+		else
+			glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+}
+
+void ProgressiveRenderer::setIterateUniforms(GLuint program) const
+{
+	glUniform1i(glGetUniformLocation(program, "u_ReferenceOrbit"), 0);
+	glUniform1i(glGetUniformLocation(program, "u_State"), 1);
+	glUniform1i(glGetUniformLocation(program, "u_Result"), 2);
+	glUniform1i(glGetUniformLocation(program, "u_Derivative"), 3);
+	glUniform1i(glGetUniformLocation(program, "u_Reset"), m_Reset);
+	glUniform2i(glGetUniformLocation(program, "u_Shift"), m_PendingShift[0], m_PendingShift[1]);
+	glUniform1i(glGetUniformLocation(program, "u_MaxIterations"), m_MaxIterations);
+	glUniform1i(glGetUniformLocation(program, "u_IterationsPerPass"), iterationsPerPass);
+	glUniform1i(glGetUniformLocation(program, "u_ReferenceLength"), referenceOrbit().length());
+	glUniform2f(glGetUniformLocation(program, "u_PixelOffset"),
+		static_cast<float>(m_PixelOffset[0]), static_cast<float>(m_PixelOffset[1]));
+	glUniform2f(glGetUniformLocation(program, "u_PixelSize"),
+		static_cast<float>(m_PixelSize[0]), static_cast<float>(m_PixelSize[1]));
+	glUniform1f(glGetUniformLocation(program, "u_SeriesScale"), static_cast<float>(m_Camera.scale));
+	glUniform1i(glGetUniformLocation(program, "u_SkipIterations"), m_Series.skipIterations);
+	glUniform1i(glGetUniformLocation(program, "u_SeriesTerms"), seriesTerms);
+	glUniform2fv(glGetUniformLocation(program, "u_SeriesCoefficients"), seriesTerms, m_SeriesCoefficients.data());
+	glUniform1i(glGetUniformLocation(program, "u_CardioidTest"),
+		interiorDetection && cardioidTestUsable(m_PixelSize[1]));
+	glUniform2f(glGetUniformLocation(program, "u_ReferenceCenter"),
+		static_cast<float>(referenceOrbit().centerX.toDouble()), static_cast<float>(referenceOrbit().centerY.toDouble()));
+	glUniform1f(glGetUniformLocation(program, "u_PeriodicityEpsilon"),
+		interiorDetection ? periodicityEpsilon(m_PixelSize[1]) : 0.0f);
+	glUniform1f(glGetUniformLocation(program, "u_GlitchTolerance"), m_GlitchTolerance);
+	glUniform1i(glGetUniformLocation(program, "u_RetryGlitched"), m_RetryGlitched);
+	glUniform2f(glGetUniformLocation(program, "u_GlitchOffset"),
+		static_cast<float>(m_GlitchOffset[0]), static_cast<float>(m_GlitchOffset[1]));
+
+	glUniform1i(glGetUniformLocation(program, "u_PreciseDelta"), 3);
+	const double pixelStep[2] = { m_PixelSize[0] / m_Camera.scale, m_PixelSize[1] / m_Camera.scale };
+	if (m_Precision == DeltaPrecision::Double)
+	{
+		std::vector<double> coefficients;
+		for (const std::complex<double>& coefficient : m_Series.coefficients)
+			coefficients.insert(coefficients.end(), { coefficient.real(), coefficient.imag() });
+		glUniform2d(glGetUniformLocation(program, "u_PrecisePixelSize"), m_PixelSize[0], m_PixelSize[1]);
+		glUniform2d(glGetUniformLocation(program, "u_PixelStep"), pixelStep[0], pixelStep[1]);
+		glUniform2dv(glGetUniformLocation(program, "u_PreciseSeriesCoefficients"), seriesTerms, coefficients.data());
+	}
+	else if (m_Precision == DeltaPrecision::DoubleFloat)
+	{
+		std::vector<float> coefficients;
+		for (const std::complex<double>& coefficient : m_Series.coefficients)
+		{
+			const std::array<float, 4> split = splitDoubleFloat(coefficient.real(), coefficient.imag());
+			coefficients.insert(coefficients.end(), split.begin(), split.end());
+		}
+		glUniform4fv(glGetUniformLocation(program, "u_PrecisePixelSize"), 1, splitDoubleFloat(m_PixelSize[0], m_PixelSize[1]).data());
+		glUniform4fv(glGetUniformLocation(program, "u_PixelStep"), 1, splitDoubleFloat(pixelStep[0], pixelStep[1]).data());
+		glUniform4fv(glGetUniformLocation(program, "u_PreciseSeriesCoefficients"), seriesTerms, coefficients.data());
+	}
+	else if (m_Precision == DeltaPrecision::Extended)
+	{
+		std::vector<float> coefficients;
+		for (const std::complex<double>& coefficient : m_Series.coefficients)
+		{
+			const std::array<float, 4> split = splitExtended(coefficient.real(), coefficient.imag());
+			coefficients.insert(coefficients.end(), split.begin(), split.end());
+		}
+		glUniform4fv(glGetUniformLocation(program, "u_PrecisePixelSize"), 1, splitExtended(m_PixelSize[0], m_PixelSize[1]).data());
+		glUniform4fv(glGetUniformLocation(program, "u_PixelStep"), 1, splitExtended(pixelStep[0], pixelStep[1]).data());
+		glUniform4fv(glGetUniformLocation(program, "u_PreciseSeriesCoefficients"), seriesTerms, coefficients.data());
+	}
+}
+
+void ProgressiveRenderer::iterateFragment()
+{
+	const RenderTarget& previous = m_State[m_Current];
+	const RenderTarget& next = m_State[1 - m_Current];
+
+	next.bind();
+	glDisable(GL_BLEND);
+	glUseProgram(m_IterateProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, m_OrbitTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, previous.texture(0));
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, previous.texture(1));
+	// the derivative or the precise delta
+	if (estimatesDistance() || m_Precision != DeltaPrecision::Float)
+	{
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, previous.texture(2));
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	setIterateUniforms(m_IterateProgram);
+
+	drawFullscreenQuad();
+
+	glEnable(GL_BLEND);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_Current = 1 - m_Current;
+}
+
+void ProgressiveRenderer::iterateCompute(bool fullPass)
+{
+	// a full pass reads the previous state through the samplers, shifted, and writes the
+	// other state; later passes only run the listed tiles, in place
+	const RenderTarget& previous = m_State[m_Current];
+	const RenderTarget& next = fullPass ? m_State[1 - m_Current] : m_State[m_Current];
+	const GLuint active = m_TileLists[m_ActiveList];
+	const GLuint collected = m_TileLists[1 - m_ActiveList];
+
+	const GLuint emptyList[3] = { 0, 1, 1 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, collected);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyList), emptyList);
+	const GLuint noStatistics[2] = { 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_StatisticsBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(noStatistics), noStatistics);
+	if (fullPass)
+	{
+		const GLuint noGlitches = 0;
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, glitchedPixelsOffset, sizeof(noGlitches), &noGlitches);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(m_ComputeProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, m_OrbitTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, previous.texture(0));
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, previous.texture(1));
+	if (estimatesDistance() || m_Precision != DeltaPrecision::Float)
+	{
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, previous.texture(2));
+		glBindImageTexture(2, next.texture(2), 0, GL_FALSE, 0, GL_READ_WRITE,
+			m_Precision == DeltaPrecision::Float ? GL_RG32F : GL_RGBA32UI);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindImageTexture(0, next.texture(0), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+	glBindImageTexture(1, next.texture(1), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, active);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, collected);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_StatisticsBuffer);
+
+	setIterateUniforms(m_ComputeProgram);
+	glUniform1i(glGetUniformLocation(m_ComputeProgram, "u_InPlace"), !fullPass);
+	glUniform1i(glGetUniformLocation(m_ComputeProgram, "u_AllTiles"), fullPass);
+	glUniform1i(glGetUniformLocation(m_ComputeProgram, "u_TilesX"), m_TilesX);
+
+	if (fullPass)
+	{
+		glDispatchCompute(m_TileCount, 1, 1);
+	}
+	else
+	{
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, active);
+		glDispatchComputeIndirect(0);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	}
+
+	// the state is sampled for coloring and the next full pass and read back through its
+	// framebuffer, the tile list is read as dispatch arguments and storage
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT
+		| GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	if (fullPass)
+		m_Current = 1 - m_Current;
+	m_ActiveList = 1 - m_ActiveList;
+}
+
+unsigned int ProgressiveRenderer::runningPixels() const
+{
+	if (m_Kernel != IterationKernel::Compute)
+		return 0;
+
+	GLuint statistics[2] = { 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_StatisticsBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(statistics), statistics);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return statistics[0];
+}
+
+bool ProgressiveRenderer::takeIterationCount(GLuint buffer, GLintptr offset)
+{
+	if (m_Kernel != IterationKernel::Compute)
+		return false;
+
+	glBindBuffer(GL_COPY_READ_BUFFER, m_StatisticsBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 2 * sizeof(GLuint), offset, 2 * sizeof(GLuint));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	const GLuint noIterations[2] = { 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_StatisticsBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), sizeof(noIterations), noIterations);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return true;
+}
+
+std::uint64_t ProgressiveRenderer::iterationCount() const
+{
+	std::vector<float> state(static_cast<std::size_t>(width()) * height() * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_State[m_Current].framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, width(), height(), GL_RGBA, GL_FLOAT, state.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	std::uint64_t iterations = 0;
+	for (std::size_t i = 3; i < state.size(); i += 4)
+		iterations += static_cast<std::uint64_t>(std::max(state[i] - static_cast<float>(m_Series.skipIterations), 0.0f));
+	return iterations;
+}
+
+bool ProgressiveRenderer::readResult(std::vector<float>& result) const
+{
+	if (width() == 0 || !isComplete())
+		return false;
+
+	std::vector<float> texels(static_cast<std::size_t>(width()) * height() * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_State[m_Current].framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT1);
+	glReadPixels(0, 0, width(), height(), GL_RGBA, GL_FLOAT, texels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	result.resize(static_cast<std::size_t>(width()) * height() * resultChannels);
+	for (std::size_t pixel = 0; pixel < result.size() / resultChannels; ++pixel)
+		std::copy(&texels[pixel * 4], &texels[pixel * 4] + resultChannels, &result[pixel * resultChannels]);
+	return true;
+}
+
+bool ProgressiveRenderer::restoreResult(const std::vector<float>& result)
+{
+	if (width() == 0 || result.size() != static_cast<std::size_t>(width()) * height() * resultChannels)
+		return false;
+
+	restartGrid();
+	m_Reset = true;
+	updateReference();
+	updateSeries();
+
+	// every pixel counts as iterated up to the cap, so none is ever continued
+	std::vector<float> state(static_cast<std::size_t>(width()) * height() * 4, 0.0f);
+	std::vector<float> texels(state.size(), 0.0f);
+	for (std::size_t pixel = 0; pixel < result.size() / resultChannels; ++pixel)
+	{
+		state[pixel * 4 + 3] = static_cast<float>(m_MaxIterations);
+		std::copy(&result[pixel * resultChannels], &result[pixel * resultChannels] + resultChannels, &texels[pixel * 4]);
+	}
+	glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(0));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width(), height(), GL_RGBA, GL_FLOAT, state.data());
+	glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(1));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width(), height(), GL_RGBA, GL_FLOAT, texels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_CompletedIterations = m_MaxIterations;
+	m_Reset = false;
+	m_Restored = true;
+	m_TileListStale = true;
+
+	if (m_HistogramColoring && !m_SharedHistogram)
+		buildHistogram();
+	return true;
+}
+
+void ProgressiveRenderer::colorize(const RenderTarget& target, const Camera& view, bool discardUnresolved) const
+{
+	if (width() == 0 || target.width() == 0)
+		return;
+
+	// map target pixels to our grid: source = target * scale + offset
+	const double targetPixelSize[2] = { 2.0 * view.scale / target.height(), 2.0 * view.scale / target.height() };
+	const double center[2] = { (view.centerX - m_Orbit.centerX).toDouble(), (view.centerY - m_Orbit.centerY).toDouble() };
+	const int size[2] = { width(), height() };
+	const int targetSize[2] = { target.width(), target.height() };
+	float transform[4];
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		const double ratio = targetPixelSize[axis] / m_PixelSize[axis];
+		transform[axis] = static_cast<float>(ratio);
+		transform[axis + 2] = static_cast<float>(
+			center[axis] / m_PixelSize[axis] - m_PixelOffset[axis] + 0.5 * size[axis] - ratio * 0.5 * targetSize[axis]);
+	}
+
+	const GLuint program = m_HistogramColoring ? m_HistogramColorProgram : m_ColorProgram;
+	target.bind();
+	glUseProgram(program);
+	if (m_HistogramColoring)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_HistogramBuffer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(0));
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(1));
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_1D, m_PaletteTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(glGetUniformLocation(program, "u_State"), 0);
+	glUniform1i(glGetUniformLocation(program, "u_Result"), 1);
+	glUniform1i(glGetUniformLocation(program, "u_Palette"), 2);
+	glUniform1f(glGetUniformLocation(program, "u_PaletteOffset"), paletteOffset);
+	glUniform4fv(glGetUniformLocation(program, "u_Transform"), 1, transform);
+	glUniform1i(glGetUniformLocation(program, "u_DiscardUnresolved"), discardUnresolved);
+	glUniform1f(glGetUniformLocation(program, "u_MaxIterations"), static_cast<float>(m_MaxIterations));
+	glUniform1f(glGetUniformLocation(program, "u_ColorPeriod"), colorPeriod);
+
+	drawFullscreenQuad();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+std::uint64_t ProgressiveRenderer::supersample(const RenderTarget& target, int samples)
+{
+	if (width() == 0 || target.width() != width() || target.height() != height() || samples < 2)
+		return 0;
+
+	// Without the distance estimate only the neighbour test finds pixels to refine. The
+	// subsamples themselves need no derivative.
+	const bool compute = GLAD_GL_VERSION_4_3;
+	std::string prefix = (compute ? "#version 430 core\n" : fragmentVersion()) + coloringDefines(m_HistogramColoring)
+		+ iterationSource(m_Formula, false) + palette_color_text + supersample_common_text;
+
+	// the same uniforms in every program
+	auto setUniforms = [&](GLuint program)
+	{
+		if (m_HistogramColoring)
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_HistogramBuffer);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_BUFFER, m_OrbitTexture);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, m_State[m_Current].texture(1));
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_1D, m_PaletteTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		setIterateUniforms(program);
+		glUniform1i(glGetUniformLocation(program, "u_IterationsPerPass"), m_MaxIterations);
+		// a glitched subsample has no round to fix it
+		glUniform1f(glGetUniformLocation(program, "u_GlitchTolerance"), 0.0f);
+		glUniform1i(glGetUniformLocation(program, "u_Palette"), 4);
+		glUniform1f(glGetUniformLocation(program, "u_PaletteOffset"), paletteOffset);
+		glUniform1f(glGetUniformLocation(program, "u_ColorPeriod"), colorPeriod);
+		glUniform1i(glGetUniformLocation(program, "u_Samples"), samples);
+		glUniform1f(glGetUniformLocation(program, "u_DistanceThreshold"), estimatesDistance() ? supersampleDistance : -1.0f);
+		glUniform1f(glGetUniformLocation(program, "u_ColorThreshold"), supersampleColorDifference);
+	};
+
+	if (!compute)
+	{
+		const GLuint program = cachedProgram(vertex_shader_text, prefix + supersample_fragment_text);
+		target.bind();
+		glUseProgram(program);
+		setUniforms(program);
+
+		// the fragments that were not discarded are the supersampled pixels
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		glBeginQuery(GL_SAMPLES_PASSED, query);
+		drawFullscreenQuad();
+		glEndQuery(GL_SAMPLES_PASSED);
+
+		GLuint refined = 0;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT, &refined);
+		glDeleteQueries(1, &query);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return refined;
+	}
+
+	// enough pixels per resolve group for about 64 invocations
+	const int pixelsPerGroup = std::max(1, 64 / (samples * samples));
+	prefix += "#define SUPERSAMPLE_SAMPLES " + std::to_string(samples) + "\n#define SUPERSAMPLE_PIXELS "
+		+ std::to_string(pixelsPerGroup) + "\n#define SUPERSAMPLE_GROUP_SIZE " + std::to_string(pixelsPerGroup * samples * samples)
+		+ "\n" + supersample_list_text;
+	const GLuint select = cachedComputeProgram(prefix + supersample_select_text);
+	const GLuint resolve = cachedComputeProgram(prefix + supersample_resolve_text);
+
+	const GLsizeiptr listSize = (4 + static_cast<GLsizeiptr>(width()) * height()) * sizeof(GLuint);
+	if (!m_RefineList)
+		glGenBuffers(1, &m_RefineList);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RefineList);
+	if (m_RefineListSize != listSize)
+	{
+		glBufferData(GL_SHADER_STORAGE_BUFFER, listSize, nullptr, GL_DYNAMIC_COPY);
+		m_RefineListSize = listSize;
+	}
+	const GLuint emptyList[4] = { 0, 1, 1, 0 };
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyList), emptyList);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_RefineList);
+
+	glUseProgram(select);
+	setUniforms(select);
+	glDispatchCompute((width() + 15) / 16, (height() + 15) / 16, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	glUseProgram(resolve);
+	setUniforms(resolve);
+	glBindImageTexture(0, target.texture(0), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_RefineList);
+	glDispatchComputeIndirect(0);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	// the target is sampled or blitted next
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT
+		| GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	GLuint refined = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_RefineList);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(refined), &refined);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return refined;
+}
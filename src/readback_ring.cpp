@@ -0,0 +1,73 @@
+#include "readback_ring.hpp"
+
+#include <cstring>
+
+ReadbackRing::ReadbackRing(int slots, std::size_t slotBytes)
+	: m_Slots(slots)
+{
+	for (Slot& slot : m_Slots)
+	{
+		slot.capacity = slotBytes;
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, slotBytes, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+ReadbackRing::~ReadbackRing()
+{
+	for (Slot& slot : m_Slots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+	}
+}
+
+void ReadbackRing::start(GLuint framebuffer, int width, int height, int tag)
+{
+	Slot& slot = m_Slots[(m_Oldest + m_Pending) % m_Slots.size()];
+	slot.bytes = static_cast<std::size_t>(width) * height * 3;
+	slot.tag = tag;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if (slot.bytes > slot.capacity)
+	{
+		slot.capacity = slot.bytes;
+		glBufferData(GL_PIXEL_PACK_BUFFER, slot.capacity, nullptr, GL_STREAM_READ);
+	}
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// make sure the read actually gets submitted while we keep rendering
+	glFlush();
+	++m_Pending;
+}
+
+int ReadbackRing::finish(std::vector<unsigned char>& pixels)
+{
+	Slot& slot = m_Slots[m_Oldest];
+
+	while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+		;
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	pixels.resize(slot.bytes);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.bytes, GL_MAP_READ_BIT);
+	if (mapped)
+		std::memcpy(pixels.data(), mapped, slot.bytes);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_Oldest = (m_Oldest + 1) % static_cast<int>(m_Slots.size());
+	--m_Pending;
+	return slot.tag;
+}
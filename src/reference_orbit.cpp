@@ -0,0 +1,128 @@
+#include "reference_orbit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace
+{
+	// magnitude the integer limb of FixedPoint holds with room for c
+	const double integerLimit = 1073741824.0;
+
+	void appendPoint(ReferenceOrbit& orbit, double x, double y)
+	{
+		for (double coordinate : { x, y })
+		{
+			const float rounded = static_cast<float>(coordinate);
+			orbit.points.push_back(rounded);
+			orbit.residuals.push_back(static_cast<float>(coordinate - rounded));
+		}
+	}
+
+	// the loop of extendReferenceOrbit() in Limbs limbs, the products dominate and grow with
+	// their square
+	template <std::size_t Limbs>
+	void iterateOrbit(ReferenceOrbit& orbit, int maxIterations, double bailout)
+	{
+		using Number = FixedPoint<Limbs>;
+
+		const Formula& formula = orbit.formula;
+		const bool julia = formula.kind == FormulaKind::Julia;
+		const Number cx = (julia ? formula.juliaX : orbit.centerX).template resized<Limbs>();
+		const Number cy = (julia ? formula.juliaY : orbit.centerY).template resized<Limbs>();
+
+		Number zx = orbit.lastX.template resized<Limbs>(), zy = orbit.lastY.template resized<Limbs>();
+		for (int iteration = orbit.length() - 1; iteration < maxIterations && !orbit.escaped; ++iteration)
+		{
+			if (formula.kind == FormulaKind::BurningShip)
+			{
+				zx = zx.isNegative() ? -zx : zx;
+				zy = zy.isNegative() ? -zy : zy;
+			}
+
+			// The integer limb wraps at 2^31, which z^6 passes below the bailout. A step that
+			// would leave it escapes anyway, so it is taken in double.
+			const std::complex<double> z(zx.toDouble(), zy.toDouble());
+			if (std::pow(std::norm(z), 0.5 * formula.power) >= integerLimit)
+			{
+				const std::complex<double> next = std::pow(z, formula.power) + std::complex<double>(cx.toDouble(), cy.toDouble());
+				appendPoint(orbit, next.real(), next.imag());
+				orbit.escaped = true;
+				break;
+			}
+
+			// z^power by repeated multiplication, power is tiny so this is fine
+			Number px = zx, py = zy;
+			for (int i = 1; i < formula.power; ++i)
+			{
+				Number nx = px * zx - py * zy;
+				Number ny = px * zy + py * zx;
+				px = nx;
+				py = ny;
+			}
+			zx = px + cx;
+			zy = py + cy;
+
+			double x = zx.toDouble(), y = zy.toDouble();
+			appendPoint(orbit, x, y);
+
+			orbit.escaped = x * x + y * y > bailout * bailout;
+		}
+
+		orbit.lastX = zx.template resized<HighPrecision::limbs>();
+		orbit.lastY = zy.template resized<HighPrecision::limbs>();
+	}
+}
+
+int referenceLimbs(double scale)
+{
+	// the bits down to the scale, and as many again for the pixels within the view and the
+	// rounding the orbit piles up
+	const double bits = std::max(-std::log2(scale), 0.0) + 64.0;
+	for (int limbs : { 6, 12, 20 })
+		if (32.0 * (limbs - 1) >= bits)
+			return limbs;
+	return static_cast<int>(HighPrecision::limbs);
+}
+
+ReferenceOrbit computeReferenceOrbit(
+	const HighPrecision& centerX, const HighPrecision& centerY,
+	const Formula& formula, double scale, int maxIterations, double bailout)
+{
+	ReferenceOrbit orbit;
+	orbit.centerX = centerX;
+	orbit.centerY = centerY;
+	orbit.formula = formula;
+	orbit.limbs = referenceLimbs(scale);
+	if (formula.kind == FormulaKind::Julia)
+	{
+		orbit.lastX = centerX;
+		orbit.lastY = centerY;
+	}
+	appendPoint(orbit, orbit.lastX.toDouble(), orbit.lastY.toDouble());
+
+	extendReferenceOrbit(orbit, maxIterations, bailout);
+	return orbit;
+}
+
+void extendReferenceOrbit(ReferenceOrbit& orbit, int maxIterations, double bailout)
+{
+	orbit.points.reserve(2 * (maxIterations + 1));
+	orbit.residuals.reserve(2 * (maxIterations + 1));
+
+	switch (orbit.limbs)
+	{
+	case 6:
+		iterateOrbit<6>(orbit, maxIterations, bailout);
+		break;
+	case 12:
+		iterateOrbit<12>(orbit, maxIterations, bailout);
+		break;
+	case 20:
+		iterateOrbit<20>(orbit, maxIterations, bailout);
+		break;
+	default:
+		iterateOrbit<HighPrecision::limbs>(orbit, maxIterations, bailout);
+		break;
+	}
+}
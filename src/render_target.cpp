@@ -0,0 +1,102 @@
+#include "render_target.hpp"
+
+#include <iostream>
+
+namespace
+{
+	// pixel transfer format and type that glTexImage2D() accepts with an internal format
+	void transferFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+	{
+		switch (internalFormat)
+		{
+		case GL_RGBA32UI: format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT; return;
+		case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; return;
+		case GL_RG32F: format = GL_RG; type = GL_FLOAT; return;
+		default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; return;
+		}
+	}
+}
+
+RenderTarget::~RenderTarget()
+{
+	destroy();
+}
+
+bool RenderTarget::resize(int width, int height, std::initializer_list<GLenum> formats)
+{
+	if (m_Framebuffer != 0 && width == m_Width && height == m_Height
+		&& std::vector<GLenum>(formats) == m_Formats)
+		return false;
+
+	destroy();
+	m_Width = width;
+	m_Height = height;
+	m_Formats = formats;
+
+	glGenFramebuffers(1, &m_Framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+
+	m_Textures.resize(m_Formats.size());
+	glGenTextures(static_cast<GLsizei>(m_Textures.size()), m_Textures.data());
+	for (std::size_t i = 0; i < m_Textures.size(); ++i)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_Textures[i]);
+		// immutable storage is GL 4.2, a single level of glTexImage2D() is the same to GL 3.3
+		if (GLAD_GL_VERSION_4_2)
+			glTexStorage2D(GL_TEXTURE_2D, 1, m_Formats[i], width, height);
+		else
+		{
+			GLenum format, type;
+			transferFormat(m_Formats[i], format, type);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(m_Formats[i]), width, height, 0, format, type, nullptr);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i), GL_TEXTURE_2D, m_Textures[i], 0);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Render target " << width << "x" << height << " is incomplete!\n";
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return true;
+}
+
+void RenderTarget::destroy()
+{
+	if (!m_Textures.empty())
+		glDeleteTextures(static_cast<GLsizei>(m_Textures.size()), m_Textures.data());
+	if (m_Framebuffer != 0)
+		glDeleteFramebuffers(1, &m_Framebuffer);
+
+	m_Textures.clear();
+	m_Formats.clear();
+	m_Framebuffer = 0;
+	m_Width = m_Height = 0;
+}
+
+void RenderTarget::bind() const
+{
+	std::vector<GLenum> drawBuffers;
+	for (std::size_t i = 0; i < m_Textures.size(); ++i)
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+	glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void RenderTarget::blitToScreen(int screenWidth, int screenHeight) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_Width, m_Height,
+		0, 0, screenWidth, screenHeight,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
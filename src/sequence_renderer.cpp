@@ -0,0 +1,298 @@
+#include "sequence_renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#ifdef PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "cpu_renderer.hpp"
+#include "farm.hpp"
+#include "png_writer.hpp"
+#include "progressive_renderer.hpp"
+#include "readback_ring.hpp"
+#include "render_target.hpp"
+#include "task_queue.hpp"
+#include "tile_cache.hpp"
+
+namespace
+{
+	const int sequenceIterationsPerPass = 4096;
+	// frames in flight between rendering, readback and the encoder thread
+	const int framesInFlight = 3;
+}
+
+std::vector<Keyframe> loadKeyframes(const std::string& path)
+{
+	std::vector<Keyframe> keyframes;
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << "!\n";
+		return keyframes;
+	}
+
+	std::string line;
+	for (int number = 1; std::getline(file, line); ++number)
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		std::string centerX, centerY;
+		Keyframe keyframe;
+		if (!(fields >> keyframe.frame >> centerX >> centerY >> keyframe.camera.scale) || keyframe.camera.scale <= 0.0)
+		{
+			std::cerr << path << ":" << number << ": expected <frame> <center x> <center y> <scale>\n";
+			return {};
+		}
+		keyframe.camera.centerX = HighPrecision::fromString(centerX);
+		keyframe.camera.centerY = HighPrecision::fromString(centerY);
+		keyframes.push_back(keyframe);
+	}
+
+	std::sort(keyframes.begin(), keyframes.end(),
+		[](const Keyframe& lhs, const Keyframe& rhs) { return lhs.frame < rhs.frame; });
+	if (keyframes.empty())
+		std::cerr << path << " has no keyframes!\n";
+	return keyframes;
+}
+
+Camera interpolateKeyframes(const std::vector<Keyframe>& keyframes, int frame)
+{
+	if (frame <= keyframes.front().frame)
+		return keyframes.front().camera;
+	if (frame >= keyframes.back().frame)
+		return keyframes.back().camera;
+
+	std::size_t next = 1;
+	while (keyframes[next].frame <= frame)
+		++next;
+	const Keyframe& a = keyframes[next - 1];
+	const Keyframe& b = keyframes[next];
+
+	const double t = static_cast<double>(frame - a.frame) / (b.frame - a.frame);
+	const HighPrecision weight = HighPrecision::fromDouble(t);
+
+	Camera camera;
+	camera.centerX = a.camera.centerX + (b.camera.centerX - a.camera.centerX) * weight;
+	camera.centerY = a.camera.centerY + (b.camera.centerY - a.camera.centerY) * weight;
+	camera.scale = a.camera.scale * std::pow(b.camera.scale / a.camera.scale, t);
+	return camera;
+}
+
+bool renderSequence(const Options& options)
+{
+	const std::vector<Keyframe> keyframes = loadKeyframes(options.sequence);
+	if (keyframes.empty())
+		return false;
+
+	const bool toStdout = options.output == "-";
+#ifdef PLATFORM_WINDOWS
+	if (toStdout)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	const int width = options.width, height = options.height;
+	const std::size_t frameBytes = static_cast<std::size_t>(width) * height * 3;
+
+	TaskQueue encoderThread(framesInFlight);
+	auto failed = std::make_shared<std::atomic<bool>>(false);
+
+	// Frames reach the encoder in order, GL frames still have their rows bottom up.
+	auto encodeFrame = [&](int index, std::shared_ptr<std::vector<unsigned char>> pixels, bool bottomUp)
+	{
+		encoderThread.push([=, &options]()
+		{
+			const std::size_t rowBytes = static_cast<std::size_t>(width) * 3;
+			std::vector<unsigned char> flipped;
+			if (bottomUp)
+			{
+				flipped.resize(pixels->size());
+				for (int row = 0; row < height; ++row)
+					std::copy_n(&(*pixels)[(height - 1 - row) * rowBytes], rowBytes, &flipped[row * rowBytes]);
+			}
+			const std::vector<unsigned char>& rows = bottomUp ? flipped : *pixels;
+
+			if (toStdout)
+			{
+				if (std::fwrite(rows.data(), 1, rows.size(), stdout) != rows.size())
+					*failed = true;
+				return;
+			}
+
+			char path[4096];
+			std::snprintf(path, sizeof(path), options.output.c_str(), index);
+			PngWriter writer;
+			if (!writer.open(path, width, height) || !writer.writeRows(rows.data(), height) || !writer.close())
+			{
+				std::cerr << "Failed to write " << path << "!\n";
+				*failed = true;
+			}
+		});
+	};
+
+	// every frame is a piece of work, colored here as it comes back in order
+	if (options.distributed())
+	{
+		std::vector<FarmWork> work;
+		for (int index = keyframes.front().frame; index <= keyframes.back().frame; ++index)
+		{
+			FarmWork piece;
+			piece.camera = interpolateKeyframes(keyframes, index);
+			piece.width = width;
+			piece.height = height;
+			work.push_back(piece);
+		}
+		if (options.antialias > 1)
+			std::cerr << "Farm frames are colored from their smooth values, ignoring --antialias\n";
+
+		CpuRenderer colorer(1);
+		colorer.palette = options.palette;
+		colorer.paletteOffset = options.paletteOffset;
+		colorer.histogramColoring = options.histogramColoring;
+
+		const auto start = std::chrono::steady_clock::now();
+		const bool delivered = coordinateFarm(options, work, [&](int index, const std::vector<float>& smooth)
+		{
+			auto pixels = std::make_shared<std::vector<unsigned char>>();
+			colorer.colorize(smooth, *pixels);
+			encodeFrame(keyframes.front().frame + index, pixels, false);
+			return !*failed;
+		});
+		encoderThread.finish();
+		std::fflush(stdout);
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cerr << work.size() << " frames in " << seconds << " s (" << work.size() / std::max(seconds, 1e-9) << " frames/s)\n";
+		return delivered && !*failed;
+	}
+
+	// only the backend in use is created, the CPU one must work without a GL context
+	std::unique_ptr<CpuRenderer> cpuRenderer;
+	std::unique_ptr<ProgressiveRenderer> renderer;
+	std::unique_ptr<RenderTarget> frame;
+	std::unique_ptr<ReadbackRing> readback;
+	if (options.backend == Backend::Cpu)
+	{
+		cpuRenderer = std::make_unique<CpuRenderer>(options.threads);
+		cpuRenderer->formula = options.formula;
+		cpuRenderer->palette = options.palette;
+		cpuRenderer->paletteOffset = options.paletteOffset;
+		cpuRenderer->histogramColoring = options.histogramColoring;
+		cpuRenderer->maxIterations = options.maxIterations;
+		cpuRenderer->interiorDetection = options.interiorDetection;
+		cpuRenderer->boundaryTracing = options.boundaryTracing;
+		std::cerr << "Rendering on the CPU with " << cpuRenderer->threads() << " threads\n";
+		if (options.antialias > 1)
+			std::cerr << "The CPU backend does not supersample, ignoring --antialias\n";
+	}
+	else
+	{
+		renderer = std::make_unique<ProgressiveRenderer>(
+			options.computeKernel ? IterationKernel::Compute : IterationKernel::Fragment, options.workGroupSize);
+		renderer->iterationsPerPass = sequenceIterationsPerPass;
+		renderer->setFormula(options.formula);
+		renderer->setOptimizedKernel(options.optimizedKernel);
+		renderer->setDeltaPrecision(options.deltaPrecision);
+		renderer->setPalette(options.palette);
+		renderer->paletteOffset = options.paletteOffset;
+		renderer->setHistogramColoring(options.histogramColoring);
+		renderer->setDistanceEstimation(options.antialias > 1);
+		renderer->setMaxIterations(options.maxIterations);
+		renderer->interiorDetection = options.interiorDetection;
+		renderer->resize(width, height);
+
+		frame = std::make_unique<RenderTarget>();
+		frame->resize(width, height, { GL_RGBA8 });
+		readback = std::make_unique<ReadbackRing>(framesInFlight, frameBytes);
+	}
+
+	// every frame is one tile of the cache
+	std::unique_ptr<TileCache> tileCache;
+	if (!options.tileCache.empty())
+		tileCache = std::make_unique<TileCache>(options.tileCache);
+	std::vector<float> cached;
+
+	auto encodeOldest = [&]()
+	{
+		auto pixels = std::make_shared<std::vector<unsigned char>>();
+		const int index = readback->finish(*pixels);
+		encodeFrame(index, pixels, true);
+	};
+
+	// stdout carries the frames, so progress goes to stderr
+	const int frameCount = keyframes.back().frame + 1;
+	const auto start = std::chrono::steady_clock::now();
+	auto lastReport = start;
+	for (int index = keyframes.front().frame; index < frameCount && !*failed; ++index)
+	{
+		const Camera camera = interpolateKeyframes(keyframes, index);
+		if (cpuRenderer)
+		{
+			auto pixels = std::make_shared<std::vector<unsigned char>>();
+			const TileKey key(camera, width, height, options.maxIterations, options.formula, DeltaPrecision::Float,
+				options.interiorDetection, cpuTileLayout);
+			if (tileCache && tileCache->load(key, 1, cached))
+				cpuRenderer->colorize(cached, *pixels);
+			else
+			{
+				cpuRenderer->render(camera, width, height, *pixels);
+				if (tileCache)
+					tileCache->store(key, 1, cpuRenderer->smooth());
+			}
+			encodeFrame(index, pixels, false);
+		}
+		else
+		{
+			renderer->setCamera(camera);
+			const TileKey key(camera, width, height, options.maxIterations, options.formula, renderer->selectPrecision(),
+				options.interiorDetection, renderer->resultLayout());
+			if (!tileCache || !tileCache->load(key, ProgressiveRenderer::resultChannels, cached) || !renderer->restoreResult(cached))
+			{
+				while (!renderer->isComplete())
+					renderer->iterate();
+				if (tileCache && renderer->readResult(cached))
+					tileCache->store(key, ProgressiveRenderer::resultChannels, cached);
+			}
+			renderer->colorize(*frame, camera, false);
+			if (options.antialias > 1)
+				renderer->supersample(*frame, options.antialias);
+
+			if (readback->full())
+				encodeOldest();
+			readback->start(frame->framebuffer(), width, height, index);
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastReport > std::chrono::seconds(1))
+		{
+			const double seconds = std::chrono::duration<double>(now - start).count();
+			std::cerr << "Frame " << index + 1 << "/" << frameCount << ", "
+				<< (index + 1 - keyframes.front().frame) / seconds << " frames/s\n";
+			lastReport = now;
+		}
+	}
+	while (readback && !readback->empty())
+		encodeOldest();
+	encoderThread.finish();
+	std::fflush(stdout);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const int rendered = frameCount - keyframes.front().frame;
+	std::cerr << rendered << " frames in " << seconds << " s (" << rendered / std::max(seconds, 1e-9) << " frames/s)\n";
+	if (tileCache)
+		std::cerr << "Tile cache " << tileCache->directory() << ": " << tileCache->hits() << " hits, "
+			<< tileCache->misses() << " misses\n";
+
+	return !*failed;
+}
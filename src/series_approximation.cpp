@@ -0,0 +1,129 @@
+#include "series_approximation.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+	// relative error the series may have against a directly iterated probe
+	const double tolerance = 1e-6;
+
+	using Complex = std::complex<double>;
+	using Series = std::vector<Complex>;
+
+	// product of two series in u with the same number of terms, both starting at u^1
+	Series multiplySeries(const Series& lhs, const Series& rhs)
+	{
+		const std::size_t terms = lhs.size();
+		Series result(terms);
+		for (std::size_t i = 0; i < terms; ++i)
+			for (std::size_t j = 0; i + j + 1 < terms; ++j)
+				result[i + j + 1] += lhs[i] * rhs[j];
+		return result;
+	}
+
+	Complex integerPower(Complex base, int exponent)
+	{
+		Complex result = 1.0;
+		for (int i = 0; i < exponent; ++i)
+			result *= base;
+		return result;
+	}
+
+	Complex evaluateSeries(const Series& series, Complex u)
+	{
+		Complex sum = 0.0;
+		for (std::size_t k = series.size(); k-- > 0;)
+			sum = (sum + series[k]) * u;
+		return sum;
+	}
+
+	// (Z + d)^p - Z^p, same expansion as perturbDelta in the shader
+	Complex perturbDelta(Complex Z, Complex delta, int power)
+	{
+		Complex sum = 1.0;
+		double binomial = 1.0;
+		for (int k = power - 1; k >= 1; --k)
+		{
+			binomial = binomial * (k + 1) / (power - k);
+			sum = sum * delta + binomial * integerPower(Z, power - k);
+		}
+		return sum * delta;
+	}
+}
+
+SeriesApproximation computeSeriesApproximation(
+	const ReferenceOrbit& orbit, double deltaScale, Complex viewCenter, Complex viewRadius,
+	int terms, int maxIterations, double bailout)
+{
+	SeriesApproximation approximation;
+	if (!orbit.formula.hasSeries())
+	{
+		// Julia pixels start at their offset from the reference, the others at 0
+		approximation.coefficients.assign(terms, 0.0);
+		if (orbit.formula.kind == FormulaKind::Julia)
+			approximation.coefficients[0] = deltaScale;
+		return approximation;
+	}
+
+	const int power = orbit.formula.power;
+
+	// probes on the border and corners of the view
+	const double rx = viewRadius.real(), ry = viewRadius.imag();
+	const std::array<Complex, 8> probes =
+	{
+		viewCenter + Complex(-rx, -ry), viewCenter + Complex( rx, -ry),
+		viewCenter + Complex( rx,  ry), viewCenter + Complex(-rx,  ry),
+		viewCenter + Complex(-rx, 0.0), viewCenter + Complex( rx, 0.0),
+		viewCenter + Complex(0.0, -ry), viewCenter + Complex(0.0,  ry)
+	};
+	std::array<Complex, 8> probeDeltas{};
+
+	// delta_0 = 0, so every coefficient starts at zero
+	Series series(terms);
+
+	// the shader needs one more orbit entry to rebase against, so stop before the end
+	const int lastIteration = std::min(maxIterations, orbit.length() - 2);
+	for (int iteration = 0; iteration < lastIteration; ++iteration)
+	{
+		const Complex Z(orbit.points[2 * iteration], orbit.points[2 * iteration + 1]);
+		const Complex nextZ(orbit.points[2 * iteration + 2], orbit.points[2 * iteration + 3]);
+
+		// delta_{n+1} = sum_{j=1}^{p} binom(p, j) Z^(p-j) delta^j + deltaScale * u
+		Series next(terms);
+		Series deltaPower = series;
+		double binomial = power;
+		for (int j = 1; j <= power; ++j)
+		{
+			const Complex factor = binomial * integerPower(Z, power - j);
+			for (int k = 0; k < terms; ++k)
+				next[k] += factor * deltaPower[k];
+
+			binomial = binomial * (power - j) / (j + 1);
+			if (j < power)
+				deltaPower = multiplySeries(deltaPower, series);
+		}
+		next[0] += deltaScale;
+
+		bool valid = true;
+		for (std::size_t i = 0; i < probes.size() && valid; ++i)
+		{
+			probeDeltas[i] = perturbDelta(Z, probeDeltas[i], power) + deltaScale * probes[i];
+
+			// the series must not run past a point where a pixel could escape or rebase
+			const Complex z = nextZ + probeDeltas[i];
+			const double error = std::abs(evaluateSeries(next, probes[i]) - probeDeltas[i]);
+			valid = std::abs(z) <= bailout
+				&& std::norm(z) >= std::norm(probeDeltas[i])
+				&& error <= tolerance * std::abs(probeDeltas[i]);
+		}
+		if (!valid)
+			break;
+
+		series = next;
+		approximation.skipIterations = iteration + 1;
+	}
+
+	approximation.coefficients = series;
+	return approximation;
+}
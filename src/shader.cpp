@@ -0,0 +1,379 @@
+#include "shader.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// { vertex, fragment } or { "", compute } source
+using ProgramSources = std::pair<std::string, std::string>;
+
+struct ContextObjects
+{
+	GLuint vertex_array = 0, vertex_buffer = 0, index_buffer = 0;
+
+	// failed programs stay 0. Contexts of a share group use the same cache from several
+	// threads, so a program another thread is still compiling is pendingProgram.
+	std::map<ProgramSources, GLuint> program_cache;
+	std::mutex mutex;
+	std::condition_variable compiled;
+};
+
+namespace
+{
+	// the objects of the context glInit() created, and those of the thread's own context
+	ContextObjects shared_objects;
+	thread_local ContextObjects* scoped_objects = nullptr;
+
+	ContextObjects& objects()
+	{
+		return scoped_objects ? *scoped_objects : shared_objects;
+	}
+
+	const GLuint pendingProgram = ~0u;
+
+	// program binaries are only kept when this is set, see setProgramBinaryDirectory()
+	std::string binary_directory;
+
+	const char binary_magic[4] = { 'M', 'B', 'P', 'B' };
+	const std::uint32_t binary_version = 1;
+
+	struct BinaryHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t format;
+		std::uint32_t driverLength, firstLength, secondLength, binaryLength;
+	};
+
+	// closes the file on every early return
+	struct File
+	{
+		std::FILE* handle;
+		explicit File(std::FILE* handle) : handle(handle) {}
+		~File() { if (handle) std::fclose(handle); }
+	};
+
+	float vertices[4 * 3] =
+	{
+		-1.0f, -1.0f, 0.0f,
+		 1.0f, -1.0f, 0.0f,
+		 1.0f,  1.0f, 0.0f,
+		-1.0f,  1.0f, 0.0f
+	};
+}
+
+static GLuint compileShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, 0);
+	glCompileShader(shader);
+
+	GLint isCompiled = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+	if (isCompiled == GL_FALSE)
+	{
+		GLint maxLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+
+		// The maxLength includes the NULL character
+		std::vector<GLchar> infoLog(maxLength);
+		glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
+
+		for (std::vector<char>::const_iterator i = infoLog.begin(); i != infoLog.end(); ++i)
+			std::cout << *i;
+		std::cout << "\n";
+	}
+
+	return shader;
+}
+
+// Links the attached shaders, returns 0 (after printing the log) on failure.
+static GLuint linkProgram(GLuint program)
+{
+	// the hint only takes effect if it is set before linking
+	if (!binary_directory.empty() && GLAD_GL_VERSION_4_1)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+
+	GLint isLinked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, (int *)&isLinked);
+	if (isLinked == GL_FALSE)
+	{
+		GLint maxLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+
+		// The maxLength includes the NULL character
+		std::vector<GLchar> infoLog(maxLength);
+		glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+
+		// We don't need the program anymore.
+		glDeleteProgram(program);
+		program = 0;
+
+		for (std::vector<char>::const_iterator i = infoLog.begin(); i != infoLog.end(); ++i)
+			std::cout << *i;
+		std::cout << "\n";
+	}
+
+	return program;
+}
+
+GLuint compileProgram(const char* vertexSource, const char* fragmentSource)
+{
+	GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment_shader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	program = linkProgram(program);
+
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	return program;
+}
+
+GLuint compileComputeProgram(const char* computeSource)
+{
+	GLuint compute_shader = compileShader(GL_COMPUTE_SHADER, computeSource);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, compute_shader);
+	program = linkProgram(program);
+
+	glDeleteShader(compute_shader);
+
+	return program;
+}
+
+// A binary is only valid for the driver that produced it, the name of which is part of the key.
+static std::string driverName()
+{
+	std::string name;
+	for (GLenum part : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const GLubyte* text = glGetString(part);
+		name += text ? reinterpret_cast<const char*>(text) : "";
+		name += "\n";
+	}
+	return name;
+}
+
+static bool programBinariesAvailable()
+{
+	if (binary_directory.empty() || !GLAD_GL_VERSION_4_1)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+// FNV-1a, only for naming files, the driver and sources in the file are compared on load
+static std::string binaryPath(const std::string& driver, const ProgramSources& sources)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (const std::string* text : { &driver, &sources.first, &sources.second })
+	{
+		for (unsigned char c : *text)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		// keeps { "ab", "c" } apart from { "a", "bc" }
+		hash ^= 0xff;
+		hash *= 1099511628211ull;
+	}
+
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << hash << ".program";
+	return (std::filesystem::path(binary_directory) / name.str()).string();
+}
+
+// Returns 0 if there is no binary for sources on this driver, or the driver rejects it,
+// which is what happens after a driver update.
+static GLuint loadProgramBinary(const std::string& driver, const ProgramSources& sources)
+{
+	File file(std::fopen(binaryPath(driver, sources).c_str(), "rb"));
+	BinaryHeader header;
+	if (!file.handle || std::fread(&header, sizeof(header), 1, file.handle) != 1
+		|| !std::equal(binary_magic, binary_magic + 4, header.magic) || header.version != binary_version
+		|| header.driverLength != driver.size() || header.firstLength != sources.first.size()
+		|| header.secondLength != sources.second.size())
+		return 0;
+
+	std::string stored(driver.size() + sources.first.size() + sources.second.size(), '\0');
+	std::vector<char> binary(header.binaryLength);
+	if (std::fread(&stored[0], 1, stored.size(), file.handle) != stored.size() || stored != driver + sources.first + sources.second
+		|| std::fread(binary.data(), 1, binary.size(), file.handle) != binary.size())
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// Writes to a temporary name and renames, so that concurrent launches never read a torn file.
+static void storeProgramBinary(const std::string& driver, const ProgramSources& sources, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	BinaryHeader header;
+	std::copy(binary_magic, binary_magic + 4, header.magic);
+	header.version = binary_version;
+	header.format = format;
+	header.driverLength = static_cast<std::uint32_t>(driver.size());
+	header.firstLength = static_cast<std::uint32_t>(sources.first.size());
+	header.secondLength = static_cast<std::uint32_t>(sources.second.size());
+	header.binaryLength = static_cast<std::uint32_t>(length);
+
+	const std::string target = binaryPath(driver, sources);
+	const std::string temporary = target + "." + std::to_string(std::random_device()()) + ".tmp";
+	bool written;
+	{
+		File file(std::fopen(temporary.c_str(), "wb"));
+		written = file.handle && std::fwrite(&header, sizeof(header), 1, file.handle) == 1
+			&& std::fwrite(driver.data(), 1, driver.size(), file.handle) == driver.size()
+			&& std::fwrite(sources.first.data(), 1, sources.first.size(), file.handle) == sources.first.size()
+			&& std::fwrite(sources.second.data(), 1, sources.second.size(), file.handle) == sources.second.size()
+			&& std::fwrite(binary.data(), 1, binary.size(), file.handle) == binary.size();
+		written = file.handle && std::fclose(file.handle) == 0 && written;
+		file.handle = nullptr;
+	}
+
+	std::error_code error;
+	if (written)
+		std::filesystem::rename(temporary, target, error);
+	if (!written || error)
+		std::filesystem::remove(temporary, error);
+}
+
+static GLuint cached(const ProgramSources& sources)
+{
+	ContextObjects& context = objects();
+	std::unique_lock<std::mutex> lock(context.mutex);
+	const auto inserted = context.program_cache.emplace(sources, pendingProgram);
+	if (!inserted.second)
+	{
+		context.compiled.wait(lock, [&]() { return inserted.first->second != pendingProgram; });
+		return inserted.first->second;
+	}
+	lock.unlock();
+
+	const bool binaries = programBinariesAvailable();
+	const std::string driver = binaries ? driverName() : std::string();
+	GLuint program = binaries ? loadProgramBinary(driver, sources) : 0;
+	if (!program)
+	{
+		program = sources.first.empty() ? compileComputeProgram(sources.second.c_str())
+			: compileProgram(sources.first.c_str(), sources.second.c_str());
+		if (program && binaries)
+			storeProgramBinary(driver, sources, program);
+	}
+	// the other contexts of a share group only see a program once this one finished it
+	glFinish();
+
+	lock.lock();
+	inserted.first->second = program;
+	context.compiled.notify_all();
+	return program;
+}
+
+GLuint cachedProgram(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	return cached(std::make_pair(vertexSource, fragmentSource));
+}
+
+GLuint cachedComputeProgram(const std::string& computeSource)
+{
+	return cached(std::make_pair(std::string(), computeSource));
+}
+
+void releaseProgramCache()
+{
+	ContextObjects& context = objects();
+	std::lock_guard<std::mutex> lock(context.mutex);
+	for (const auto& entry : context.program_cache)
+	{
+		if (entry.second != pendingProgram)
+			glDeleteProgram(entry.second);
+	}
+	context.program_cache.clear();
+}
+
+void setProgramBinaryDirectory(const std::string& directory)
+{
+	binary_directory = directory;
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+}
+
+void createFullscreenQuad()
+{
+	ContextObjects& quad = objects();
+
+	// Initialize VAO, VBO, IBO
+	glGenVertexArrays(1, &quad.vertex_array);
+	glBindVertexArray(quad.vertex_array);
+
+	glGenBuffers(1, &quad.vertex_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, quad.vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 12, vertices, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, nullptr);
+
+	glGenBuffers(1, &quad.index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad.index_buffer);
+
+	unsigned int indices[6] = { 0, 1, 2, 3 };
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(float) * 4, indices, GL_STATIC_DRAW);
+}
+
+void drawFullscreenQuad()
+{
+	glBindVertexArray(objects().vertex_array);
+	glDrawArrays(GL_QUADS, 0, 4);
+}
+
+ContextObjectScope::ContextObjectScope()
+	: m_Objects(new ContextObjects())
+	, m_Previous(scoped_objects)
+{
+	scoped_objects = m_Objects.get();
+	createFullscreenQuad();
+}
+
+ContextObjectScope::~ContextObjectScope()
+{
+	releaseProgramCache();
+	glDeleteBuffers(1, &m_Objects->index_buffer);
+	glDeleteBuffers(1, &m_Objects->vertex_buffer);
+	glDeleteVertexArrays(1, &m_Objects->vertex_array);
+	scoped_objects = m_Previous;
+}
@@ -0,0 +1,212 @@
+#include "socket.hpp"
+
+#include <cstring>
+#include <utility>
+
+#ifdef PLATFORM_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef PLATFORM_WINDOWS
+	using NativeSocket = SOCKET;
+
+	// winsock needs to be started once per process before the first socket
+	bool startSockets()
+	{
+		static const bool started = []
+		{
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		return started;
+	}
+
+	void closeNative(NativeSocket socket) { closesocket(socket); }
+#else
+	using NativeSocket = int;
+
+	bool startSockets() { return true; }
+	void closeNative(NativeSocket socket) { ::close(socket); }
+#endif
+
+	NativeSocket native(std::intptr_t handle) { return static_cast<NativeSocket>(handle); }
+
+	// tiles are sent as soon as they are written, not after the Nagle delay
+	void disableNagle(NativeSocket socket)
+	{
+		int enabled = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+	}
+}
+
+Socket::~Socket()
+{
+	close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: m_Handle(other.m_Handle)
+{
+	other.m_Handle = invalidHandle;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	std::swap(m_Handle, other.m_Handle);
+	return *this;
+}
+
+void Socket::close()
+{
+	if (valid())
+		closeNative(native(m_Handle));
+	m_Handle = invalidHandle;
+}
+
+Socket Socket::listen(int port)
+{
+	if (!startSockets())
+		return Socket();
+
+	const NativeSocket handle = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	Socket result(static_cast<Handle>(handle));
+	if (!result.valid())
+		return Socket();
+
+	// a restarted coordinator can take the port over right away
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(static_cast<unsigned short>(port));
+	if (::bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+		|| ::listen(handle, SOMAXCONN) != 0)
+		return Socket();
+	return result;
+}
+
+Socket Socket::connect(const std::string& host, int port)
+{
+	if (!startSockets())
+		return Socket();
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+		return Socket();
+
+	Socket result;
+	for (addrinfo* address = addresses; address && !result.valid(); address = address->ai_next)
+	{
+		const NativeSocket handle = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		Socket candidate(static_cast<Handle>(handle));
+		if (candidate.valid() && ::connect(handle, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0)
+		{
+			disableNagle(handle);
+			result = std::move(candidate);
+		}
+	}
+	freeaddrinfo(addresses);
+	return result;
+}
+
+bool Socket::waitReadable(int milliseconds) const
+{
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(native(m_Handle), &readable);
+	timeval timeout;
+	timeout.tv_sec = milliseconds / 1000;
+	timeout.tv_usec = (milliseconds % 1000) * 1000;
+	return ::select(static_cast<int>(native(m_Handle)) + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+Socket Socket::accept(std::string& peer) const
+{
+	sockaddr_storage address;
+	socklen_t length = sizeof(address);
+	const NativeSocket handle = ::accept(native(m_Handle), reinterpret_cast<sockaddr*>(&address), &length);
+	Socket result(static_cast<Handle>(handle));
+	if (!result.valid())
+		return Socket();
+
+	disableNagle(handle);
+	char host[NI_MAXHOST] = "?", service[NI_MAXSERV] = "?";
+	getnameinfo(reinterpret_cast<const sockaddr*>(&address), length, host, sizeof(host), service, sizeof(service),
+		NI_NUMERICHOST | NI_NUMERICSERV);
+	peer = std::string(host) + ":" + service;
+	return result;
+}
+
+bool Socket::send(const void* data, std::size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0 && valid())
+	{
+		// a closed peer must fail the call instead of raising SIGPIPE
+#ifdef PLATFORM_WINDOWS
+		const int sent = ::send(native(m_Handle), bytes, static_cast<int>(size), 0);
+#else
+		const ssize_t sent = ::send(native(m_Handle), bytes, size, MSG_NOSIGNAL);
+#endif
+		if (sent <= 0)
+			return false;
+		bytes += sent;
+		size -= static_cast<std::size_t>(sent);
+	}
+	return valid();
+}
+
+bool Socket::sendLine(const std::string& line)
+{
+	const std::string text = line + "\n";
+	return send(text.data(), text.size());
+}
+
+bool Socket::receive(void* data, std::size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0 && valid())
+	{
+#ifdef PLATFORM_WINDOWS
+		const int received = ::recv(native(m_Handle), bytes, static_cast<int>(size), 0);
+#else
+		const ssize_t received = ::recv(native(m_Handle), bytes, size, 0);
+#endif
+		if (received <= 0)
+			return false;
+		bytes += received;
+		size -= static_cast<std::size_t>(received);
+	}
+	return valid();
+}
+
+bool Socket::receiveLine(std::string& line)
+{
+	// lines are short control messages, so reading them a byte at a time is fine
+	line.clear();
+	char c;
+	while (receive(&c, 1))
+	{
+		if (c == '\n')
+			return true;
+		line += c;
+	}
+	return false;
+}
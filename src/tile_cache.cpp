@@ -0,0 +1,135 @@
+#include "tile_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+namespace
+{
+	const char magic[4] = { 'M', 'B', 'T', 'C' };
+	const std::uint32_t version = 1;
+	// every fraction bit of HighPrecision
+	const int centerDigits = HighPrecision::decimalDigits;
+
+	struct Header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::int32_t width, height, channels;
+		std::uint32_t keyLength;
+	};
+
+	// FNV-1a, only for naming files, the key text in the file is compared on load
+	std::uint64_t hashText(const std::string& text)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : text)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// closes the file on every early return
+	struct File
+	{
+		std::FILE* handle;
+		explicit File(std::FILE* handle) : handle(handle) {}
+		~File() { if (handle) std::fclose(handle); }
+	};
+}
+
+std::string TileKey::text() const
+{
+	std::ostringstream text;
+	text << "center-x=" << camera.centerX.toString(centerDigits) << " center-y=" << camera.centerY.toString(centerDigits)
+		<< " scale=" << std::hexfloat << camera.scale << std::dec << " size=" << width << "x" << height
+		<< " iterations=" << maxIterations << " formula=" << formula.name();
+	if (formula.kind == FormulaKind::Julia)
+		text << " julia=" << formula.juliaX.toString(centerDigits) << "," << formula.juliaY.toString(centerDigits);
+	text << " precision=" << deltaPrecisionName(precision) << " interior=" << (interiorDetection ? "on" : "off")
+		<< " layout=" << layout;
+	return text.str();
+}
+
+TileCache::TileCache(const std::string& directory)
+	: m_Directory(directory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+}
+
+std::string TileCache::path(const TileKey& key) const
+{
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << hashText(key.text()) << ".tile";
+	return (std::filesystem::path(m_Directory) / name.str()).string();
+}
+
+bool TileCache::load(const TileKey& key, int channels, std::vector<float>& values)
+{
+	const std::string text = key.text();
+	File file(std::fopen(path(key).c_str(), "rb"));
+	Header header;
+	bool found = file.handle && std::fread(&header, sizeof(header), 1, file.handle) == 1
+		&& std::equal(magic, magic + 4, header.magic) && header.version == version
+		&& header.width == key.width && header.height == key.height && header.channels == channels
+		&& header.keyLength == text.size();
+
+	if (found)
+	{
+		std::string storedText(header.keyLength, '\0');
+		found = std::fread(&storedText[0], 1, storedText.size(), file.handle) == storedText.size() && storedText == text;
+	}
+	if (found)
+	{
+		values.resize(static_cast<std::size_t>(key.width) * key.height * channels);
+		found = std::fread(values.data(), sizeof(float), values.size(), file.handle) == values.size();
+	}
+
+	++(found ? m_Hits : m_Misses);
+	return found;
+}
+
+bool TileCache::store(const TileKey& key, int channels, const std::vector<float>& values)
+{
+	if (values.size() != static_cast<std::size_t>(key.width) * key.height * channels)
+		return false;
+
+	const std::string text = key.text();
+	const std::string target = path(key);
+	const std::string temporary = target + "." + std::to_string(std::random_device()()) + ".tmp";
+
+	Header header;
+	std::copy(magic, magic + 4, header.magic);
+	header.version = version;
+	header.width = key.width;
+	header.height = key.height;
+	header.channels = channels;
+	header.keyLength = static_cast<std::uint32_t>(text.size());
+
+	bool written;
+	{
+		File file(std::fopen(temporary.c_str(), "wb"));
+		written = file.handle && std::fwrite(&header, sizeof(header), 1, file.handle) == 1
+			&& std::fwrite(text.data(), 1, text.size(), file.handle) == text.size()
+			&& std::fwrite(values.data(), sizeof(float), values.size(), file.handle) == values.size();
+		written = file.handle && std::fclose(file.handle) == 0 && written;
+		file.handle = nullptr;
+	}
+
+	std::error_code error;
+	if (written)
+		std::filesystem::rename(temporary, target, error);
+	if (!written || error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
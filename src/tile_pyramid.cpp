@@ -0,0 +1,297 @@
+#include "tile_pyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+
+#include "tile_cache.hpp"
+
+TilePyramid::TilePyramid(IterationKernel kernel, int workGroupSize)
+	: m_Renderer(kernel, workGroupSize)
+	, m_Slots(atlasTiles * atlasTiles)
+{
+	m_Renderer.resize(tileSize, tileSize);
+	m_Tile.resize(tileSize, tileSize, { GL_RGBA8 });
+	m_Atlas.resize(atlasTiles * tileSize, atlasTiles * tileSize, { GL_RGBA8 });
+}
+
+void TilePyramid::configure(int maxIterations, const Formula& formula, int palette, float paletteOffset, int antialias)
+{
+	if (maxIterations == m_Renderer.maxIterations() && formula == m_Renderer.formula() && palette == m_Renderer.palette()
+		&& paletteOffset == m_PaletteOffset && antialias == m_Antialias)
+		return;
+
+	m_Renderer.setMaxIterations(maxIterations);
+	m_Renderer.setFormula(formula);
+	m_Renderer.setPalette(palette);
+	m_Renderer.paletteOffset = m_PaletteOffset = paletteOffset;
+	m_Renderer.setDistanceEstimation(antialias > 1);
+	m_Antialias = antialias;
+	clear();
+}
+
+void TilePyramid::clear()
+{
+	m_Resident.clear();
+	for (Slot& slot : m_Slots)
+		slot.used = false;
+	m_Working = false;
+}
+
+TilePyramid::TileAddress TilePyramid::ancestor(const TileAddress& tile, int levelsUp)
+{
+	TileAddress result;
+	result.level = tile.level - levelsUp;
+	result.x = tile.x.floorToPowerOfTwo(spanExponent(result.level));
+	result.y = tile.y.floorToPowerOfTwo(spanExponent(result.level));
+	return result;
+}
+
+TileKey TilePyramid::tileKey(const Camera& camera) const
+{
+	return TileKey(camera, tileSize, tileSize, m_Renderer.maxIterations(), m_Renderer.formula(), m_Renderer.selectPrecision(),
+		m_Renderer.interiorDetection, m_Renderer.resultLayout());
+}
+
+Camera TilePyramid::tileCamera(const TileAddress& tile) const
+{
+	const double span = std::ldexp(1.0, spanExponent(tile.level));
+	Camera camera;
+	camera.centerX = tile.x + HighPrecision::fromDouble(0.5 * span);
+	camera.centerY = tile.y + HighPrecision::fromDouble(0.5 * span);
+	camera.scale = 0.5 * span;
+	return camera;
+}
+
+std::vector<TilePyramid::TileAddress> TilePyramid::coveringTiles(int level, int ring) const
+{
+	const int exponent = spanExponent(level);
+	const double span = std::ldexp(1.0, exponent);
+	// square pixels, the scale is half of the view height
+	const double halfWidth = m_Camera.scale * m_Width / m_Height;
+	const double halfHeight = m_Camera.scale;
+
+	const HighPrecision left = (m_Camera.centerX - HighPrecision::fromDouble(halfWidth)).floorToPowerOfTwo(exponent)
+		- HighPrecision::fromDouble(ring * span);
+	const HighPrecision bottom = (m_Camera.centerY - HighPrecision::fromDouble(halfHeight)).floorToPowerOfTwo(exponent)
+		- HighPrecision::fromDouble(ring * span);
+	const double leftOffset = (left - m_Camera.centerX).toDouble();
+	const double bottomOffset = (bottom - m_Camera.centerY).toDouble();
+	const int columns = static_cast<int>(std::ceil((halfWidth - leftOffset) / span)) + ring;
+	const int rows = static_cast<int>(std::ceil((halfHeight - bottomOffset) / span)) + ring;
+
+	std::vector<std::pair<double, TileAddress>> tiles;
+	const HighPrecision step = HighPrecision::fromDouble(span);
+	HighPrecision y = bottom;
+	for (int row = 0; row < rows; ++row, y += step)
+	{
+		HighPrecision x = left;
+		for (int column = 0; column < columns; ++column, x += step)
+		{
+			const double dx = leftOffset + (column + 0.5) * span, dy = bottomOffset + (row + 0.5) * span;
+			TileAddress tile;
+			tile.level = level;
+			tile.x = x;
+			tile.y = y;
+			tiles.emplace_back(dx * dx + dy * dy, tile);
+		}
+	}
+	std::stable_sort(tiles.begin(), tiles.end(),
+		[](const std::pair<double, TileAddress>& a, const std::pair<double, TileAddress>& b) { return a.first < b.first; });
+
+	std::vector<TileAddress> result;
+	for (const std::pair<double, TileAddress>& tile : tiles)
+		result.push_back(tile.second);
+	return result;
+}
+
+int TilePyramid::placeholderSlot(const TileAddress& tile, int& levelsUp) const
+{
+	for (levelsUp = 0; levelsUp <= std::min(maximumPlaceholderLevels, tile.level); ++levelsUp)
+	{
+		const auto resident = m_Resident.find(ancestor(tile, levelsUp));
+		if (resident != m_Resident.end())
+			return resident->second;
+	}
+	return -1;
+}
+
+void TilePyramid::setView(const Camera& camera, int width, int height)
+{
+	m_Camera = camera;
+	m_Width = width;
+	m_Height = height;
+	++m_Frame;
+	m_Visible.clear();
+	m_Wanted.clear();
+	if (width <= 0 || height <= 0)
+	{
+		m_Working = false;
+		return;
+	}
+
+	// the coarsest level whose tile pixels are at most a screen pixel
+	const double pixelSize = 2.0 * camera.scale / height;
+	const double level = std::ceil(std::log2(std::ldexp(1.0, spanExponent(0)) / (tileSize * pixelSize)));
+	m_Level = static_cast<int>(std::min(std::max(level, 0.0), static_cast<double>(HighPrecision::fractionBits)));
+
+	m_Visible = coveringTiles(m_Level, 0);
+	std::vector<TileAddress> wanted = m_Visible;
+	if (m_Level > 0)
+	{
+		const std::vector<TileAddress> parents = coveringTiles(m_Level - 1, 0);
+		wanted.insert(wanted.end(), parents.begin(), parents.end());
+	}
+	const std::set<TileAddress> visible(m_Visible.begin(), m_Visible.end());
+	for (const TileAddress& tile : coveringTiles(m_Level, 1))
+	{
+		if (!visible.count(tile))
+			wanted.push_back(tile);
+	}
+
+	for (const TileAddress& tile : wanted)
+	{
+		const auto resident = m_Resident.find(tile);
+		if (resident != m_Resident.end())
+			m_Slots[resident->second].lastUsed = m_Frame;
+		else
+			m_Wanted.push_back(tile);
+	}
+	// the placeholders of the visible tiles must not be evicted either
+	for (const TileAddress& tile : m_Visible)
+	{
+		int levelsUp;
+		const int slot = placeholderSlot(tile, levelsUp);
+		if (slot >= 0)
+			m_Slots[slot].lastUsed = m_Frame;
+	}
+
+	// a tile the view moved away from is dropped, whatever was iterated of it
+	if (m_Working && std::find(m_Wanted.begin(), m_Wanted.end(), m_Current) == m_Wanted.end())
+		m_Working = false;
+}
+
+void TilePyramid::update()
+{
+	for (int pass = 0; pass < passesPerFrame; ++pass)
+	{
+		if (!m_Working)
+		{
+			if (m_Wanted.empty())
+				return;
+			startTile();
+		}
+		m_Renderer.iterate();
+		if (m_Renderer.isComplete())
+			finishTile();
+	}
+}
+
+void TilePyramid::startTile()
+{
+	m_Current = m_Wanted.front();
+	m_Working = true;
+
+	// Neighbouring tiles of a level share the scale, so the renderer treats the next tile
+	// as a pan and iterates it with the reference orbit of the previous one.
+	const Camera camera = tileCamera(m_Current);
+	m_Renderer.setCamera(camera);
+	const TileKey key = tileKey(camera);
+	m_Restored = m_Cache && m_Cache->load(key, ProgressiveRenderer::resultChannels, m_Result)
+		&& m_Renderer.restoreResult(m_Result);
+}
+
+void TilePyramid::finishTile()
+{
+	m_Working = false;
+	m_Wanted.erase(std::remove(m_Wanted.begin(), m_Wanted.end(), m_Current), m_Wanted.end());
+
+	const Camera camera = tileCamera(m_Current);
+	if (m_Cache && !m_Restored && m_Renderer.readResult(m_Result))
+	{
+		const TileKey key = tileKey(camera);
+		m_Cache->store(key, ProgressiveRenderer::resultChannels, m_Result);
+	}
+
+	const int slot = allocateSlot();
+	if (slot < 0)
+	{
+		// every slot holds a tile of this view, the atlas is too small for the screen
+		m_Wanted.clear();
+		return;
+	}
+
+	m_Renderer.colorize(m_Tile, camera, false);
+	if (m_Antialias > 1)
+		m_Renderer.supersample(m_Tile, m_Antialias);
+
+	const int x = (slot % atlasTiles) * tileSize, y = (slot / atlasTiles) * tileSize;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Tile.framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_Atlas.framebuffer());
+	glBlitFramebuffer(0, 0, tileSize, tileSize, x, y, x + tileSize, y + tileSize, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_Slots[slot].address = m_Current;
+	m_Slots[slot].used = true;
+	m_Slots[slot].lastUsed = m_Frame;
+	m_Resident[m_Current] = slot;
+}
+
+int TilePyramid::allocateSlot()
+{
+	int oldest = -1;
+	for (int slot = 0; slot < static_cast<int>(m_Slots.size()); ++slot)
+	{
+		if (!m_Slots[slot].used)
+			return slot;
+		if (m_Slots[slot].lastUsed < m_Frame && (oldest < 0 || m_Slots[slot].lastUsed < m_Slots[oldest].lastUsed))
+			oldest = slot;
+	}
+
+	if (oldest >= 0)
+	{
+		m_Resident.erase(m_Slots[oldest].address);
+		m_Slots[oldest].used = false;
+	}
+	return oldest;
+}
+
+void TilePyramid::draw(const RenderTarget& target) const
+{
+	target.bind();
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	if (m_Height <= 0)
+		return;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Atlas.framebuffer());
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	const double pixelSize = 2.0 * m_Camera.scale / m_Height;
+	const double span = std::ldexp(1.0, spanExponent(m_Level));
+	const double tilePixels = span / pixelSize;
+	for (const TileAddress& tile : m_Visible)
+	{
+		int levelsUp;
+		const int slot = placeholderSlot(tile, levelsUp);
+		if (slot < 0)
+			continue;
+
+		// the part of the resident tile that covers this one
+		const TileAddress source = ancestor(tile, levelsUp);
+		const int size = tileSize >> levelsUp;
+		const int sourceX = (slot % atlasTiles) * tileSize + static_cast<int>(std::lround((tile.x - source.x).toDouble() / span)) * size;
+		const int sourceY = (slot / atlasTiles) * tileSize + static_cast<int>(std::lround((tile.y - source.y).toDouble() / span)) * size;
+
+		const double x = (tile.x - m_Camera.centerX).toDouble() / pixelSize + 0.5 * m_Width;
+		const double y = (tile.y - m_Camera.centerY).toDouble() / pixelSize + 0.5 * m_Height;
+		glBlitFramebuffer(sourceX, sourceY, sourceX + size, sourceY + size,
+			static_cast<GLint>(std::lround(x)), static_cast<GLint>(std::lround(y)),
+			static_cast<GLint>(std::lround(x + tilePixels)), static_cast<GLint>(std::lround(y + tilePixels)),
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,137 @@
+#include "tile_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	// own cache line per deque, the owner touches it on every tile
+	struct alignas(64) TileQueue
+	{
+		std::mutex mutex;
+		std::deque<int> tiles;
+	};
+
+	// Position of the d-th cell on the Hilbert curve through an n x n grid, n a power of two.
+	void hilbertPosition(int n, int d, int& x, int& y)
+	{
+		x = y = 0;
+		for (int s = 1; s < n; s *= 2)
+		{
+			const int rx = 1 & (d / 2);
+			const int ry = 1 & (d ^ rx);
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = s - 1 - x;
+					y = s - 1 - y;
+				}
+				std::swap(x, y);
+			}
+			x += s * rx;
+			y += s * ry;
+			d /= 4;
+		}
+	}
+}
+
+TileScheduler::TileScheduler(int threads)
+	: m_Threads(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency())))
+{
+}
+
+std::vector<int> TileScheduler::hilbertOrder(int tilesX, int tilesY)
+{
+	// walk the enclosing power of two square and skip the cells outside of the grid
+	int n = 1;
+	while (n < tilesX || n < tilesY)
+		n *= 2;
+
+	std::vector<int> order;
+	order.reserve(static_cast<std::size_t>(tilesX) * tilesY);
+	for (int d = 0; d < n * n; ++d)
+	{
+		int x, y;
+		hilbertPosition(n, d, x, y);
+		if (x < tilesX && y < tilesY)
+			order.push_back(y * tilesX + x);
+	}
+	return order;
+}
+
+void TileScheduler::run(int tilesX, int tilesY, const std::function<void(int, int, int)>& work)
+{
+	m_Stats.assign(m_Threads, ThreadStats());
+	const std::vector<int> order = hilbertOrder(tilesX, tilesY);
+
+	// deal the curve out in contiguous runs
+	std::unique_ptr<TileQueue[]> queues(new TileQueue[m_Threads]);
+	for (int thread = 0; thread < m_Threads; ++thread)
+	{
+		const std::size_t begin = order.size() * thread / m_Threads;
+		const std::size_t end = order.size() * (thread + 1) / m_Threads;
+		queues[thread].tiles.assign(order.begin() + begin, order.begin() + end);
+	}
+
+	auto worker = [&](int thread)
+	{
+		TileQueue& own = queues[thread];
+		ThreadStats& stats = m_Stats[thread];
+		std::vector<int> loot;
+
+		while (true)
+		{
+			int tile = -1;
+			{
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if (!own.tiles.empty())
+				{
+					tile = own.tiles.front();
+					own.tiles.pop_front();
+				}
+			}
+
+			// Out of work: take the back half of the first non-empty deque, which is the
+			// part of its run the victim would have reached last.
+			for (int offset = 1; tile < 0 && offset < m_Threads; ++offset)
+			{
+				TileQueue& victim = queues[(thread + offset) % m_Threads];
+				{
+					std::lock_guard<std::mutex> lock(victim.mutex);
+					const std::size_t count = (victim.tiles.size() + 1) / 2;
+					loot.assign(victim.tiles.end() - count, victim.tiles.end());
+					victim.tiles.erase(victim.tiles.end() - count, victim.tiles.end());
+				}
+				if (loot.empty())
+					continue;
+
+				stats.stolen += static_cast<int>(loot.size());
+				tile = loot.front();
+				std::lock_guard<std::mutex> lock(own.mutex);
+				own.tiles.insert(own.tiles.end(), loot.begin() + 1, loot.end());
+			}
+
+			// every tile is either done or owned by a thread that is still running
+			if (tile < 0)
+				return;
+
+			const auto start = std::chrono::steady_clock::now();
+			work(tile % tilesX, tile / tilesX, thread);
+			stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			++stats.tiles;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int thread = 1; thread < m_Threads; ++thread)
+		threads.emplace_back(worker, thread);
+	worker(0);
+	for (std::thread& thread : threads)
+		thread.join();
+}